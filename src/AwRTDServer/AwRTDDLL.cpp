@@ -7,7 +7,7 @@
 ///
 /// \class: AwRTDClassFactory
 ///
-#include "configuration.h"
+#include "../RTDCore/configuration.h"
 #include "AwRTDDLL.h"
 #include "AwRTDImpl.h"
 
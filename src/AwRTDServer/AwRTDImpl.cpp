@@ -7,12 +7,11 @@
 ///
 /// Microsoft.Office...Excel.Option.RTDThrottleInterval 0
 ///
-#include "datacache.h"
 #include "AwRTDImpl.h"
-#include "configuration.h"
+#include "../RTDCore/configuration.h"
 
 #include <iostream>
-#include <algorithm>
+#include <vector>
 
 // RTD required
 LONG g_cOb = 0;	//global count of the number of objects created.
@@ -39,6 +38,10 @@ AwRTD::AwRTD(IUnknown* pUnkOuter)
 AwRTD::~AwRTD()
 {
 	AW_LOG("~AwRTD::AwRTD");
+	if (m_thread.joinable()) { // released without ServerTerminate
+		m_server.stop();
+		m_thread.join();
+	}
 	//Clean up the type information
 	if (m_pTypeInfoInterface != NULL) {
 		m_pTypeInfoInterface->Release();
@@ -61,37 +64,14 @@ void AwRTD::OnThreadProc(IStream* stream)
 
 	//Set the heartbeat interval to a little more than our timer interval
 	if (pRTDUpdate != NULL) {
-		pRTDUpdate->AddRef();
 		hr = pRTDUpdate->put_HeartbeatInterval(1200);
 
-		HANDLE handles[2] = { Configuration::instance().getShutdownHandle(), Configuration::instance().getNotifyHandle() };
-		DWORD dwIdx;
-		bool done = false;
-		uint64_t secondCount = 0;
-		while (!done)
-		{
-			dwIdx = WaitForMultipleObjects(2, handles, FALSE, 1000);
-			switch (dwIdx)
-			{
-			case WAIT_OBJECT_0:
-				AW_LOG("Got shutdown event");
-				return; // this thread will not exit peacefully
-				pRTDUpdate->Disconnect();
-				done = true;
-				break;
-			case WAIT_OBJECT_0 + 1:
-				pRTDUpdate->UpdateNotify(); // don't call update from datacache is because this is required from m_thread
-				break;
-			case WAIT_TIMEOUT:
-				if (secondCount++ % 10 == 0)
-					Configuration::instance().readVerbose();
-				break;
-			default:
-				AW_LOG("wrong return for WaitForMultipleObjects");
-				break;
-			}
-		}
-		//Clean up the RTDUpdate object
+		// returns once ServerTerminate's stop(), which joins this thread before m_server can go
+		m_server.notify_loop([pRTDUpdate]() {
+			pRTDUpdate->UpdateNotify(); // don't call update from datacache is because this is required from m_thread
+		});
+		AW_LOG("Got shutdown event");
+		//Clean up the RTDUpdate object (the proxy CoGetInterfaceAndReleaseStream gave)
 		pRTDUpdate->Release();
 	}
 	CoUninitialize();
@@ -137,10 +117,9 @@ STDMETHODIMP AwRTD::ServerStart(IRTDUpdateEvent *CallbackObject,
 		*pfRes = dwId;
 		* */
 		*pfRes = 10;
-		m_thread = std::thread([=] {OnThreadProc(pMarshalStream); });
-		m_thread.detach(); // tells OS this thread is unjoinable since we know the thread won't exist peacefully.
-		// ServerTerminate can't join this thread
-		auto rt = m_cache.start();
+		if (SUCCEEDED(hr) && !m_thread.joinable())
+			m_thread = std::thread([=] {OnThreadProc(pMarshalStream); }); // joined by ServerTerminate
+		auto rt = m_server.start();
 		AW_LOG("Data Cache started: " << rt);
 	}
 	return hr;
@@ -160,21 +139,17 @@ STDMETHODIMP AwRTD::ServerStart(IRTDUpdateEvent *CallbackObject,
 *  Returns: S_OK
 *           E_POINTER
 *           E_FAIL
-*  ex: quote, MSFT, bid
+*  ex: quote, MSFT, bid (RtdServer::connect has the rest)
 ******************************************************************************/
 STDMETHODIMP AwRTD::ConnectData(long TopicID,
 	SAFEARRAY** Strings,
 	VARIANT_BOOL* GetNewValues,
 	VARIANT* pvarOut)
 {
-	if (Configuration::instance().getVerbose())
-		AW_LOG("AwRTD::ConnectData");
-
 	if (pvarOut == NULL)
 		return E_POINTER;
 
 	HRESULT hr = S_OK;
-	// dump all params
 	LONG lstart, lend;
 	if (FAILED(SafeArrayGetLBound(*Strings, 1, &lstart)) || FAILED(SafeArrayGetUBound(*Strings, 1, &lend)))
 	{
@@ -187,48 +162,16 @@ STDMETHODIMP AwRTD::ConnectData(long TopicID,
 		return hr;
 	}
 
-	VARIANT var1;
-	VariantInit(&var1);
-
-	LONG first(0);
-
-	if (FAILED(SafeArrayGetElement(*Strings, &first, &var1)))
-	{
-		AW_LOG("AwRTD::ConnectData: couldn't get first parameter (action)");
-		return hr;
-	}
-	std::string action = (const char*)_bstr_t(var1.bstrVal);
-	// if not quote, return hr
-	if (action.compare(Configuration::command))
-	{
-		AW_LOG("AwRTD::ConnectData: action<" << action << "> not quote (unsupported)");
-		return hr;
-	}
-
-	VARIANT var2, var3;
-	VariantInit(&var2);
-	VariantInit(&var3);
-	LONG second(1);
-	LONG third(2);
-	if (FAILED(SafeArrayGetElement(*Strings, &second, &var2)) ||
-		FAILED(SafeArrayGetElement(*Strings, &third, &var3)))
+	// excel's strings read in place, no element copies, RtdServer does the rest
+	VARIANT* strings = NULL;
+	if (FAILED(SafeArrayAccessData(*Strings, reinterpret_cast<void**>(&strings))))
 	{
-		AW_LOG("AwRTD::ConnectData: couldn't get second parameter (symbol) and third (topic)");
+		AW_LOG("AwRTD::ConnectData: couldn't access parameters");
 		return hr;
 	}
-	std::string symbol = (const char*)_bstr_t(var2.bstrVal);
-	std::string topic = (const char*)_bstr_t(var3.bstrVal);
-	if (Configuration::instance().getVerbose())
-		AW_LOG("AwRTD::ConnectData: command<" << action << "> symbol<" << symbol << "> topic<" << topic << "> topic_id<" << TopicID << ">");
-
-	m_cache.add(symbol, topic, TopicID);
-
-	// return stuff
-	*GetNewValues = TRUE;
-	VariantInit(pvarOut);
-	pvarOut->vt = VT_BSTR;
-	std::string status = "WAITING";
-	pvarOut->bstrVal = SysAllocString(_bstr_t(status.c_str()));
+	if (m_server.connect(TopicID, strings, static_cast<size_t>(lend - lstart + 1), pvarOut))
+		*GetNewValues = TRUE;
+	SafeArrayUnaccessData(*Strings);
 	return hr;
 }
 
@@ -258,38 +201,10 @@ STDMETHODIMP AwRTD::RefreshData( long *TopicCount,
 
 	*TopicCount = 0;
 
-	// pulls updated data from m_cache
-	std::vector<std::pair<VARIANT, VARIANT>> data;
-	m_cache.get(data);
-	AW_LOG("AwRTD::RefreshData: get: " << data.size());
-	if (data.empty())
-		return hr;
-
-	*TopicCount = static_cast<long>(data.size());
-	SAFEARRAYBOUND bounds[2];
-	long index[2];
-	bounds[0].cElements = 2;
-	bounds[0].lLbound = 0;
-	bounds[1].cElements = *TopicCount;
-	bounds[1].lLbound = 0;
-	*parrayOut = SafeArrayCreate(VT_VARIANT, 2, bounds);
-
-	int32_t i = 0;
-	for (const auto& it : data)
-	{
-		// puts in topic id
-		index[0] = 0;
-		index[1] = i;
-		SafeArrayPutElement(*parrayOut, index, (void*)(&(it.first)));
-		// puts in value
-		index[0] = 1;
-		index[1] = i;
-		SafeArrayPutElement(*parrayOut, index, (void*)(&(it.second)));
-
-		AW_LOG("refresh: topicId=" << it.first.intVal << ", type=" << it.first.vt << ", dat=" << it.second.dblVal << ", type=" << it.second.vt);
-		i++;
-	}
-
+	// pulls updated data from the cache, everything changed from here on needs another UpdateNotify
+	RefreshBatch batch;
+	if (m_server.refresh(batch) != 0)
+		*parrayOut = batch.finish(TopicCount);
 	return hr;
 }
 
@@ -301,8 +216,9 @@ STDMETHODIMP AwRTD::RefreshData( long *TopicCount,
 ******************************************************************************/
 STDMETHODIMP AwRTD::DisconnectData( long TopicID)
 {
-	AW_LOG("AwRTD::DisconnectData");
+	AW_LOG("AwRTD::DisconnectData: topic_id<" << TopicID << ">");
 	HRESULT hr = S_OK;
+	m_server.disconnect(TopicID);
 	return hr;
 }
 
@@ -335,8 +251,15 @@ STDMETHODIMP AwRTD::Heartbeat(long *pfRes)
 STDMETHODIMP AwRTD::ServerTerminate( void)
 {
 	AW_LOG("AwRTD::ServerTerminate");
-	// don't call m_thread.join() since we can't kill it from here
-	m_cache.stop();
+	// stop() makes notify_loop() return, the thread is joined before excel's last Release can delete m_server
+	// COM calls are pumped meanwhile: an UpdateNotify already on its way to this (excel's) thread must get through
+	m_server.stop();
+	if (m_thread.joinable()) {
+		auto handle = m_thread.native_handle(); // HANDLE
+		DWORD index = 0;
+		CoWaitForMultipleHandles(0, INFINITE, 1, &handle, &index);
+		m_thread.join();
+	}
 	aw::logger::stop();
 	return S_OK;
 }
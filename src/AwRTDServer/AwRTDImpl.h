@@ -10,7 +10,7 @@
 ///
 #include "comdef.h"
 #include "IRTDServer_h.h"
-#include "datacache.h"
+#include "../RTDCore/rtdserver.h"
 
 #include <string>
 #include <thread>
@@ -42,8 +42,8 @@ private:
    IUnknown* m_pOuterUnknown;
    ITypeInfo* m_pTypeInfoInterface;
    // HANDLE m_hthread = INVALID_HANDLE_VALUE;
-   DataCache m_cache;
-   std::thread m_thread;
+   RtdServer m_server; // everything but COM
+   std::thread m_thread; // notifier, runs on m_server until ServerTerminate joins it
    
 public:
     void OnThreadProc(IStream* stream);
@@ -0,0 +1,2279 @@
+// CacheStressTest : drives DataCache without excel, portable (linux: cmake target CacheStressTest)
+// churn: subscribe/unsubscribe cycles while a feed thread keeps updating, memory must stay bounded
+// filter: cost of onData for packets nobody subscribed to, and that none of them leak through
+// tms: per packet cost of the "tms" topic, old stringstream + BSTR per packet vs raw timestamp formatted on refresh
+// bars: replays random ticks through BarTopics + timer wheel, completed bars must match a brute force reference
+// derived: mid/spread/vwap/chg recomputed only from inputs that came in, through onData against the packets, with and
+//	without "cls", unchanged outputs don't mark their cells
+// rolling: hi/lo/vol/tck windows fed through onData against a brute force reference, a quiet symbol's windows drain
+// options: iv/greeks topics on OCC symbols fed through onData, chain reprices on underlying ticks and is reclaimed
+// expr: parser cases, then cross symbol expressions fed through onData must match values computed from the packets
+// ticks: history topics against the packets, query API from a second reader, history still there after a restart
+// snapshot: checkpoint, restart, ConnectData values come from the mapped snapshot, load and lookup cost
+// shm: FeedHandler's shared last value table, a reader polling while the writer runs ends with every last value,
+//	then DataCache fed from the table instead of multicast
+// journal: RefreshData and a recorder that polls rarely (lapped by the ring) both end with every last value,
+//	unsubscribe/resubscribe in between, then get() cost with many cells and few changes
+// deadband: flickering quotes with a tick band and a relative band, excel only gets moves past the band
+// pacing: simulated feed and excel, UpdateNotify per packet vs NotifyPacer, notifications/s, excel busy time, staleness
+// batches: simulated burst of changed cells through MaxRefreshBatch, staleness percentiles per priority class
+// blocked: feed at a steady rate while excel refreshes, time excel is blocked inside get() (RefreshData), last values
+// strings: interned text values, reuse of idle pool entries, BSTRs per "tms" value, none left once the cache is gone
+// depth: synthetic level 2 traffic through onDepth, updates/s, top ranks must match a std::map book
+// stale: StaleMs deadlines on a hand driven clock, "stale" topic and the flag readers of changes get, cost per packet
+// server: RtdServer (AwRTD without COM) connect strings, notifier thread, refresh, disconnect and stop
+// instances: two RtdServers sharing the process's cache and feed, TopicIDs colliding between them, the last one stopping
+
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <random>
+#include <cmath>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "../RTDCore/rtdserver.h"
+
+// BSTRs made and not yet freed, strings mode checks leaks and BSTRs per value with them, the variant stand-in counts
+// them (with oleaut32 only the pool's own count is checked)
+auto bstrsMade() -> uint64_t
+{
+#ifdef _WIN64
+	return 0;
+#else
+	return g_bstr_allocations;
+#endif
+}
+auto bstrsLive() -> uint64_t
+{
+#ifdef _WIN64
+	return 0;
+#else
+	return g_bstr_allocations - g_bstr_frees;
+#endif
+}
+
+auto symbolName(uint32_t i) -> std::string
+{
+	return "SYM" + std::to_string(i);
+}
+
+// feed thread: updates twice as many symbols as excel ever subscribes to
+class Feeder
+{
+public:
+	Feeder(DataCache& cache, uint32_t num_symbols) : m_cache(cache), m_num_symbols(num_symbols) {}
+
+	auto start() -> void
+	{
+		m_thread = std::thread([=] { run(); });
+	}
+	auto stop() -> void
+	{
+		m_shutdown = true;
+		m_thread.join();
+	}
+	auto count() -> uint64_t { return m_count; }
+
+private:
+	auto run() -> void
+	{
+		uint64_t i = 0;
+		while (!m_shutdown) {
+			VARIANT var;
+			VariantInit(&var);
+			var.vt = VT_R8;
+			var.dblVal = static_cast<double>(i);
+			m_cache.update(symbolName(i % (2 * m_num_symbols)), "bid", var);
+			i++;
+		}
+		m_count = i;
+	}
+
+	DataCache& m_cache;
+	uint32_t m_num_symbols;
+	std::atomic<bool> m_shutdown = false;
+	std::atomic<uint64_t> m_count = 0;
+	std::thread m_thread;
+};
+
+auto churn(uint32_t num_symbols, uint32_t cycles) -> bool
+{
+	const char* topics[] = { "bid", "ask", "vol" };
+	DataCache cache;
+	Feeder feeder(cache, num_symbols);
+	feeder.start();
+	LONG topic_id = 0;
+	size_t high_water = 0;
+	bool ok = true;
+	for (uint32_t c = 0; c < cycles; c++) {
+		// each cycle subscribes a sliding window of symbols, twice per cell (two sheets), with fresh TopicIDs
+		std::vector<LONG> ids;
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			auto symbol = symbolName((i + c * 7) % (2 * num_symbols));
+			for (const char* topic : topics) {
+				cache.add(symbol, topic, topic_id);
+				ids.push_back(topic_id++);
+				cache.add(symbol, topic, topic_id);
+				ids.push_back(topic_id++);
+			}
+		}
+		auto st = cache.stats();
+		high_water = (std::max)(high_water, st.m_pooled);
+		if (st.m_symbols != num_symbols || st.m_cells != num_symbols * 3 || st.m_topic_ids != ids.size()) {
+			std::cout << "cycle " << c << ": wrong subscribed counts, symbols: " << st.m_symbols << " cells: " << st.m_cells << " topic ids: " << st.m_topic_ids << std::endl;
+			ok = false;
+		}
+		std::vector<std::pair<VARIANT, VARIANT>> data;
+		cache.get(data);
+		for (auto& it : data)
+			VariantClear(&it.second);
+		for (auto id : ids)
+			cache.remove(id);
+		st = cache.stats();
+		if (st.m_symbols != 0 || st.m_cells != 0 || st.m_topic_ids != 0 || st.m_free != st.m_pooled) {
+			std::cout << "cycle " << c << ": not reclaimed, symbols: " << st.m_symbols << " cells: " << st.m_cells << " free: " << st.m_free << "/" << st.m_pooled << std::endl;
+			ok = false;
+		}
+		// TopicIDs keep increasing (like excel does), but pool must not grow past one window of symbols
+		if (st.m_pooled > num_symbols) {
+			std::cout << "cycle " << c << ": pool grew to " << st.m_pooled << " for " << num_symbols << " symbols" << std::endl;
+			ok = false;
+		}
+	}
+	feeder.stop();
+	std::cout << "feed updates: " << feeder.count() << std::endl;
+	std::cout << "pool high water: " << high_water << " symbols" << std::endl;
+	return ok;
+}
+
+// topic, EnhancedUDPData type (1: int64_t, 2: scaled by SCALE), raw value
+struct PacketField
+{
+	const char* m_topic;
+	int8_t m_type;
+	int64_t m_val;
+};
+
+// one EnhancedUDPData with fields in order, sized like the python sender sends it
+auto makePacket(const std::string& symbol, uint64_t timestamp, const std::vector<PacketField>& fields) -> std::vector<char>
+{
+	std::vector<char> buf(offsetof(EnhancedUDPData, m_fields) + fields.size() * sizeof(EnhancedUDPData::Field), 0);
+	auto* data = reinterpret_cast<EnhancedUDPData*>(buf.data());
+	memcpy(data->m_symbol, symbol.c_str(), (std::min)(symbol.size(), sizeof(data->m_symbol)));
+	data->m_timestamp = timestamp;
+	data->m_num_fields = static_cast<uint16_t>(fields.size());
+	for (size_t i = 0; i < fields.size(); i++) {
+		memcpy(data->m_fields[i].m_topic, fields[i].m_topic, sizeof(data->m_fields[i].m_topic));
+		data->m_fields[i].m_type = fields[i].m_type;
+		data->m_fields[i].m_val = fields[i].m_val;
+	}
+	return buf;
+}
+// bid/ask/vol
+auto makePacket(const std::string& symbol, uint64_t timestamp, int64_t bid, int64_t ask, int64_t vol) -> std::vector<char>
+{
+	return makePacket(symbol, timestamp, { { "bid", 2, bid }, { "ask", 2, ask }, { "vol", 1, vol } });
+}
+
+auto filter(uint32_t num_symbols, uint32_t num_packets) -> bool
+{
+	DataCache cache;
+	LONG topic_id = 0;
+	for (uint32_t i = 0; i < num_symbols; i++)
+		cache.add(symbolName(i), "bid", topic_id++);
+	// feed carries num_symbols * 10 other symbols
+	std::vector<std::vector<char>> packets;
+	for (uint32_t i = 0; i < num_symbols * 10; i++)
+		packets.push_back(makePacket("OTHER" + std::to_string(i), 1, 100, 101, 1000));
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < num_packets; i++) {
+		const auto& p = packets[i % packets.size()];
+		cache.onData(p.data(), p.size());
+	}
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	auto st = cache.stats();
+	std::cout << "subscribed symbols: " << st.m_symbols << ", filter rebuilds: " << st.m_filter_rebuilds << std::endl;
+	std::cout << "unwatched packets: " << num_packets << ", filtered: " << st.m_filtered << ", ns/packet: " << static_cast<double>(ns) / num_packets << std::endl;
+	// a watched symbol must still get through
+	auto p = makePacket(symbolName(num_symbols - 1), 1, 100000000000, 101000000000, 1000);
+	cache.onData(p.data(), p.size());
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	cache.get(data);
+	for (auto& it : data)
+		VariantClear(&it.second);
+	std::cout << "watched packet produced " << data.size() << " update(s)" << std::endl;
+	// a datagram cut short after its first field but claiming 20: only the field received is read
+	auto cut = makePacket(symbolName(0), 2, 99000000000, 101000000000, 1000);
+	reinterpret_cast<EnhancedUDPData*>(cut.data())->m_num_fields = 20;
+	cut.resize(offsetof(EnhancedUDPData, m_fields) + sizeof(EnhancedUDPData::Field));
+	cut.shrink_to_fit();
+	cache.onData(cut.data(), cut.size());
+	std::vector<std::pair<VARIANT, VARIANT>> short_data;
+	cache.get(short_data);
+	bool short_ok = short_data.size() == 1 && short_data[0].second.vt == VT_R8 && short_data[0].second.dblVal == 99;
+	for (auto& it : short_data)
+		VariantClear(&it.second);
+	std::cout << "short packet produced " << short_data.size() << " update(s)" << std::endl;
+	return st.m_filtered == num_packets && data.size() == 1 && short_ok;
+}
+
+// what onData did for every packet before "tms" became lazy
+auto formatOld(uint64_t mks) -> BSTR
+{
+	std::chrono::system_clock::time_point timestamp = aw::get_time_point_from_mks_from_epoch(mks);
+	std::stringstream tStream;
+	tStream << timestamp;
+	std::string tms(tStream.str());
+	BSTR bstr = SysAllocStringLen(NULL, static_cast<UINT>(tms.size())); // was _bstr_t's conversion, windows only
+	for (size_t i = 0; i < tms.size(); i++)
+		bstr[i] = static_cast<OLECHAR>(tms[i]);
+	return bstr;
+}
+
+template<typename F>
+auto nsPer(uint32_t count, F f) -> double
+{
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < count; i++)
+		f(i);
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	return static_cast<double>(ns) / count;
+}
+
+auto tms(uint32_t num_packets) -> bool
+{
+	uint64_t mks = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	// ticks 37us apart, so roughly 27k packets share each second prefix
+	auto old_ns = nsPer(num_packets, [&](uint32_t i) { SysFreeString(formatOld(mks + i * 37)); });
+	aw::TimestampFormatter formatter;
+	char buf[aw::TimestampFormatter::SIZE];
+	auto new_ns = nsPer(num_packets, [&](uint32_t i) { formatter.format(mks + i * 37, buf); });
+	bool same = true;
+	for (uint32_t i = 0; i < 1000 && same; i++) {
+		BSTR b = formatOld(mks + i * 997);
+		formatter.format(mks + i * 997, buf);
+		same = SysStringLen(b) == aw::TimestampFormatter::SIZE;
+		for (size_t j = 0; same && j < aw::TimestampFormatter::SIZE; j++)
+			same = b[j] == static_cast<OLECHAR>(buf[j]);
+		SysFreeString(b);
+	}
+
+	// onData now: with and without a subscribed "tms" cell, excel refreshing every 1000 packets
+	std::vector<std::vector<char>> packets;
+	for (uint32_t i = 0; i < 1000; i++)
+		packets.push_back(makePacket(symbolName(i % 10), mks + i * 37, 100000000000, 101000000000, 1000));
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	auto refresh = [&](DataCache& cache) {
+		data.clear();
+		cache.get(data);
+		for (auto& it : data)
+			VariantClear(&it.second);
+	};
+	auto run = [&](bool with_tms) {
+		DataCache cache;
+		LONG topic_id = 0;
+		for (uint32_t i = 0; i < 10; i++) {
+			cache.add(symbolName(i), "bid", topic_id++);
+			if (with_tms)
+				cache.add(symbolName(i), "tms", topic_id++);
+		}
+		return nsPer(num_packets, [&](uint32_t i) {
+			const auto& p = packets[i % packets.size()];
+			cache.onData(p.data(), p.size());
+			if (i % 1000 == 999)
+				refresh(cache);
+		});
+	};
+	auto without_ns = run(false);
+	auto with_ns = run(true);
+	std::cout << "format before (stringstream + SysAllocString) ns/packet: " << old_ns << std::endl;
+	std::cout << "format after (cached second prefix) ns/packet: " << new_ns << std::endl;
+	std::cout << "onData ns/packet, tms not subscribed: " << without_ns << ", tms subscribed: " << with_ns << std::endl;
+	std::cout << "formatted text " << (same ? "matches" : "DIFFERS") << std::endl;
+	return same;
+}
+
+auto bars(uint32_t num_symbols, uint32_t num_ticks) -> bool
+{
+	const uint64_t intervals[] = { 1000000, 60000000, 300000000 }; // 1s, 1m, 5m
+	const int num_intervals = 3;
+	struct Tick
+	{
+		uint32_t m_symbol;
+		uint64_t m_mks;
+		double m_bid;
+		double m_ask;
+		double m_vol;
+	};
+	std::mt19937_64 rng(7);
+	std::vector<Tick> ticks;
+	std::vector<double> mids(num_symbols, 100.0);
+	std::vector<double> vols(num_symbols, 1000.0);
+	uint64_t mks = 1609770600000000ull; // 2021-01-04 14:30:00 UTC
+	for (uint32_t i = 0; i < num_ticks; i++) {
+		mks += rng() % 2000 == 0 ? 200000000 + rng() % 400000000 : rng() % 300000; // quiet spell now and then
+		uint32_t s = rng() % num_symbols;
+		mids[s] += (static_cast<double>(rng() % 201) - 100) / 100;
+		vols[s] += static_cast<double>(rng() % 500);
+		ticks.push_back(Tick{ s, mks, mids[s] - 0.05, mids[s] + 0.05, vols[s] });
+	}
+
+	// reference: group every tick by bar index
+	std::vector<std::vector<std::vector<Bar>>> expected(num_symbols, std::vector<std::vector<Bar>>(num_intervals));
+	std::vector<double> last_vol(num_symbols, -1);
+	for (const auto& t : ticks) {
+		double volume = last_vol[t.m_symbol] >= 0 ? t.m_vol - last_vol[t.m_symbol] : 0;
+		last_vol[t.m_symbol] = t.m_vol;
+		double mid = (t.m_bid + t.m_ask) / 2;
+		for (int iv = 0; iv < num_intervals; iv++) {
+			auto& list(expected[t.m_symbol][iv]);
+			uint64_t index = t.m_mks / intervals[iv];
+			if (list.empty() || list.back().m_index != index) {
+				Bar bar;
+				bar.m_index = index;
+				bar.m_open = bar.m_high = bar.m_low = mid;
+				list.push_back(bar);
+			}
+			Bar& bar(list.back());
+			bar.m_high = (std::max)(bar.m_high, mid);
+			bar.m_low = (std::min)(bar.m_low, mid);
+			bar.m_close = mid;
+			bar.m_volume += volume;
+			bar.m_ticks++;
+		}
+	}
+
+	// replay the way DataCache drives it: advance the shared wheel to packet time, then tick the symbol
+	// handle = symbol * 100 + interval * 10 + field, only completed bar fields are subscribed
+	std::vector<std::unique_ptr<BarTopics<int>>> topics;
+	for (uint32_t s = 0; s < num_symbols; s++) {
+		topics.push_back(std::make_unique<BarTopics<int>>());
+		for (int iv = 0; iv < num_intervals; iv++) {
+			for (int f = 0; f < BarTopics<int>::NUM_FIELDS; f++)
+				topics[s]->subscribe(f, true, intervals[iv], static_cast<int>(s * 100 + iv * 10 + f));
+		}
+	}
+	std::vector<std::vector<std::vector<double>>> published(num_symbols, std::vector<std::vector<double>>(num_intervals));
+	auto publish = [&](int handle, double value) {
+		published[handle / 100][(handle / 10) % 10].push_back(value);
+	};
+	aw::TimerWheel wheel;
+	auto start = std::chrono::steady_clock::now();
+	for (const auto& t : ticks) {
+		wheel.advance(t.m_mks / BarTopics<int>::WHEEL_UNIT_MKS, [&](aw::TimerNode& node) { BarTopics<int>::on_timer(node, publish); });
+		topics[t.m_symbol]->set(DerivedTopics::BID, t.m_bid);
+		topics[t.m_symbol]->set(DerivedTopics::ASK, t.m_ask);
+		topics[t.m_symbol]->set(DerivedTopics::VOL, t.m_vol);
+		topics[t.m_symbol]->tick(t.m_mks, wheel, publish);
+	}
+	wheel.advance(mks / BarTopics<int>::WHEEL_UNIT_MKS + 24 * 3600 * 1000, [&](aw::TimerNode& node) { BarTopics<int>::on_timer(node, publish); });
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	bool ok = true;
+	size_t num_bars = 0;
+	for (uint32_t s = 0; s < num_symbols && ok; s++) {
+		for (int iv = 0; iv < num_intervals && ok; iv++) {
+			const auto& exp(expected[s][iv]);
+			const auto& got(published[s][iv]);
+			num_bars += exp.size();
+			if (got.size() != exp.size() * BarTopics<int>::NUM_FIELDS) {
+				std::cout << "symbol " << s << " interval " << intervals[iv] << ": " << got.size() / BarTopics<int>::NUM_FIELDS << " bars closed, expected " << exp.size() << std::endl;
+				ok = false;
+				break;
+			}
+			for (size_t b = 0; b < exp.size() && ok; b++) {
+				const double* g = &got[b * BarTopics<int>::NUM_FIELDS];
+				double e[] = { exp[b].m_open, exp[b].m_high, exp[b].m_low, exp[b].m_close, exp[b].m_volume };
+				for (int f = 0; f < BarTopics<int>::NUM_FIELDS; f++) {
+					if (std::fabs(g[f] - e[f]) > 1e-9 * (std::max)(1.0, std::fabs(e[f]))) {
+						std::cout << "symbol " << s << " interval " << intervals[iv] << " bar " << b << " field " << f << ": " << g[f] << " expected " << e[f] << std::endl;
+						ok = false;
+					}
+				}
+			}
+		}
+	}
+	std::cout << "ticks: " << num_ticks << ", bars checked: " << num_bars << ", ns/tick: " << static_cast<double>(ns) / num_ticks << std::endl;
+	return ok;
+}
+
+// mid/spread/vwap/chg: DerivedTopics only calculates outputs whose inputs came in, then symbols with and without
+// "cls" fed through onData must match values computed from the packets, a packet marks exactly the outputs that moved
+auto derived(uint32_t num_packets) -> bool
+{
+	bool ok = true;
+	DerivedTopics topics;
+	for (int o = 0; o < DerivedTopics::NUM_OUTPUTS; o++)
+		topics.subscribe(o);
+	uint32_t published = 0;
+	auto step = [&](const char* what, uint64_t computed, uint32_t moved) {
+		uint64_t before = topics.computed();
+		published = 0;
+		topics.compute([&](int, double) { published++; });
+		if (topics.computed() - before != computed || published != moved) {
+			std::cout << what << ": calculated " << topics.computed() - before << ", published " << published
+				<< ", expected " << computed << " and " << moved << std::endl;
+			ok = false;
+		}
+	};
+	topics.set(DerivedTopics::BID, 100);
+	topics.set(DerivedTopics::ASK, 101);
+	topics.set(DerivedTopics::VOL, 1000);
+	step("first quote", 4, 3); // vwap has no traded volume yet
+	topics.set(DerivedTopics::VOL, 1100);
+	step("volume only", 1, 1);
+	topics.set(DerivedTopics::BID, 100);
+	topics.set(DerivedTopics::ASK, 101);
+	step("same quote", 3, 0);
+	topics.set(DerivedTopics::CLS, 99);
+	step("close only", 1, 1);
+	step("nothing", 0, 0);
+
+	// A never sends "cls" (chg against its first mid), B does and moves it now and then
+	DataCache cache;
+	const char* names[] = { "mid", "spread", "vwap", "chg" };
+	const std::string symbols[] = { "A", "B" };
+	for (LONG s = 0; s < 2; s++) {
+		for (LONG o = 0; o < DerivedTopics::NUM_OUTPUTS; o++)
+			cache.add(symbols[s], names[o], s * DerivedTopics::NUM_OUTPUTS + o);
+	}
+	struct Reference
+	{
+		int64_t m_bid = 0, m_ask = 0, m_vol = 0, m_cls = 0;
+		bool m_quoted = false;
+		double m_pv = 0, m_v = 0, m_first = 0;
+		double m_out[DerivedTopics::NUM_OUTPUTS] = { NAN, NAN, NAN, NAN };
+	};
+	Reference refs[2];
+	std::mt19937_64 rng(23);
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	uint32_t marked = 0, unchanged = 0;
+	for (uint32_t i = 0; i < num_packets && ok; i++) {
+		uint32_t s = static_cast<uint32_t>(rng() % 2);
+		Reference& r(refs[s]);
+		uint32_t kind = r.m_quoted ? static_cast<uint32_t>(rng() % 4) : 0; // 0 quote, 1 volume, 2 repeat, 3 close
+		double mid = static_cast<double>(r.m_bid) / SCALE / 2 + static_cast<double>(r.m_ask) / SCALE / 2;
+		std::vector<PacketField> fields;
+		if (kind == 0) {
+			r.m_bid = 100000000000 + static_cast<int64_t>(rng() % 100) * 10000000;
+			r.m_ask = r.m_bid + 10000000 * static_cast<int64_t>(1 + rng() % 3);
+			mid = (static_cast<double>(r.m_bid) / SCALE + static_cast<double>(r.m_ask) / SCALE) / 2;
+		}
+		if (kind == 0 || kind == 2) {
+			fields.push_back(PacketField{ "bid", 2, r.m_bid });
+			fields.push_back(PacketField{ "ask", 2, r.m_ask });
+		}
+		if (kind == 0 || kind == 1) {
+			int64_t vol = r.m_vol + static_cast<int64_t>(rng() % 3) * 100;
+			if (r.m_quoted && vol > r.m_vol) { // first volume only sets the start
+				r.m_pv += mid * static_cast<double>(vol - r.m_vol);
+				r.m_v += static_cast<double>(vol - r.m_vol);
+			}
+			r.m_vol = vol;
+		}
+		if (kind == 0 || kind == 1 || kind == 2)
+			fields.push_back(PacketField{ "vol", 1, r.m_vol });
+		if (s == 1 && (kind == 3 || !r.m_quoted)) {
+			r.m_cls = 99000000000 + static_cast<int64_t>(rng() % 100) * 10000000;
+			fields.push_back(PacketField{ "cls", 2, r.m_cls });
+		}
+		else if (kind == 3)
+			fields.push_back(PacketField{ "vol", 1, r.m_vol }); // A has no close, same volume again
+		if (!r.m_quoted)
+			r.m_first = mid;
+		r.m_quoted = true;
+		auto p = makePacket(symbols[s], i + 1, fields);
+		cache.onData(p.data(), p.size());
+
+		double ref = s == 1 ? static_cast<double>(r.m_cls) / SCALE : r.m_first;
+		double expected[DerivedTopics::NUM_OUTPUTS] = { mid, static_cast<double>(r.m_ask) / SCALE - static_cast<double>(r.m_bid) / SCALE,
+			r.m_v > 0 ? r.m_pv / r.m_v : NAN, (mid - ref) / ref * 100 };
+		std::map<LONG, double> got;
+		data.clear();
+		cache.get(data);
+		for (auto& it : data) {
+			got[it.first.lVal] = it.second.dblVal;
+			VariantClear(&it.second);
+		}
+		for (LONG o = 0; o < DerivedTopics::NUM_OUTPUTS; o++) {
+			LONG id = static_cast<LONG>(s) * DerivedTopics::NUM_OUTPUTS + o;
+			bool moved = !std::isnan(expected[o]) && expected[o] != r.m_out[o];
+			auto it = got.find(id);
+			if (moved != (it != got.end()) || (moved && std::fabs(it->second - expected[o]) > 1e-9 * std::fabs(expected[o]))) {
+				std::cout << "packet " << i << " " << symbols[s] << "." << names[o] << ": " << (it == got.end() ? "not marked" : std::to_string(it->second))
+					<< ", expected " << (moved ? std::to_string(expected[o]) : "not marked") << std::endl;
+				ok = false;
+			}
+			if (moved)
+				r.m_out[o] = expected[o];
+			moved ? marked++ : unchanged++;
+		}
+		if (got.size() > static_cast<size_t>(DerivedTopics::NUM_OUTPUTS) || (!got.empty() && got.begin()->first / DerivedTopics::NUM_OUTPUTS != static_cast<LONG>(s))) {
+			std::cout << "packet " << i << " of " << symbols[s] << " marked another symbol's outputs" << std::endl;
+			ok = false;
+		}
+	}
+	std::cout << "packets: " << num_packets << ", outputs marked: " << marked << ", unchanged and not marked: " << unchanged << std::endl;
+	return ok;
+}
+
+// hi/lo/vol/tck over 1 minute of one symbol against the packets, a second symbol keeps the feed clock going while the
+// first goes quiet long enough for its windows to drain, then it ticks again
+auto rolling(uint32_t num_packets) -> bool
+{
+	const uint64_t window = 60000000, width = window / RollingWindow::BUCKETS;
+	DataCache cache;
+	const char* topics[] = { "hi1m", "lo1m", "vol1m", "tck1m" };
+	for (LONG id = 0; id < 4; id++)
+		cache.add("SYM", topics[id], id);
+	cache.add("OTHER", "bid", 4);
+	struct Tick
+	{
+		uint64_t m_mks;
+		double m_mid;
+		double m_vol; // delta, the feed sends it cumulative
+	};
+	std::vector<Tick> sent;
+	std::map<LONG, double> last; // NaN: empty
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	std::mt19937_64 rng(31);
+	uint64_t mks = 1609770600000000ull;
+	int64_t vol = 0;
+	bool ok = true, drained = false;
+	uint32_t checks = 0;
+	auto send = [&](bool sym) {
+		mks += (1 + rng() % 400) * 1000; // whole ms: bucket edges and the wheel's unit line up
+		int64_t b = 100000000000 + static_cast<int64_t>(rng() % 1000) * 10000000;
+		int64_t a = b + 10000000 * static_cast<int64_t>(1 + rng() % 3);
+		if (sym) {
+			int64_t prev = vol;
+			vol += rng() % 500;
+			sent.push_back(Tick{ mks, (static_cast<double>(b) / SCALE + static_cast<double>(a) / SCALE) / 2,
+				sent.empty() ? 0.0 : static_cast<double>(vol - prev) });
+		}
+		auto p = makePacket(sym ? "SYM" : "OTHER", mks, b, a, vol);
+		cache.onData(p.data(), p.size());
+	};
+	// reference: every packet of a bucket that is still in the window at the feed's time
+	auto check = [&]() {
+		data.clear();
+		cache.get(data);
+		for (auto& it : data) {
+			last[it.first.lVal] = it.second.vt == VT_EMPTY ? NAN : it.second.dblVal;
+			VariantClear(&it.second);
+		}
+		uint64_t oldest = mks / width >= RollingWindow::BUCKETS ? mks / width - RollingWindow::BUCKETS + 1 : 0;
+		double hi = NAN, lo = NAN, volume = 0, ticks = 0;
+		for (auto it = sent.rbegin(); it != sent.rend() && it->m_mks / width >= oldest; ++it) {
+			hi = std::isnan(hi) ? it->m_mid : (std::max)(hi, it->m_mid);
+			lo = std::isnan(lo) ? it->m_mid : (std::min)(lo, it->m_mid);
+			volume += it->m_vol;
+			ticks++;
+		}
+		double expected[] = { hi, lo, volume, ticks };
+		for (LONG id = 0; id < 4; id++) {
+			auto it = last.find(id);
+			double got = it == last.end() ? NAN : it->second;
+			// vol/tck of a window that never had a tick were never published
+			if (it == last.end() && id >= 2 && expected[id] == 0)
+				continue;
+			if (std::isnan(got) != std::isnan(expected[id]) || (!std::isnan(got) && std::fabs(got - expected[id]) > 1e-9)) {
+				std::cout << topics[id] << " at " << mks << ": " << got << ", expected " << expected[id] << std::endl;
+				ok = false;
+			}
+		}
+		checks++;
+		return ticks == 0;
+	};
+	for (uint32_t i = 0; i < num_packets && ok; i++) {
+		send(rng() % 3 != 0);
+		check();
+	}
+	// SYM goes quiet for 90s, its windows must empty on OTHER's packets alone
+	for (uint64_t quiet = mks + 90000000; mks < quiet && ok;) {
+		send(false);
+		drained = check();
+	}
+	if (!drained || last[0] == last[0] || last[1] == last[1] || last[2] != 0 || last[3] != 0) {
+		std::cout << "after the quiet spell: hi " << last[0] << ", lo " << last[1] << ", vol " << last[2] << ", tck " << last[3] << std::endl;
+		ok = false;
+	}
+	for (uint32_t i = 0; i < num_packets && ok; i++) {
+		send(rng() % 3 != 0);
+		check();
+	}
+	std::cout << "packets: " << 2 * num_packets << " + quiet spell, checks: " << checks << ", SYM ticks: " << sent.size() << std::endl;
+	return ok;
+}
+
+auto expr(uint32_t num_symbols, uint32_t num_packets) -> bool
+{
+	bool ok = true;
+	// parser: text, value with a = 2, b = 10 (NaN: must not parse)
+	struct Case
+	{
+		const char* m_text;
+		double m_value;
+	};
+	const Case cases[] = {
+		{ "A.bid-B.ask*0.5", 2 - 10 * 0.5 }, { "(A.bid - B.ask) * 0.5", (2 - 10) * 0.5 }, { "-A.bid/-B.ask", 0.2 },
+		{ "A.bid+A.bid+A.bid", 6 }, { "BRK.B.bid*1e3", 10000 }, { "1.5", 1.5 }, { "2-3-4", -5 }, { "8/4/2", 1 },
+		{ "A.bid-", NAN }, { "(A.bid", NAN }, { "A", NAN }, { ".bid", NAN }, { "A.", NAN }, { "nan", NAN }, { "A.bid B.ask", NAN }, { "", NAN },
+	};
+	for (const auto& c : cases) {
+		Expression e;
+		std::string error;
+		bool parsed = e.parse(c.m_text, error);
+		if (!parsed) {
+			if (!std::isnan(c.m_value)) {
+				std::cout << "<" << c.m_text << "> didn't parse: " << error << std::endl;
+				ok = false;
+			}
+			continue;
+		}
+		std::vector<double> in;
+		for (const auto& ref : e.refs())
+			in.push_back(ref.first == "A" ? 2 : 10);
+		double value = e.eval(in.data());
+		if (std::isnan(c.m_value) || std::fabs(value - c.m_value) > 1e-12) {
+			std::cout << "<" << c.m_text << "> = " << value << ", expected " << c.m_value << std::endl;
+			ok = false;
+		}
+	}
+
+	// spread of every symbol against the next one, plus one basket of every symbol's mid
+	DataCache cache;
+	LONG topic_id = 0;
+	std::string basket = "(";
+	for (uint32_t i = 0; i < num_symbols; i++) {
+		std::string error;
+		ok &= cache.add_expression(symbolName(i) + ".bid-" + symbolName((i + 1) % num_symbols) + ".ask*0.5", topic_id++, error);
+		basket += (i ? "+" : "") + symbolName(i) + ".mid";
+	}
+	basket += ")/" + std::to_string(num_symbols);
+	std::string error;
+	ok &= cache.add_expression(basket, topic_id++, error);
+	LONG quote_id = topic_id++;
+	cache.add(symbolName(0), "bid", quote_id); // same cell as an expression input
+	std::mt19937_64 rng(11);
+	std::vector<double> bid(num_symbols, NAN), ask(num_symbols, NAN);
+	std::map<LONG, double> last;
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	auto refresh = [&]() {
+		data.clear();
+		cache.get(data);
+		for (auto& it : data) {
+			last[it.first.lVal] = it.second.dblVal;
+			VariantClear(&it.second);
+		}
+	};
+	uint32_t refreshes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < num_packets; i++) {
+		uint32_t s = static_cast<uint32_t>(rng() % num_symbols);
+		int64_t b = 100000000000 + static_cast<int64_t>(rng() % 1000) * 10000000;
+		int64_t a = b + 10000000;
+		bid[s] = static_cast<double>(b) / SCALE;
+		ask[s] = static_cast<double>(a) / SCALE;
+		auto p = makePacket(symbolName(s), i + 1, b, a, i);
+		cache.onData(p.data(), p.size());
+		if (i % 10 == 9 || i + 1 == num_packets) { // excel refreshing every 10 packets
+			refresh();
+			refreshes++;
+		}
+	}
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	auto check = [&](LONG id, double expected) {
+		if (std::isnan(expected))
+			return;
+		auto it = last.find(id);
+		if (it == last.end() || std::fabs(it->second - expected) > 1e-9 * std::fabs(expected)) {
+			std::cout << "topic_id " << id << ": " << (it == last.end() ? NAN : it->second) << ", expected " << expected << std::endl;
+			ok = false;
+		}
+	};
+	double mids = 0;
+	for (uint32_t i = 0; i < num_symbols; i++) {
+		check(static_cast<LONG>(i), bid[i] - ask[(i + 1) % num_symbols] * 0.5);
+		mids += (bid[i] + ask[i]) / 2;
+	}
+	check(static_cast<LONG>(num_symbols), mids / num_symbols);
+	check(quote_id, bid[0]);
+	auto st = cache.stats();
+	std::cout << "expressions: " << st.m_expressions << ", refreshes: " << refreshes << ", evaluated: " << st.m_evaluated
+		<< " (every expression every refresh would be " << static_cast<uint64_t>(st.m_expressions) * refreshes << ")" << std::endl;
+	std::cout << "packets: " << num_packets << ", ns/packet incl. refresh: " << static_cast<double>(ns) / num_packets << std::endl;
+
+	// expressions gone: only the quote cell is left
+	for (LONG id = 0; id <= static_cast<LONG>(num_symbols); id++)
+		ok &= cache.remove(id);
+	st = cache.stats();
+	if (st.m_expressions != 0 || st.m_symbols != 1 || st.m_cells != 1 || st.m_topic_ids != 1) {
+		std::cout << "after removing expressions: expressions " << st.m_expressions << ", symbols " << st.m_symbols << ", cells " << st.m_cells << ", topic ids " << st.m_topic_ids << std::endl;
+		ok = false;
+	}
+	return ok;
+}
+
+auto optionsChain(uint32_t num_strikes) -> bool
+{
+	const char* outputs[] = { "iv", "delta", "gamma", "vega" };
+	const uint64_t mks = static_cast<uint64_t>(options::days_from_civil(2024, 1, 2) * 86400 + 15 * 3600) * 1000000;
+	DataCache cache;
+	LONG topic_id = 0;
+	std::vector<std::string> symbols;
+	for (uint32_t i = 0; i < num_strikes; i++) {
+		char symbol[32];
+		snprintf(symbol, sizeof(symbol), "IBM   240315%c%08u", i % 2 ? 'P' : 'C', (100 + i / 2) * 1000);
+		symbols.push_back(symbol);
+		for (const char* output : outputs)
+			cache.add(symbol, output, topic_id++);
+	}
+	bool ok = cache.stats().m_options == num_strikes && cache.stats().m_symbols == num_strikes + 1; // underlying came with the chain
+	std::map<LONG, double> last;
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	auto refresh = [&]() {
+		data.clear();
+		cache.get(data);
+		for (auto& it : data) {
+			last[it.first.lVal] = it.second.dblVal;
+			VariantClear(&it.second);
+		}
+		return data.size();
+	};
+	// option quotes first: no spot yet, nothing to publish
+	for (uint32_t i = 0; i < num_strikes; i++) {
+		auto p = makePacket(symbols[i], mks, 4000000000 + i * 10000000, 4100000000 + i * 10000000, 10);
+		cache.onData(p.data(), p.size());
+	}
+	ok &= refresh() == 0;
+	auto p = makePacket("IBM", mks, 104950000000, 105050000000, 1000);
+	cache.onData(p.data(), p.size());
+	size_t first = refresh();
+	auto computed = cache.stats().m_options_computed;
+	// same underlying mid again (only volume moved): nothing to solve
+	p = makePacket("IBM", mks + 1000, 104950000000, 105050000000, 2000);
+	cache.onData(p.data(), p.size());
+	ok &= refresh() == 0 && cache.stats().m_options_computed == computed;
+	// underlying moves: every leg is solved again, one batch
+	p = makePacket("IBM", mks + 2000, 105950000000, 106050000000, 3000);
+	cache.onData(p.data(), p.size());
+	size_t second = refresh();
+	std::cout << "legs: " << num_strikes << ", first spot published " << first << ", second " << second
+		<< ", solves: " << cache.stats().m_options_computed << std::endl;
+	ok &= first > 0 && second > 0 && cache.stats().m_options_computed == computed + num_strikes;
+	// published iv reprices the option mid
+	for (uint32_t i = 0; i < num_strikes; i++) {
+		auto it = last.find(static_cast<LONG>(i * 4));
+		if (it == last.end())
+			continue;
+		options::Batch b;
+		b.resize(1);
+		options::Contract c;
+		options::parse_occ(symbols[i], c);
+		b.m_spot[0] = 106;
+		b.m_strike[0] = c.m_strike;
+		b.m_t[0] = static_cast<double>(c.m_expiry_mks - (mks + 2000)) / options::YEAR_MKS;
+		b.m_sign[0] = c.m_call ? 1 : -1;
+		b.m_price[0] = (4000000000.0 + i * 10000000 + 4100000000.0 + i * 10000000) / 2 / SCALE;
+		options::solve(b, 0);
+		if (std::fabs(b.m_iv[0] - it->second) > 1e-12) {
+			std::cout << symbols[i] << ": iv " << it->second << ", expected " << b.m_iv[0] << std::endl;
+			ok = false;
+		}
+	}
+	for (LONG id = 0; id < topic_id; id++)
+		ok &= cache.remove(id);
+	auto st = cache.stats();
+	if (st.m_symbols != 0 || st.m_options != 0) {
+		std::cout << "after unsubscribe: symbols " << st.m_symbols << ", options " << st.m_options << std::endl;
+		ok = false;
+	}
+	return ok;
+}
+
+// one quote every 100ms from 09:30 UTC, "bid@10:00" freezes half an hour in
+auto ticks(const std::string& dir, uint32_t num_packets) -> bool
+{
+	const uint64_t open_mks = static_cast<uint64_t>(options::days_from_civil(2024, 1, 2) * 86400 + 9 * 3600 + 30 * 60) * 1000000;
+	const uint64_t at_mks = open_mks + 30 * 60 * 1000000ull;
+	const std::string symbol = "TICK" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count() % 1000000); // fresh files every run
+	std::vector<std::pair<uint64_t, int64_t>> sent; // mks, bid
+	auto expected_at = [&]() {
+		double value = NAN;
+		for (auto& it : sent) {
+			if (it.first <= at_mks)
+				value = static_cast<double>(it.second) / SCALE;
+		}
+		return value;
+	};
+	auto expected_back = [&](size_t n) {
+		return n <= sent.size() ? static_cast<double>(sent[sent.size() - n].second) / SCALE : NAN;
+	};
+	auto send = [&](DataCache& cache, uint32_t i) {
+		uint64_t mks = open_mks + i * 100000ull;
+		int64_t bid = 100000000000 + static_cast<int64_t>((i * 7919) % 1000) * 10000000;
+		auto p = makePacket(symbol, mks, bid, bid + 10000000, i);
+		cache.onData(p.data(), p.size());
+		sent.emplace_back(mks, bid);
+	};
+	std::map<LONG, double> last;
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	auto refresh = [&](DataCache& cache) {
+		data.clear();
+		cache.get(data);
+		for (auto& it : data) {
+			last[it.first.lVal] = it.second.vt == VT_R8 ? it.second.dblVal : NAN;
+			VariantClear(&it.second);
+		}
+	};
+	auto value = [&](LONG id) {
+		auto it = last.find(id);
+		return it == last.end() ? NAN : it->second;
+	};
+	Configuration::instance().setTickStoreDir(dir);
+	bool ok = true;
+	double ns_stored = 0;
+	{
+		DataCache cache;
+		cache.add(symbol, "bid#3", 0);
+		cache.add(symbol, "bid@10:00", 1);
+		for (uint32_t i = 0; i < num_packets; i++) {
+			send(cache, i);
+			if (i % 1000 == 999) {
+				refresh(cache);
+				ok &= value(0) == expected_back(3) && value(1) == expected_at();
+			}
+		}
+		refresh(cache);
+		ok &= value(0) == expected_back(3) && value(1) == expected_at();
+		auto st = cache.stats();
+		ok &= st.m_ticks_stored == 3ull * num_packets && st.m_ticks_dropped == 0;
+		if (!ok)
+			std::cout << "history topics: bid#3 " << value(0) << " expected " << expected_back(3) << ", bid@10:00 " << value(1) << " expected " << expected_at() << std::endl;
+		// cost per packet with history on
+		ns_stored = nsPer(num_packets, [&](uint32_t i) {
+			send(cache, num_packets + i);
+		});
+	}
+	double ns_plain = 0;
+	{
+		Configuration::instance().setTickStoreDir("");
+		DataCache cache;
+		cache.add(symbol, "bid", 0);
+		ns_plain = nsPer(num_packets, [&](uint32_t i) {
+			uint64_t mks = open_mks + i * 100000ull;
+			auto p = makePacket(symbol, mks, 100000000000, 100010000000, i);
+			cache.onData(p.data(), p.size());
+		});
+		Configuration::instance().setTickStoreDir(dir);
+	}
+	// another reader maps the same files, no parse
+	std::string path = dir + "/" + symbol;
+	{
+		TickLog log(path);
+		uint64_t rows = log.rows(), bids = 0;
+		log.visit(open_mks, at_mks, [&](uint64_t, uint32_t topic, double) {
+			bids += topic == TickLog::code("bid");
+		});
+		double at = NAN;
+		log.at(TickLog::code("bid"), at_mks, 0, at);
+		std::cout << "rows: " << rows << " in " << log.segments() << " segments, bids up to 10:00: " << bids << std::endl;
+		ok &= rows == 3ull * sent.size() && at == expected_at() && bids == (std::min)(static_cast<uint64_t>(sent.size()), static_cast<uint64_t>(30 * 60 * 10 + 1));
+	}
+	// restart: values are there before the first packet
+	{
+		last.clear();
+		DataCache cache;
+		cache.add(symbol, "bid#1", 0);
+		cache.add(symbol, "bid@10:00", 1);
+		refresh(cache);
+		ok &= value(0) == expected_back(1) && value(1) == expected_at();
+		send(cache, 2 * num_packets);
+		refresh(cache);
+		ok &= value(0) == expected_back(1);
+		if (!ok)
+			std::cout << "after restart: bid#1 " << value(0) << " expected " << expected_back(1) << std::endl;
+		// unsubscribed: log unmapped, a new subscriber maps it again with the history
+		ok &= cache.remove(0) && cache.remove(1);
+		size_t released = cache.stats().m_tick_logs;
+		last.clear();
+		cache.add(symbol, "bid#1", 2);
+		refresh(cache);
+		size_t reopened = cache.stats().m_tick_logs;
+		if (released != 0 || reopened != 1 || value(2) != expected_back(1)) {
+			std::cout << "tick logs mapped after unsubscribe: " << released << ", after resubscribe: " << reopened
+				<< ", bid#1 " << value(2) << " expected " << expected_back(1) << std::endl;
+			ok = false;
+		}
+	}
+	std::cout << "ns per packet, history on: " << ns_stored << ", off: " << ns_plain << std::endl;
+	for (int seq = 0; std::remove((path + "." + std::to_string(seq) + ".tick").c_str()) == 0; seq++)
+		;
+	return ok;
+}
+
+// bid (VT_R8) and vol (VT_I8) per symbol, so num cells / 2 symbols
+auto snapshot(const std::string& file, uint32_t num_cells) -> bool
+{
+	const uint32_t num_symbols = (std::max)(num_cells / 2, 2u);
+	const uint64_t mks = 1700000000000000ull;
+	auto bid = [](uint32_t i, int run) { return 100000000000 + static_cast<int64_t>(i) * 10000000 + run * 1000000; };
+	for (int i = 0; i < 2; i++)
+		std::remove((file + "." + std::to_string(i)).c_str());
+	Configuration::instance().setSnapshotFile(file);
+	bool ok = true;
+	auto ms = [](std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+	};
+	double checkpoint_ms = 0;
+	{
+		DataCache cache;
+		LONG topic_id = 0;
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			cache.add(symbolName(i), "bid", topic_id++);
+			cache.add(symbolName(i), "vol", topic_id++);
+			auto p = makePacket(symbolName(i), mks, bid(i, 0), bid(i, 0) + 10000000, i);
+			cache.onData(p.data(), p.size());
+		}
+		auto start = std::chrono::steady_clock::now();
+		ok &= cache.checkpoint();
+		checkpoint_ms = ms(start);
+		ok &= cache.stats().m_snapshot_entries == 2ull * num_symbols;
+	}
+	// restart: loading is mapping the file, then every ConnectData has its value, symbol reads stale until its first packet
+	double load_ms = 0, connect_ns = 0;
+	{
+		auto start = std::chrono::steady_clock::now();
+		Snapshot loaded(file);
+		load_ms = ms(start);
+		ok &= loaded.entries() == 2ull * num_symbols;
+	}
+	{
+		DataCache cache;
+		auto start = std::chrono::steady_clock::now();
+		LONG topic_id = 0;
+		uint32_t wrong = 0;
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			VARIANT b, v;
+			bool known = cache.add(symbolName(i), "bid", topic_id++, &b) && cache.add(symbolName(i), "vol", topic_id++, &v);
+			if (!known || b.vt != VT_R8 || b.dblVal != static_cast<double>(bid(i, 0)) / SCALE || v.vt != VT_I8 || v.llVal != i)
+				wrong++;
+		}
+		connect_ns = ms(start) * 1e6 / (2.0 * num_symbols);
+		VARIANT stale;
+		ok &= cache.add(symbolName(0), "stale", topic_id++, &stale) && stale.dblVal == 1;
+		auto p = makePacket(symbolName(0), mks + 1000, bid(0, 1), bid(0, 1) + 10000000, 0);
+		cache.onData(p.data(), p.size());
+		std::vector<std::pair<VARIANT, VARIANT>> data;
+		cache.get(data);
+		bool fresh = false;
+		for (auto& it : data)
+			fresh |= it.first.lVal == topic_id - 1 && it.second.dblVal == 0;
+		ok &= fresh && wrong == 0 && cache.stats().m_seeded == 2ull * num_symbols;
+		if (!ok)
+			std::cout << "after restart: " << wrong << " wrong values, stale cleared " << fresh << std::endl;
+		ok &= cache.checkpoint(); // other file, newer generation
+	}
+	// second restart sees the newer checkpoint, symbols nobody subscribed to in between are still there
+	{
+		Configuration::instance().setSnapshotFile(file);
+		DataCache cache;
+		VARIANT b0, b1;
+		ok &= cache.add(symbolName(0), "bid", 0, &b0) && b0.dblVal == static_cast<double>(bid(0, 1)) / SCALE;
+		ok &= cache.add(symbolName(1), "bid", 1, &b1) && b1.dblVal == static_cast<double>(bid(1, 0)) / SCALE;
+		VARIANT none;
+		ok &= !cache.add("NOSUCHSYMBOL", "bid", 2, &none);
+	}
+	Configuration::instance().setSnapshotFile("");
+	std::cout << "cells: " << 2 * num_symbols << ", checkpoint ms: " << checkpoint_ms << ", load ms: " << load_ms
+		<< ", ConnectData with value ns: " << connect_ns << std::endl;
+	for (int i = 0; i < 2; i++)
+		std::remove((file + "." + std::to_string(i)).c_str());
+	return ok;
+}
+
+// small ring so the reader gets lapped and has to rescan now and then
+auto shm(uint32_t num_symbols, uint32_t num_updates) -> bool
+{
+	const char* topics[] = { "bid", "ask", "vol" };
+	const std::string name = "awtest" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count() % 1000000);
+	uint64_t slots = 1024;
+	while (slots < num_symbols * 3ull * 2)
+		slots *= 2;
+	lastvalues::Writer writer;
+	if (!writer.open(name, slots, 1 << 12)) {
+		std::cout << "couldn't create shared memory " << name << std::endl;
+		return false;
+	}
+	lastvalues::Reader reader;
+	bool ok = reader.open(name);
+	std::vector<int64_t> expected(num_symbols * 3ull, 0);
+	std::map<std::string, int64_t> seen;
+	auto collect = [&](const lastvalues::Value& v) {
+		seen[std::string(v.m_symbol, strnlen(v.m_symbol, sizeof(v.m_symbol))) + "." + v.m_topic] = v.m_value;
+	};
+	std::atomic<bool> done(false);
+	auto start = std::chrono::steady_clock::now();
+	std::thread feed([&]() {
+		std::mt19937_64 rng(7);
+		for (uint32_t i = 0; i < num_updates; i++) {
+			uint32_t key = static_cast<uint32_t>(rng() % expected.size());
+			int64_t value = 1 + i;
+			writer.update(symbolName(key / 3).c_str(), topics[key % 3], key % 3 == 2 ? 1 : 2, value, i);
+			expected[key] = value;
+		}
+		done = true;
+	});
+	uint64_t polls = 0, handed = 0;
+	while (!done) {
+		handed += reader.poll(collect);
+		polls++;
+	}
+	feed.join();
+	double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()) / num_updates;
+	handed += reader.poll(collect);
+	uint32_t wrong = 0;
+	for (size_t key = 0; key < expected.size(); key++) {
+		auto it = seen.find(symbolName(static_cast<uint32_t>(key / 3)) + "." + topics[key % 3]);
+		if (expected[key] ? (it == seen.end() || it->second != expected[key]) : it != seen.end())
+			wrong++;
+	}
+	std::cout << "updates: " << num_updates << " at " << ns << " ns, reader polls: " << polls << ", changes handed out: " << handed
+		<< ", rescans: " << reader.rescans() << ", wrong last values: " << wrong << std::endl;
+	ok &= wrong == 0;
+	// DataCache on the table: subscribed symbols only, latest value per poll
+	Configuration::instance().setSharedFeed(name);
+	{
+		DataCache cache;
+		ok &= cache.open_shared_feed();
+		cache.add(symbolName(0), "bid", 0);
+		cache.add(symbolName(0), "vol", 1);
+		cache.poll_shared_feed();
+		writer.update(symbolName(0).c_str(), "bid", 2, 123 * static_cast<int64_t>(SCALE), 1);
+		writer.update(symbolName(0).c_str(), "vol", 1, 77, 1);
+		writer.update(symbolName(1).c_str(), "bid", 2, 1, 1);
+		cache.poll_shared_feed();
+		std::vector<std::pair<VARIANT, VARIANT>> data;
+		cache.get(data);
+		std::map<LONG, VARIANT> got;
+		for (auto& it : data)
+			got[it.first.lVal] = it.second;
+		ok &= got.size() == 2 && got[0].vt == VT_R8 && got[0].dblVal == 123 && got[1].vt == VT_I8 && got[1].llVal == 77 && cache.stats().m_filtered > 0;
+		if (!ok)
+			std::cout << "DataCache from shared feed: " << got.size() << " values" << std::endl;
+		// subscribed after its values were polled (and filtered out): ConnectData gets them from the table
+		writer.update(symbolName(1).c_str(), "cls", 2, 99 * static_cast<int64_t>(SCALE), 1);
+		cache.poll_shared_feed();
+		VARIANT bid, cls;
+		VariantInit(&bid);
+		VariantInit(&cls);
+		bool late = cache.add(symbolName(1), "bid", 2, &bid) && bid.vt == VT_R8 && bid.dblVal == 1 / SCALE
+			&& cache.add(symbolName(1), "cls", 3, &cls) && cls.vt == VT_R8 && cls.dblVal == 99;
+		if (!late)
+			std::cout << "late subscriber from shared feed: bid " << bid.dblVal << ", cls " << cls.dblVal << std::endl;
+		ok &= late;
+	}
+	Configuration::instance().setSharedFeed("");
+	// FeedHandler killed inside update(): its slot's lock stays odd, readers give up on it instead of spinning, a
+	// restarted writer on the same table evens it and the slot takes writes again
+	{
+		aw::MappedFile raw;
+		ok &= raw.open_shared(name, lastvalues::bytes(slots, 1 << 12)); // read/write, the dead writer's view
+		char sym[lastvalues::SYMBOL_SIZE], top[lastvalues::TOPIC_SIZE];
+		lastvalues::key(symbolName(0).c_str(), "bid", sym, top);
+		lastvalues::Slot* table = lastvalues::slots(raw.data());
+		uint64_t mask = reinterpret_cast<lastvalues::Header*>(raw.data())->m_slots - 1, i = lastvalues::hash(sym, top) & mask;
+		while (memcmp(table[i].m_symbol, sym, sizeof(sym)) != 0 || memcmp(table[i].m_topic, top, sizeof(top)) != 0)
+			i = (i + 1) & mask;
+		table[i].m_lock.fetch_add(1);
+		lastvalues::Value value;
+		bool dead = !reader.find(symbolName(0).c_str(), "bid", value);
+		lastvalues::Writer restarted;
+		ok &= restarted.open(name, slots, 1 << 12) && restarted.update(symbolName(0).c_str(), "bid", 2, 5, 2);
+		bool recovered = (table[i].m_lock.load() & 1) == 0 && reader.find(symbolName(0).c_str(), "bid", value) && value.m_value == 5;
+		if (!dead || !recovered)
+			std::cout << "dead writer's slot: reader " << (dead ? "gave up" : "read it") << ", after restart " << (recovered ? "ok" : "WRONG") << std::endl;
+		ok &= dead && recovered;
+	}
+	aw::MappedFile::remove_shared(name);
+	return ok;
+}
+
+// RefreshData every 100 packets, recorder a few times per run so the journal ring laps it
+auto journal(uint32_t num_symbols, uint32_t num_packets) -> bool
+{
+	const char* topics[] = { "bid", "ask", "vol" };
+	bool ok = true;
+	{
+		DataCache cache;
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			for (uint32_t t = 0; t < 3; t++)
+				cache.add(symbolName(i), topics[t], i * 3 + t);
+		}
+		uint32_t recorder = cache.add_consumer(true);
+		std::vector<double> expected(num_symbols * 3ull, NAN);
+		std::vector<double> refreshed(num_symbols * 3ull, NAN);
+		std::map<std::string, double> recorded;
+		uint64_t refreshes = 0, recorder_calls = 0;
+		auto refresh = [&]() {
+			std::vector<std::pair<VARIANT, VARIANT>> data;
+			cache.get(data);
+			for (auto& it : data) {
+				refreshed[it.first.lVal] = it.second.vt == VT_I8 ? static_cast<double>(it.second.llVal) : it.second.dblVal;
+				VariantClear(&it.second);
+			}
+			refreshes++;
+		};
+		auto record = [&]() {
+			cache.consume(recorder, [&](const std::string& symbol, const std::string& topic, const VARIANT& var, bool) {
+				recorded[symbol + "." + topic] = var.vt == VT_I8 ? static_cast<double>(var.llVal) : var.dblVal;
+			});
+			recorder_calls++;
+		};
+		std::mt19937 rng(11);
+		for (uint32_t i = 0; i < num_packets; i++) {
+			uint32_t sym = rng() % num_symbols;
+			auto p = makePacket(symbolName(sym), i + 1, (i + 1) * static_cast<int64_t>(SCALE), (i + 2) * static_cast<int64_t>(SCALE), i + 1);
+			cache.onData(p.data(), p.size());
+			for (uint32_t t = 0; t < 3; t++)
+				expected[sym * 3 + t] = i + 1.0 + (t == 1);
+			if (i % 100 == 99)
+				refresh();
+			if (i % (num_packets / 3 + 1) == num_packets / 3)
+				record();
+			if (i == num_packets / 2) {
+				// symbol 0 goes away and comes back, its journal slots are reused with a new generation
+				for (uint32_t t = 0; t < 3; t++)
+					cache.remove(t);
+				for (uint32_t t = 0; t < 3; t++) {
+					cache.add(symbolName(0), topics[t], t);
+					expected[t] = NAN;
+					refreshed[t] = NAN;
+					recorded.erase(symbolName(0) + "." + topics[t]);
+				}
+			}
+		}
+		refresh();
+		record();
+		uint32_t wrong_refresh = 0, wrong_recorded = 0;
+		for (size_t key = 0; key < expected.size(); key++) {
+			bool none = std::isnan(expected[key]);
+			if (none ? !std::isnan(refreshed[key]) : refreshed[key] != expected[key])
+				wrong_refresh++;
+			auto it = recorded.find(symbolName(static_cast<uint32_t>(key / 3)) + "." + topics[key % 3]);
+			if (none ? it != recorded.end() : (it == recorded.end() || it->second != expected[key]))
+				wrong_recorded++;
+		}
+		auto st = cache.stats();
+		std::cout << "packets: " << num_packets << ", journal records: " << st.m_journal_head << ", refreshes: " << refreshes << ", recorder calls: " << recorder_calls
+			<< ", rescans: " << st.m_journal_rescans << ", wrong refresh values: " << wrong_refresh << ", wrong recorded values: " << wrong_recorded << std::endl;
+		ok &= wrong_refresh == 0 && wrong_recorded == 0 && st.m_journal_rescans > 0;
+		cache.remove_consumer(recorder);
+	}
+	{
+		// a consumer joining at the head while no one has read yet still gets the next change of a cell already recorded
+		// (DataCache's views read on every packet, so the journal on its own)
+		ChangeJournal<int> changes;
+		uint32_t first = changes.add_consumer(false);
+		uint32_t slot = changes.add(7);
+		changes.touch(slot);
+		uint32_t late = changes.add_consumer(false);
+		changes.touch(slot);
+		size_t late_count = changes.consume(late, [](int) {});
+		std::cout << "late consumer: " << late_count << " change(s)" << std::endl;
+		ok &= late_count == 1 && changes.consume(first, [](int) {}) == 1;
+	}
+	// refresh cost follows the changes, not the subscribed cells
+	DataCache cache;
+	uint32_t num_cells = num_symbols * 100;
+	for (uint32_t i = 0; i < num_cells / 3; i++) {
+		for (uint32_t t = 0; t < 3; t++)
+			cache.add(symbolName(i), topics[t], i * 3 + t);
+	}
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	int64_t get_ns = 0;
+	for (uint32_t tick = 0; tick < 1000; tick++) {
+		for (uint32_t j = 0; j < 10; j++) {
+			auto p = makePacket(symbolName((tick * 10 + j) % (num_cells / 3)), tick + 1, 100, 101, tick);
+			cache.onData(p.data(), p.size());
+		}
+		for (auto& it : data)
+			VariantClear(&it.second);
+		data.clear();
+		auto start = std::chrono::steady_clock::now();
+		cache.get(data);
+		get_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+	std::cout << "cells: " << num_cells / 3 * 3 << ", 10 packets between refreshes, get(): " << get_ns / 1000 << " ns, " << data.size() << " values" << std::endl;
+	ok &= data.size() == 30;
+	for (auto& it : data)
+		VariantClear(&it.second);
+	return ok;
+}
+
+// bid/ask flickering by a tick or two, refresh after every packet: excel must get a value exactly when it moved
+// past the band from the last one it got, expressions on the same cell still see every change
+auto deadband(uint32_t num_packets) -> bool
+{
+	bool ok = true;
+	Deadband band;
+	ok &= !Deadband::parse("2x", 0.01, band) && !Deadband::parse("-1t", 0.01, band) && !Deadband::parse("1.5t", 0.01, band) && !Deadband::parse("t", 0.01, band);
+	ok &= !Deadband::parse("inft", 0.01, band) && !Deadband::parse("1e30t", 0.01, band) && !Deadband::parse("nan%", 0.01, band);
+	ok &= Deadband::parse("0", 0.01, band) && !band.enabled() && Deadband::parse("3t", 0.01, band) && band.m_ticks == 3 && band.m_tick_raw == 10000000;
+	ok &= Deadband::lookup("bid=1t,*=0.01%", "ask") == "0.01%" && Deadband::lookup("bid=1t,ask=3t", "ask") == "3t" && Deadband::lookup("bid=1t", "ask").empty();
+	if (!ok)
+		std::cout << "deadband spec parsing failed" << std::endl;
+	Configuration::instance().setDeadband("bid=2t");
+	Deadband relative;
+	Deadband::parse("0.05%", Configuration::instance().getTickSize(), relative);
+	DataCache cache;
+	Configuration::instance().setDeadband("");
+	cache.add("SYM0", "bid", 0); // from the Deadband setting
+	cache.add("SYM0", "ask", 1, nullptr, &relative); // 4th RTD argument
+	// bid on a second sheet with a relative band narrower than the setting's 2t at these prices: the narrower one holds
+	Deadband narrow;
+	Deadband::parse("0.01%", Configuration::instance().getTickSize(), narrow);
+	Deadband mixed; // "2t" with "0.05%" is a band, either with "0" is none
+	Deadband::parse("2t", 0.01, mixed);
+	ok &= mixed.tighter(relative).enabled() && mixed.tighter(relative).width(100 * static_cast<int64_t>(SCALE), false) == 2 * 10000000
+		&& mixed.tighter(narrow).width(100 * static_cast<int64_t>(SCALE), false) == 10000000 && !mixed.tighter(Deadband()).enabled();
+	if (!ok)
+		std::cout << "mixed tick and relative bands failed" << std::endl;
+	cache.add("SYM0", "bid", 3, nullptr, &narrow);
+	std::string error;
+	ok &= cache.add_expression("SYM0.bid*2", 2, error);
+	const int64_t tick = 10000000; // 0.01
+	int64_t bid = 100 * static_cast<int64_t>(SCALE), ask = bid + tick;
+	int64_t seen[2] = {};
+	bool has_seen[2] = {};
+	auto width = [&](int id) { // bid: narrower of 2t and 0.01%, ask: 0.05%
+		int64_t relative = static_cast<int64_t>(std::fabs(static_cast<double>(seen[id])) * (id == 0 ? 100 : 500) / 1e6);
+		return id == 0 ? (std::min)(2 * tick, relative) : relative;
+	};
+	uint64_t got = 0, wrong = 0, expr_got = 0;
+	std::mt19937 rng(5);
+	for (uint32_t i = 0; i < num_packets; i++) {
+		bid += (static_cast<int64_t>(rng() % 5) - 2) * tick;
+		ask = bid + tick * (1 + rng() % 3);
+		auto p = makePacket("SYM0", i + 1, bid, ask, 1000);
+		cache.onData(p.data(), p.size());
+		std::vector<std::pair<VARIANT, VARIANT>> data;
+		cache.get(data);
+		bool delivered[2] = {};
+		for (auto& it : data) {
+			LONG id = it.first.lVal;
+			if (id == 2) {
+				expr_got++;
+				wrong += it.second.dblVal != 2 * (static_cast<double>(bid) / SCALE);
+				continue;
+			}
+			if (id == 3) { // same cell as 0
+				wrong += std::llround(it.second.dblVal * SCALE) != bid;
+				continue;
+			}
+			int64_t raw = std::llround(it.second.dblVal * SCALE);
+			wrong += raw != (id == 0 ? bid : ask);
+			if (has_seen[id] && std::abs(raw - seen[id]) < width(id))
+				wrong++; // within the band of what excel had
+			delivered[id] = true;
+			seen[id] = raw;
+			has_seen[id] = true;
+			got++;
+		}
+		// what excel had before this refresh decides
+		int64_t feed[2] = { bid, ask };
+		for (int id = 0; id < 2; id++) {
+			if (delivered[id])
+				continue;
+			if (!has_seen[id] || std::abs(feed[id] - seen[id]) >= width(id))
+				wrong++;
+		}
+	}
+	auto st = cache.stats();
+	std::cout << "bid/ask changes: " << 2ull * num_packets << ", excel got: " << got << ", held: " << st.m_deadband_held
+		<< ", packets that woke nobody: " << st.m_deadband_quiet << ", expression values: " << expr_got << ", wrong: " << wrong << std::endl;
+	ok &= wrong == 0 && st.m_deadband_held > 0 && st.m_deadband_quiet > 0 && got + st.m_deadband_held == 2ull * num_packets && expr_got > 0;
+	return ok;
+}
+
+// simulated clock (10 us steps), no threads: feed phases per 10 s cycle, light sheet busy 0-3 s, heavy sheet busy 3-5 s,
+// idle 5-8 s, a packet every 200 ms 8-10 s; host (excel) is one thread: an UpdateNotify costs it 20 us and blocks
+// the notifier until dispatched, then it pulls (50 us + 1 us per change) and recalculates (2 ms light, 30 ms heavy)
+// old: UpdateNotify for every wake of the notify event (set per packet), new: NotifyPacer
+auto pacing(uint32_t seconds) -> bool
+{
+	const uint64_t STEP = 10, DISPATCH = 20, MIN_US = 10000, MAX_US = 2000000;
+	const char* phase_names[] = { "light", "heavy", "idle", "trickle" };
+	auto phase = [](uint64_t t) { uint64_t c = t % 10000000; return c < 3000000 ? 0 : c < 5000000 ? 1 : c < 8000000 ? 2 : 3; };
+	auto packet = [&](uint64_t t) { int p = phase(t); return p < 2 ? t % 50 == 0 : p == 3 && t % 200000 == 0; };
+	struct Result
+	{
+		uint64_t m_notifies[4] = {}, m_pulls[4] = {}, m_busy[4] = {}, m_packets[4] = {};
+		std::vector<uint64_t> m_staleness[4];
+		uint64_t m_max_per_second = 0, m_max_interval = 0;
+	};
+	auto run = [&](bool paced, Result& r) {
+		aw::NotifyPacer pacer(MIN_US, MAX_US);
+		std::vector<uint64_t> waiting; // packet times excel hasn't pulled yet
+		uint64_t busy_until = 0, free_at = 0, wake_at = 0, end = seconds * 1000000ull;
+		bool refresh_wanted = false, event = false;
+		std::map<uint64_t, uint64_t> per_second;
+		auto notify = [&](uint64_t t) {
+			uint64_t dispatched = (std::max)(t, busy_until) + DISPATCH;
+			r.m_busy[phase(t)] += DISPATCH;
+			busy_until = free_at = dispatched;
+			refresh_wanted = true;
+			r.m_notifies[phase(t)]++;
+			per_second[t / 1000000]++;
+		};
+		for (uint64_t t = 0; t < end || !waiting.empty(); t += STEP) {
+			if (t < end && packet(t)) {
+				waiting.push_back(t);
+				r.m_packets[phase(t)]++;
+				event |= paced ? pacer.changed() : true;
+			}
+			if (refresh_wanted && busy_until <= t) {
+				pacer.pulled(t);
+				for (uint64_t at : waiting)
+					r.m_staleness[phase(at)].push_back(t - at);
+				uint64_t cost = 50 + waiting.size() + (phase(t) == 1 ? 30000 : 2000);
+				waiting.clear();
+				busy_until = t + cost;
+				r.m_busy[phase(t)] += cost;
+				r.m_pulls[phase(t)]++;
+				refresh_wanted = false;
+			}
+			if (free_at > t)
+				continue;
+			if (!paced) {
+				if (event) {
+					event = false;
+					notify(t);
+				}
+			}
+			else if (event || t >= wake_at) {
+				event = false;
+				uint64_t wait_us = 0;
+				if (pacer.poll(t, wait_us)) {
+					notify(t);
+					wake_at = free_at;
+				}
+				else {
+					wake_at = t + wait_us;
+				}
+				if (phase(t) == 1)
+					r.m_max_interval = (std::max)(r.m_max_interval, pacer.interval());
+			}
+		}
+		for (auto& it : per_second)
+			r.m_max_per_second = (std::max)(r.m_max_per_second, it.second);
+	};
+	Result old_r, new_r;
+	run(false, old_r);
+	run(true, new_r);
+	double phase_seconds[] = { 0.3 * seconds, 0.2 * seconds, 0.3 * seconds, 0.2 * seconds };
+	auto report = [&](const char* name, Result& r) {
+		for (int p = 0; p < 4; p++) {
+			auto& s(r.m_staleness[p]);
+			std::sort(s.begin(), s.end());
+			double avg = 0;
+			for (uint64_t v : s)
+				avg += static_cast<double>(v) / (s.empty() ? 1 : s.size());
+			std::cout << name << " " << phase_names[p] << ": packets/s " << r.m_packets[p] / phase_seconds[p] << ", notifies/s " << r.m_notifies[p] / phase_seconds[p]
+				<< ", pulls/s " << r.m_pulls[p] / phase_seconds[p] << ", excel busy " << 100.0 * r.m_busy[p] / (phase_seconds[p] * 1e6) << "%"
+				<< ", staleness us avg " << avg << " p99 " << (s.empty() ? 0 : s[s.size() * 99 / 100]) << " max " << (s.empty() ? 0 : s.back()) << std::endl;
+		}
+	};
+	report("per packet", old_r);
+	report("paced", new_r);
+	std::cout << "paced: most notifies in one second " << new_r.m_max_per_second << ", widest interval on the heavy sheet " << new_r.m_max_interval << " us" << std::endl;
+	bool ok = new_r.m_max_per_second <= 1000000 / MIN_US + 1; // at most one per interval
+	ok &= !new_r.m_staleness[3].empty() && new_r.m_staleness[3].back() < 1000; // after idle: right away
+	ok &= new_r.m_max_interval > MIN_US; // widened while excel was slow
+	ok &= new_r.m_notifies[0] < old_r.m_notifies[0];
+	return ok;
+}
+
+// simulated clock: every cell changes at once, then random changes at 100k/s for 5 s, then the feed stops and excel
+// drains; excel takes 1 ms + 2 us per value to apply a refresh and refreshes again right after
+// 10% of cells hot, 30% normal, 60% cold, a value is its change time so staleness is refresh time - value
+// unbounded (one giant array) vs MaxRefreshBatch, longest refresh is how long excel froze
+auto batches(uint32_t num_cells, uint32_t batch) -> bool
+{
+	const char* class_names[] = { "hot", "normal", "cold" };
+	auto priority = [](uint32_t i) { return i % 10 == 0 ? RefreshQueue::HOT : i % 10 < 4 ? RefreshQueue::NORMAL : RefreshQueue::COLD; };
+	bool ok = true;
+	for (uint32_t max_batch : { 0u, batch }) {
+		Configuration::instance().setMaxRefreshBatch(max_batch);
+		DataCache cache;
+		Configuration::instance().setMaxRefreshBatch(0);
+		for (uint32_t i = 0; i < num_cells; i++)
+			cache.add(symbolName(i), "bid", i, nullptr, nullptr, priority(i));
+		std::vector<double> expected(num_cells, NAN), refreshed(num_cells, NAN);
+		auto change = [&](uint32_t i, uint64_t t) {
+			VARIANT var;
+			VariantInit(&var);
+			var.vt = VT_R8;
+			var.dblVal = static_cast<double>(t);
+			cache.update(symbolName(i), { std::make_pair(std::string("bid"), var) }, t);
+			expected[i] = static_cast<double>(t);
+		};
+		for (uint32_t i = 0; i < num_cells; i++)
+			change(i, 0);
+		std::vector<double> staleness[RefreshQueue::NUM_PRIORITIES];
+		std::mt19937 rng(3);
+		const uint64_t END = 5000000, RATE = 100000;
+		uint64_t t = 0, fed = 0, refreshes = 0, longest = 0;
+		size_t largest = 0;
+		while (true) {
+			std::vector<std::pair<VARIANT, VARIANT>> data;
+			cache.get(data);
+			if (data.empty() && t >= END)
+				break;
+			for (auto& it : data) {
+				LONG id = it.first.lVal;
+				staleness[priority(id)].push_back(static_cast<double>(t) - it.second.dblVal);
+				refreshed[id] = it.second.dblVal;
+			}
+			uint64_t cost = 1000 + 2 * data.size();
+			refreshes++;
+			longest = (std::max)(longest, cost);
+			largest = (std::max)(largest, data.size());
+			// feed while excel applies
+			uint64_t until = t + cost;
+			for (; t < END && fed * 1000000 / RATE < until; fed++)
+				change(rng() % num_cells, fed * 1000000 / RATE);
+			t = until;
+		}
+		uint32_t wrong = 0;
+		for (uint32_t i = 0; i < num_cells; i++)
+			wrong += refreshed[i] != expected[i];
+		auto st = cache.stats();
+		std::cout << "batch " << (max_batch ? std::to_string(max_batch) : std::string("unbounded")) << ": refreshes " << refreshes << ", largest " << largest
+			<< " values, longest refresh " << longest / 1000.0 << " ms, carried over " << st.m_refresh_carried << ", wrong last values " << wrong << std::endl;
+		double p99[RefreshQueue::NUM_PRIORITIES] = {};
+		for (int c = 0; c < RefreshQueue::NUM_PRIORITIES; c++) {
+			auto& s(staleness[c]);
+			std::sort(s.begin(), s.end());
+			p99[c] = s[s.size() * 99 / 100];
+			std::cout << "  " << class_names[c] << ": values " << s.size() << ", staleness ms p50 " << s[s.size() / 2] / 1000 << " p99 " << p99[c] / 1000
+				<< " max " << s.back() / 1000 << std::endl;
+		}
+		ok &= wrong == 0 && st.m_refresh_backlog == 0;
+		if (max_batch)
+			ok &= largest <= max_batch && p99[RefreshQueue::HOT] <= p99[RefreshQueue::COLD] && st.m_refresh_carried > 0;
+	}
+	return ok;
+}
+
+// feed thread at a steady rate while excel's thread refreshes every 20 ms (its recalculation in between), time spent
+// inside get() is what excel is blocked for, one cell disconnected for a refresh now and then must get nothing meanwhile
+auto blocked(uint32_t num_cells, uint32_t seconds) -> bool
+{
+	DataCache cache;
+	uint32_t num_tms = num_cells / 100;
+	for (uint32_t i = 0; i < num_cells; i++)
+		cache.add(symbolName(i), "bid", i);
+	for (uint32_t i = 0; i < num_tms; i++)
+		cache.add(symbolName(i), "tms", num_cells + i);
+	std::vector<double> expected(num_cells, NAN), refreshed(num_cells, NAN);
+	std::vector<bool> went_away(num_cells, false); // feed kept going while it was away, excel has what it had then
+	std::atomic<bool> stop = false;
+	std::atomic<uint64_t> fed = 0;
+	std::thread feed([&]() {
+		std::mt19937 rng(5);
+		const uint32_t RATE = 200000, PER_MS = RATE / 1000;
+		auto next = std::chrono::steady_clock::now();
+		for (uint64_t t = 1; !stop; ) {
+			for (uint32_t j = 0; j < PER_MS; j++, t++) {
+				uint32_t i = rng() % num_cells;
+				VARIANT var;
+				VariantInit(&var);
+				var.vt = VT_R8;
+				var.dblVal = static_cast<double>(t);
+				cache.update(symbolName(i), { std::make_pair(std::string("bid"), var) }, t);
+				expected[i] = static_cast<double>(t);
+			}
+			fed += PER_MS;
+			next += std::chrono::milliseconds(1);
+			std::this_thread::sleep_until(next);
+		}
+	});
+	std::vector<double> blocked_us;
+	uint64_t values = 0;
+	uint32_t wrong = 0;
+	LONG away = -1;
+	auto refresh = [&]() -> size_t {
+		std::vector<std::pair<VARIANT, VARIANT>> data;
+		auto start = std::chrono::steady_clock::now();
+		cache.get(data);
+		blocked_us.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0);
+		for (auto& it : data) {
+			LONG id = it.first.lVal;
+			wrong += id == away;
+			if (id < static_cast<LONG>(num_cells))
+				refreshed[id] = it.second.dblVal;
+			VariantClear(&it.second);
+		}
+		values += data.size();
+		return data.size();
+	};
+	std::mt19937 rng(7);
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+	for (uint32_t n = 0; std::chrono::steady_clock::now() < end; n++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		refresh();
+		if (away >= 0) {
+			VARIANT known;
+			if (cache.add(symbolName(away), "bid", away, &known))
+				refreshed[away] = known.dblVal;
+			away = -1;
+		}
+		else if (n % 10 == 0) {
+			away = rng() % num_cells;
+			went_away[away] = true;
+			cache.remove(away);
+		}
+	}
+	stop = true;
+	feed.join();
+	if (away >= 0) {
+		VARIANT known;
+		if (cache.add(symbolName(away), "bid", away, &known))
+			refreshed[away] = known.dblVal;
+	}
+	while (refresh())
+		;
+	blocked_us.pop_back();
+	for (uint32_t i = 0; i < num_cells; i++)
+		wrong += refreshed[i] != expected[i] && !std::isnan(expected[i]) && !went_away[i];
+	std::sort(blocked_us.begin(), blocked_us.end());
+	double total = 0;
+	for (double us : blocked_us)
+		total += us;
+	auto st = cache.stats();
+	std::cout << "cells " << num_cells << ", updates " << fed << ", refreshes " << blocked_us.size() << ", values " << values << ", overwritten in place " << st.m_refresh_overwrites
+		<< std::endl << "  blocked in get() us: p50 " << blocked_us[blocked_us.size() / 2] << " p99 " << blocked_us[blocked_us.size() * 99 / 100] << " max " << blocked_us.back()
+		<< ", total " << total / 1000 << " ms, wrong values " << wrong << std::endl;
+	return wrong == 0 && values > 0;
+}
+
+// text values through the string pool: interning and reuse of idle entries first, then "tms" on every symbol fed and
+// refreshed, the second half must make no BSTR in the pool and one allocation per text value handed out (excel's copy)
+// at most, everything is gone once the cache is
+auto strings(uint32_t num_symbols, uint32_t num_packets) -> bool
+{
+	bool ok = true;
+	{
+		StringPool pool(4);
+		StringPool::Entry* a = pool.intern("WAITING", 7);
+		StringPool::Entry* b = pool.intern("WAITING", 7);
+		ok &= a == b && a->m_refs == 2 && pool.hits() == 1 && pool.live() == 1;
+		pool.release(a);
+		pool.release(b);
+		ok &= pool.live() == 0 && pool.idle() == 1 && pool.intern("WAITING", 7) == a;
+		pool.release(a);
+		aw::TimestampFormatter formatter;
+		char buf[aw::TimestampFormatter::SIZE];
+		StringPool::Entry* held = nullptr;
+		for (uint64_t i = 0; i < 10000; i++) {
+			size_t len = formatter.format(1700000000000000ull + i * 37, buf);
+			StringPool::Entry* e = pool.intern(buf, len);
+			ok &= e && SysStringLen(e->m_bstr) == len && e->m_bstr[len - 1] == static_cast<OLECHAR>(buf[len - 1]) && e != held;
+			if (held)
+				pool.release(held);
+			held = e;
+		}
+		pool.release(held);
+		std::cout << "pool of 4 idle, 10000 timestamps: entries " << pool.size() << ", BSTRs made " << pool.allocations() << ", reused " << pool.recycled() << std::endl;
+		ok &= pool.size() <= 6 && pool.allocations() <= 6 && pool.live() == 0;
+	}
+	auto run = [&](bool with_tms, uint64_t& allocations, uint64_t& tms_values, DataCache::Stats& st) -> bool {
+		uint64_t outstanding = bstrsLive();
+		{
+			DataCache cache;
+			for (uint32_t i = 0; i < num_symbols; i++) {
+				cache.add(symbolName(i), "bid", i);
+				if (with_tms)
+					cache.add(symbolName(i), "tms", num_symbols + i);
+			}
+			// decoded packets, onData would also queue each one to the process's packet log
+			std::vector<std::vector<std::pair<std::string, VARIANT>>> packets(num_packets);
+			for (uint32_t i = 0; i < num_packets; i++) {
+				VARIANT var;
+				VariantInit(&var);
+				var.vt = VT_R8;
+				var.dblVal = i;
+				packets[i].push_back(std::make_pair(std::string("bid"), var));
+			}
+			std::vector<std::pair<VARIANT, VARIANT>> data;
+			data.reserve(2 * num_symbols);
+			auto feed = [&](uint32_t from, uint32_t to) {
+				for (uint32_t i = from; i < to; i++) {
+					cache.update(symbolName(i % num_symbols), packets[i], 1700000000000000ull + i / 4 * 37); // 4 symbols tick in the same microsecond
+					if (i % 10 != 9)
+						continue;
+					cache.get(data);
+					for (auto& it : data) {
+						tms_values += it.second.vt == VT_BSTR;
+						VariantClear(&it.second);
+					}
+					data.clear();
+				}
+			};
+			feed(0, num_packets / 2); // pool fills its idle entries, buffers reach their size
+			uint64_t pooled = cache.stats().m_strings_allocations;
+			tms_values = 0;
+			uint64_t before = bstrsMade();
+			feed(num_packets / 2, num_packets);
+			allocations = bstrsMade() - before;
+			st = cache.stats();
+			st.m_strings_allocations -= pooled;
+			for (uint32_t i = 0; i < num_symbols; i++) {
+				cache.remove(i);
+				cache.remove(num_symbols + i);
+			}
+			VARIANT waiting;
+			VariantInit(&waiting);
+			ok &= cache.text("WAITING", &waiting) && waiting.vt == VT_BSTR && SysStringLen(waiting.bstrVal) == 7;
+			VariantClear(&waiting);
+			ok &= cache.waiting(&waiting) && waiting.vt == VT_BSTR && SysStringLen(waiting.bstrVal) == 7;
+			VariantClear(&waiting);
+			ok &= cache.stats().m_strings_live == 1; // waiting()'s, held for good
+		}
+		return bstrsLive() == outstanding; // no BSTR the cache made is left
+	};
+	uint64_t plain_allocations = 0, tms_allocations = 0, no_values = 0, tms_values = 0;
+	DataCache::Stats plain_st, tms_st;
+	bool plain_clean = run(false, plain_allocations, no_values, plain_st);
+	bool tms_clean = run(true, tms_allocations, tms_values, tms_st);
+	double per_value = tms_values ? static_cast<double>(tms_allocations - (std::min)(tms_allocations, plain_allocations)) / tms_values : 0;
+	std::cout << "symbols " << num_symbols << ", packets " << num_packets << ", steady half: tms values " << tms_values << ", pool hits " << tms_st.m_strings_hits
+		<< ", pool BSTRs made " << tms_st.m_strings_allocations << ", BSTRs per tms value " << per_value << std::endl;
+	std::cout << "BSTRs left after the cache is gone: " << (plain_clean && tms_clean ? "none" : "SOME") << std::endl;
+	ok &= plain_clean && tms_clean && tms_values > 0 && tms_st.m_strings_allocations == 0 && tms_st.m_strings_hits > 0 && per_value <= 1.1;
+	return ok;
+}
+
+// traffic near the touch like a real book: mostly size modifies on the first levels, adds/removes within a few ticks
+auto depth(uint32_t num_levels, uint32_t num_updates) -> bool
+{
+	const size_t RANKS = 10;
+	const uint32_t PER_PACKET = 8;
+	const int64_t TICK = 10000000, MID = 100000000000; // 0.01, 100.00
+	DataCache cache;
+	LONG topic_id = 0;
+	std::map<LONG, std::pair<int, int>> topics; // id -> side, field * RANKS + rank - 1
+	for (int side = 0; side < 2; side++) {
+		for (int field = 0; field < 2; field++) {
+			for (size_t rank = 1; rank <= RANKS; rank++) {
+				std::string topic = std::string(side ? "ask" : "bid") + (field ? "Size" : "") + std::to_string(rank);
+				topics[topic_id] = std::make_pair(side, field * static_cast<int>(RANKS) + static_cast<int>(rank) - 1);
+				cache.add("IBM", topic, topic_id++);
+			}
+		}
+	}
+	std::map<int64_t, int64_t> book[2]; // by price, best bid is last, best ask is first
+	std::mt19937_64 rng(42);
+	auto next_update = [&]() {
+		DepthUDPData::Update u{};
+		u.m_side = static_cast<uint8_t>(rng() % 2);
+		auto& levels(book[u.m_side]);
+		uint32_t dice = rng() % 10;
+		size_t near = (std::min)(static_cast<size_t>(rng() % 3 + rng() % 3 * (rng() % 4)), levels.empty() ? 0 : levels.size() - 1);
+		if (dice < 8 && !levels.empty()) {
+			auto it = u.m_side ? std::next(levels.begin(), near) : std::prev(levels.end(), near + 1);
+			u.m_action = OrderBook::MODIFY;
+			u.m_price = it->first;
+			u.m_size = 1 + rng() % 1000;
+		}
+		else if (dice < 9 || levels.size() < num_levels / 2) {
+			int64_t ticks = 1 + static_cast<int64_t>(rng() % (num_levels + 1));
+			u.m_action = OrderBook::ADD;
+			u.m_price = u.m_side ? MID + ticks * TICK : MID - ticks * TICK;
+			u.m_size = 1 + rng() % 1000;
+		}
+		else {
+			near = (std::min)(static_cast<size_t>(rng() % 20), levels.size() - 1);
+			auto it = u.m_side ? std::next(levels.begin(), near) : std::prev(levels.end(), near + 1);
+			u.m_action = OrderBook::REMOVE;
+			u.m_price = it->first;
+		}
+		int64_t price = u.m_price; // packed, no references into it
+		if (u.m_action == OrderBook::REMOVE)
+			levels.erase(price);
+		else
+			levels[price] = u.m_size;
+		return u;
+	};
+	auto make = [&](std::vector<char>& buf, uint64_t mks, uint32_t count) {
+		buf.assign(offsetof(DepthUDPData, m_updates) + count * sizeof(DepthUDPData::Update), 0);
+		auto* data = reinterpret_cast<DepthUDPData*>(buf.data());
+		memcpy(data->m_symbol, "IBM", 3);
+		data->m_timestamp = mks;
+		data->m_num_updates = static_cast<uint16_t>(count);
+		for (uint32_t i = 0; i < count; i++)
+			data->m_updates[i] = next_update();
+	};
+	auto expected = [&](int side, int slot) -> double {
+		int field = slot / static_cast<int>(RANKS);
+		size_t rank = slot % RANKS + 1;
+		auto& levels(book[side]);
+		if (rank > levels.size())
+			return 0;
+		auto it = side ? std::next(levels.begin(), rank - 1) : std::prev(levels.end(), rank);
+		return field ? static_cast<double>(it->second) : static_cast<double>(it->first) / SCALE;
+	};
+	std::map<LONG, double> last;
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	auto check = [&]() {
+		data.clear();
+		cache.get(data);
+		for (auto& it : data) {
+			last[it.first.lVal] = it.second.dblVal;
+			VariantClear(&it.second);
+		}
+		for (auto& t : topics) {
+			auto it = last.find(t.first);
+			double want = expected(t.second.first, t.second.second);
+			if (it == last.end() ? want != 0 : it->second != want)
+				return false;
+		}
+		return true;
+	};
+	// seed the book, then traffic with a check after every packet
+	std::vector<char> buf;
+	uint64_t mks = 1000000;
+	make(buf, mks, num_levels);
+	cache.onDepth(buf.data(), buf.size());
+	bool ok = check();
+	uint32_t checked = 0;
+	for (uint32_t i = 0; ok && i < (std::min)(num_updates, 100000u); i += PER_PACKET, checked++) {
+		make(buf, ++mks, PER_PACKET);
+		cache.onDepth(buf.data(), buf.size());
+		if (!check()) {
+			std::cout << "mismatch after packet " << checked << std::endl;
+			ok = false;
+		}
+	}
+	// speed: prebuilt packets, refresh every 64 packets
+	std::vector<std::vector<char>> packets(num_updates / PER_PACKET);
+	for (auto& p : packets)
+		make(p, ++mks, PER_PACKET);
+	double ns = nsPer(static_cast<uint32_t>(packets.size()), [&](uint32_t i) {
+		cache.onDepth(packets[i].data(), packets[i].size());
+		if (i % 64 == 63) {
+			data.clear();
+			cache.get(data);
+			for (auto& it : data) {
+				last[it.first.lVal] = it.second.dblVal;
+				VariantClear(&it.second);
+			}
+		}
+	}) / PER_PACKET;
+	if (!check()) {
+		std::cout << "mismatch after timed packets" << std::endl;
+		ok = false;
+	}
+	// depth cells gone while the symbol stays subscribed, traffic goes on, new depth cells get the whole book from
+	// ConnectData (levels added while nobody watched included), then keep up with traffic
+	LONG quote_id = topic_id;
+	cache.add("IBM", "bid", quote_id);
+	for (LONG id = 0; id < quote_id; id++)
+		ok &= cache.remove(id);
+	for (uint32_t i = 0; i < 64; i++) {
+		make(buf, ++mks, PER_PACKET);
+		cache.onDepth(buf.data(), buf.size());
+	}
+	last.clear();
+	for (auto& t : topics) {
+		int side = t.second.first, field = t.second.second / static_cast<int>(RANKS);
+		size_t rank = t.second.second % RANKS + 1;
+		VARIANT known;
+		VariantInit(&known);
+		if (cache.add("IBM", std::string(side ? "ask" : "bid") + (field ? "Size" : "") + std::to_string(rank), t.first, &known))
+			last[t.first] = known.dblVal;
+		VariantClear(&known);
+	}
+	bool resubscribed = check();
+	make(buf, ++mks, PER_PACKET);
+	cache.onDepth(buf.data(), buf.size());
+	resubscribed &= check();
+	if (!resubscribed) {
+		std::cout << "mismatch after subscribing to a book with traffic before" << std::endl;
+		ok = false;
+	}
+	ok &= cache.remove(quote_id);
+	// book alone, same traffic shape
+	OrderBook ob;
+	std::vector<DepthUDPData::Update> updates;
+	for (size_t i = 0; i < num_updates; i++)
+		updates.push_back(next_update());
+	bool shifted = false;
+	size_t ranks = 0;
+	double book_ns = nsPer(static_cast<uint32_t>(updates.size()), [&](uint32_t i) {
+		ranks += ob.apply(static_cast<OrderBook::Side>(updates[i].m_side), static_cast<OrderBook::Action>(updates[i].m_action), updates[i].m_price, updates[i].m_size, shifted);
+	});
+	std::cout << "levels: " << book[0].size() << "/" << book[1].size() << ", packets checked: " << checked
+		<< ", onDepth updates/s: " << 1e9 / ns << ", OrderBook updates/s: " << 1e9 / book_ns << " (" << ranks << ")" << std::endl;
+	// clear empties every rank
+	buf.assign(offsetof(DepthUDPData, m_updates) + sizeof(DepthUDPData::Update), 0);
+	auto* clear = reinterpret_cast<DepthUDPData*>(buf.data());
+	memcpy(clear->m_symbol, "IBM", 3);
+	clear->m_num_updates = 1;
+	clear->m_updates[0].m_action = OrderBook::CLEAR;
+	cache.onDepth(buf.data(), buf.size());
+	book[0].clear();
+	book[1].clear();
+	ok &= check();
+	for (LONG id = 0; id < topic_id; id++)
+		ok &= cache.remove(id);
+	ok &= cache.stats().m_symbols == 0;
+	return ok;
+}
+
+// StaleMs with the ingest clock driven by hand: symbols that stop ticking go stale, their "stale" topic shows 1 and their
+// cells come to a reader of changes flagged, the next packet clears both without a wheel pass, then every symbol
+// quiet at once, cost per packet with the wheel stepped every millisecond (a 1M packets/s feed) against StaleMs off
+auto stale(uint32_t num_symbols) -> bool
+{
+	const uint64_t t0 = 1000000;
+	auto tick = [](DataCache& cache, uint32_t i, uint64_t now_ms, double bid) {
+		std::vector<std::pair<std::string, VARIANT>> topic_var(1);
+		topic_var[0].first = "bid";
+		VariantInit(&topic_var[0].second);
+		topic_var[0].second.vt = VT_R8;
+		topic_var[0].second.dblVal = bid;
+		cache.update(symbolName(i), topic_var, now_ms * 1000);
+	};
+	bool ok = true;
+	Configuration::instance().setStaleMs("*=100,SYM1=1000");
+	{
+		DataCache cache;
+		cache.expire(t0);
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			cache.add(symbolName(i), "bid", 2 * i);
+			cache.add(symbolName(i), "stale", 2 * i + 1);
+		}
+		std::vector<double> shown(2ull * num_symbols, NAN);
+		uint32_t bids_sent = 0; // by the last refresh
+		auto refresh = [&]() {
+			std::vector<std::pair<VARIANT, VARIANT>> data;
+			cache.get(data);
+			bids_sent = 0;
+			for (auto& it : data) {
+				bids_sent += it.first.lVal % 2 == 0;
+				shown[it.first.lVal] = it.second.vt == VT_R8 ? it.second.dblVal : NAN;
+				VariantClear(&it.second);
+			}
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < num_symbols; i++)
+				count += shown[2 * i + 1] == 1;
+			return count;
+		};
+		auto expected = [](uint32_t i) { return i % 2 == 1 && i != 1; }; // odd ones stop, SYM1 has 1000ms
+		ok &= refresh() == num_symbols; // no packet yet
+		for (uint32_t i = 0; i < num_symbols; i++)
+			tick(cache, i, t0, 1.0);
+		cache.expire(t0 + 1);
+		ok &= refresh() == 0;
+		uint32_t recorder = cache.add_consumer(false);
+		cache.expire(t0 + 50);
+		for (uint32_t i = 0; i < num_symbols; i += 2)
+			tick(cache, i, t0 + 50, 2.0);
+		refresh();
+		cache.expire(t0 + 120); // even ones' deadlines fire and move to t0 + 150
+		uint32_t went_stale = refresh();
+		uint32_t resent = bids_sent; // excel has these values, only the "stale" topic moved
+		uint32_t wrong = 0;
+		for (uint32_t i = 0; i < num_symbols; i++)
+			wrong += (shown[2 * i + 1] == 1) != expected(i) || shown[2 * i] != (i % 2 ? 1.0 : 2.0);
+		uint32_t flagged = 0;
+		cache.consume(recorder, [&](const std::string& symbol, const std::string& topic, const VARIANT&, bool stale) {
+			uint32_t i = static_cast<uint32_t>(std::stoul(symbol.substr(3)));
+			if (topic == "bid") {
+				wrong += stale != expected(i);
+				flagged += stale;
+			}
+		});
+		auto st = cache.stats();
+		ok &= st.m_stale == went_stale && st.m_stale_timers == num_symbols - went_stale;
+		// the next packet clears it
+		for (uint32_t i = 1; i < num_symbols; i += 2)
+			tick(cache, i, t0 + 130, 3.0);
+		uint32_t left = refresh();
+		cache.consume(recorder, [&](const std::string&, const std::string&, const VARIANT&, bool stale) {
+			wrong += stale;
+		});
+		st = cache.stats();
+		ok &= left == 0 && st.m_stale == 0 && st.m_stale_timers == num_symbols;
+		// the feed line dies: every symbol, one pass of the wheel
+		auto start = std::chrono::steady_clock::now();
+		cache.expire(t0 + 5000);
+		double expire_ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+		uint32_t all = refresh();
+		resent += bids_sent;
+		ok &= all == num_symbols && wrong == 0 && flagged == went_stale && resent == 0;
+		std::cout << "symbols " << num_symbols << ", stale after 120ms " << went_stale << " (expected " << num_symbols / 2 - 1 << "), after the next packet "
+			<< left << ", all quiet " << all << " in " << expire_ms << "ms, values excel had sent again " << resent << ", wrong " << wrong << std::endl;
+		ok &= went_stale == num_symbols / 2 - 1;
+	}
+	// cost per packet, wheel stepped every 1000 packets, symbols round robin
+	auto ns_per_packet = [&](const std::string& list) {
+		Configuration::instance().setStaleMs(list);
+		DataCache cache;
+		cache.expire(t0);
+		for (uint32_t i = 0; i < num_symbols; i++)
+			cache.add(symbolName(i), "bid", i);
+		uint32_t packets = (std::max)(num_symbols * 4, 1000000u);
+		return nsPer(packets, [&](uint32_t i) {
+			if (i % 1000 == 0)
+				cache.expire(t0 + i / 1000);
+			tick(cache, i % num_symbols, t0 + i / 1000, i);
+		});
+	};
+	double ns_on = ns_per_packet("*=1000");
+	double ns_off = ns_per_packet("");
+	std::cout << "ns per packet, StaleMs on: " << ns_on << ", off: " << ns_off << std::endl;
+	return ok;
+}
+
+// text a placeholder VARIANT shows, "" if it isn't text
+auto textOf(const VARIANT& var) -> std::string
+{
+	std::string text;
+	if (var.vt == VT_BSTR) {
+		for (UINT i = 0; i < SysStringLen(var.bstrVal); i++)
+			text += static_cast<char>(var.bstrVal[i]);
+	}
+	return text;
+}
+
+// ConnectData's array as excel fills it, a BSTR per string, caller clears them
+auto argsOf(const std::vector<std::string>& strings) -> std::vector<VARIANT>
+{
+	std::vector<VARIANT> args(strings.size());
+	for (size_t i = 0; i < strings.size(); i++) {
+		VariantInit(&args[i]);
+		args[i].bstrVal = SysAllocStringLen(NULL, static_cast<UINT>(strings[i].size()));
+		args[i].vt = VT_BSTR;
+		for (size_t j = 0; j < strings[i].size(); j++)
+			args[i].bstrVal[j] = strings[i][j];
+	}
+	return args;
+}
+
+// RtdServer as excel drives it through AwRTD: ConnectData strings, the notifier thread's UpdateNotify, RefreshData
+// after each one, DisconnectData, ServerTerminate must end the notifier
+auto server(uint32_t num_symbols) -> bool
+{
+	bool ok = true;
+	RtdServer server;
+	auto connect = [&](LONG topic_id, const std::vector<std::string>& strings, std::string& text) -> bool {
+		VARIANT out;
+		VariantInit(&out);
+		bool connected = server.connect(topic_id, strings, &out);
+		text = textOf(out);
+		VariantClear(&out);
+		return connected;
+	};
+	std::string text;
+	LONG topic_id = 0;
+	ok &= connect(topic_id++, { "quote", "IBM", "bid" }, text) && text == "WAITING";
+	ok &= connect(topic_id++, { "expr", "IBM.bid-" }, text) && text.rfind("#EXPR ", 0) == 0;
+	ok &= connect(topic_id++, { "depth", "IBM", "bidSideways3" }, text) && text == "#DEPTH unknown topic";
+	ok &= connect(topic_id++, { "quote", "IBM", "ask", "hot sideways" }, text) && text.rfind("#OPTION sideways", 0) == 0;
+	ok &= !connect(topic_id, { "trade", "IBM", "bid" }, text) && !connect(topic_id, { "quote", "IBM" }, text) && !connect(topic_id, {}, text);
+	ok &= server.disconnect(0) && !server.disconnect(0) && !server.disconnect(1000);
+	std::cout << "connect strings: " << (ok ? "ok" : "WRONG") << std::endl;
+
+	LONG first = topic_id;
+	for (uint32_t i = 0; i < num_symbols; i++)
+		ok &= connect(topic_id++, { "quote", symbolName(i), "bid", i % 2 ? "cold" : "hot 1t" }, text) && text == "WAITING";
+	std::mutex mutex;
+	std::condition_variable cv;
+	uint64_t notifies = 0;
+	std::thread notifier([&]() {
+		server.notify_loop([&]() {
+			std::lock_guard<std::mutex> __(mutex);
+			notifies++;
+			cv.notify_one();
+		});
+	});
+	std::vector<double> refreshed(num_symbols, NAN);
+	uint64_t seen = 0, values = 0;
+	for (uint32_t round = 1; round <= 20; round++) {
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			auto packet = makePacket(symbolName(i), round, static_cast<int64_t>((round * 100.0 + i) * SCALE), 0, 0);
+			server.cache().onData(packet.data(), packet.size());
+		}
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			ok &= cv.wait_for(lock, std::chrono::seconds(5), [&]() { return notifies > seen; }); // UpdateNotify, then excel pulls
+			seen = notifies;
+		}
+		RefreshBatch batch;
+		size_t count = server.refresh(batch);
+		if (count == 0)
+			continue;
+		long topic_count = 0;
+		SAFEARRAY* array = batch.finish(&topic_count);
+		ok &= topic_count == static_cast<long>(count);
+		VARIANT* data = nullptr;
+		SafeArrayAccessData(array, reinterpret_cast<void**>(&data));
+		for (long i = 0; i < topic_count; i++) {
+			LONG id = data[2 * i].lVal - first;
+			if (id >= 0 && id < static_cast<LONG>(num_symbols) && data[2 * i + 1].vt == VT_R8)
+				refreshed[id] = data[2 * i + 1].dblVal;
+		}
+		SafeArrayUnaccessData(array);
+		SafeArrayDestroy(array);
+		values += count;
+	}
+	uint32_t wrong = 0;
+	for (uint32_t i = 0; i < num_symbols; i++)
+		wrong += refreshed[i] != 20 * 100.0 + i;
+	// expression on known inputs comes back from ConnectData, one with an input nobody sent yet shows WAITING
+	{
+		VARIANT out;
+		VariantInit(&out);
+		ok &= server.connect(topic_id++, { "expr", symbolName(0) + ".bid+" + symbolName(1) + ".bid*2" }, &out);
+		bool known = out.vt == VT_R8 && out.dblVal == (20 * 100.0) + (20 * 100.0 + 1) * 2;
+		VariantClear(&out);
+		known &= connect(topic_id++, { "expr", symbolName(0) + ".bid-NOBODY.bid" }, text) && text == "WAITING";
+		if (!known)
+			std::cout << "expr ConnectData: known inputs didn't give the value, or unknown ones didn't give WAITING" << std::endl;
+		ok &= known;
+	}
+
+	// workbook copied to a second sheet while another symbol floods the cache: excel's arrays as they come, values
+	// known now either come back from ConnectData or, queued behind the feed, with the next RefreshData
+	LONG second = topic_id;
+	std::vector<double> copied(num_symbols, NAN);
+	std::atomic<bool> flooding = true;
+	std::atomic<int64_t> flooded = 0;
+	ok &= connect(topic_id++, { "quote", "NOISE", "bid" }, text);
+	std::thread flood([&]() {
+		for (int64_t i = 0; flooding; i++) {
+			auto packet = makePacket("NOISE", 1, i, 0, 0);
+			server.cache().onData(packet.data(), packet.size());
+			flooded = i;
+		}
+	});
+	while (flooded < 100)
+		std::this_thread::yield();
+	uint32_t queued = 0;
+	for (uint32_t i = 0; i < num_symbols; i++) {
+		auto args = argsOf({ "quote", symbolName(i), "bid", i % 2 ? "cold" : "hot 1t" });
+		VARIANT out;
+		VariantInit(&out);
+		ok &= server.connect(topic_id++, args.data(), args.size(), &out);
+		if (out.vt == VT_R8)
+			copied[i] = out.dblVal;
+		else
+			queued += textOf(out) == "WAITING";
+		VariantClear(&out);
+		for (auto& arg : args)
+			VariantClear(&arg);
+	}
+	flooding = false;
+	flood.join();
+	RefreshBatch batch;
+	if (server.refresh(batch)) {
+		long topic_count = 0;
+		SAFEARRAY* array = batch.finish(&topic_count);
+		VARIANT* data = nullptr;
+		SafeArrayAccessData(array, reinterpret_cast<void**>(&data));
+		for (long i = 0; i < topic_count; i++) {
+			LONG id = data[2 * i].lVal - second - 1;
+			if (id >= 0 && id < static_cast<LONG>(num_symbols) && data[2 * i + 1].vt == VT_R8)
+				copied[id] = data[2 * i + 1].dblVal;
+		}
+		SafeArrayUnaccessData(array);
+		SafeArrayDestroy(array);
+	}
+	uint32_t missing = 0;
+	for (uint32_t i = 0; i < num_symbols; i++)
+		missing += copied[i] != 20 * 100.0 + i;
+	ok &= server.view().connects_queued() == 0 && missing == 0;
+	std::cout << "second sheet: connects queued behind the feed " << queued << ", values missing after one refresh " << missing << std::endl;
+
+	server.stop();
+	notifier.join(); // returned on its own
+	// a value is there now: ConnectData gets it instead of the placeholder
+	VARIANT known;
+	VariantInit(&known);
+	ok &= server.connect(topic_id, { "quote", symbolName(0), "bid" }, &known) && known.vt == VT_R8 && known.dblVal == 20 * 100.0;
+	std::cout << "symbols " << num_symbols << ", notifications " << notifies << ", values " << values << ", wrong last values " << wrong << std::endl;
+	return ok && wrong == 0;
+}
+
+// two excel instances in one process (two AwRTD objects) on one cache: the same TopicIDs on each get their own values,
+// a cell both show is one cell, the feed keeps going for the second after the first closes and stops with the last,
+// then the cache goes too and the next instance starts from a fresh one
+auto instances(uint32_t num_symbols) -> bool
+{
+	bool ok = true;
+	auto connect = [&](RtdServer& server, LONG topic_id, const std::vector<std::string>& strings) {
+		VARIANT out;
+		VariantInit(&out);
+		ok &= server.connect(topic_id, strings, &out);
+		VariantClear(&out);
+	};
+	auto refresh = [](RtdServer& server, std::map<LONG, double>& values) {
+		RefreshBatch batch;
+		if (server.refresh(batch) == 0)
+			return;
+		long topic_count = 0;
+		SAFEARRAY* array = batch.finish(&topic_count);
+		VARIANT* data = nullptr;
+		SafeArrayAccessData(array, reinterpret_cast<void**>(&data));
+		for (long i = 0; i < topic_count; i++)
+			values[data[2 * i].lVal] = data[2 * i + 1].vt == VT_R8 ? data[2 * i + 1].dblVal : NAN;
+		SafeArrayUnaccessData(array);
+		SafeArrayDestroy(array);
+	};
+	auto bid = [](uint32_t round, uint32_t i) { return round * 100.0 + i; };
+	auto send = [&](DataCache& cache, uint32_t round) {
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			int64_t raw = static_cast<int64_t>(bid(round, i) * SCALE);
+			auto packet = makePacket(symbolName(i), round, raw, raw + SCALE, 0);
+			cache.onData(packet.data(), packet.size());
+		}
+	};
+	std::weak_ptr<DataCache> shared;
+	{
+		auto first = std::make_unique<RtdServer>();
+		auto second = std::make_unique<RtdServer>();
+		shared = DataCache::shared();
+		DataCache& cache(first->cache());
+		ok &= &cache == &second->cache() && &cache == shared.lock().get();
+		first->start(); // joins the multicast group once, packets here come through onData
+		second->start();
+		// TopicIDs 0..n-1 on both: bids on the first, asks on the second, and the second shows one bid too
+		for (uint32_t i = 0; i < num_symbols; i++) {
+			connect(*first, i, { "quote", symbolName(i), "bid" });
+			connect(*second, i, { "quote", symbolName(i), "ask" });
+		}
+		connect(*second, num_symbols, { "quote", symbolName(0), "bid" });
+		auto st = cache.stats();
+		ok &= st.m_instances == 2 && st.m_views == 3 && st.m_symbols == num_symbols && st.m_cells == 2ull * num_symbols &&
+			st.m_topic_ids == 2ull * num_symbols + 1;
+		send(cache, 1);
+		std::map<LONG, double> bids, asks;
+		refresh(*first, bids);
+		refresh(*second, asks);
+		uint32_t wrong = bids.size() != num_symbols || asks.size() != num_symbols + 1ull || asks[num_symbols] != bid(1, 0);
+		for (uint32_t i = 0; i < num_symbols; i++)
+			wrong += bids[i] != bid(1, i) || asks[i] != bid(1, i) + 1;
+		// the first workbook closes: its TopicIDs go, the bid the second still shows stays
+		first->stop();
+		first.reset();
+		st = cache.stats();
+		ok &= st.m_instances == 1 && st.m_views == 2 && st.m_cells == num_symbols + 1ull && st.m_topic_ids == num_symbols + 1ull;
+		send(cache, 2);
+		asks.clear();
+		refresh(*second, asks);
+		wrong += asks.size() != num_symbols + 1ull || asks[num_symbols] != bid(2, 0);
+		for (uint32_t i = 0; i < num_symbols; i++)
+			wrong += asks[i] != bid(2, i) + 1;
+		second->stop();
+		ok &= cache.stats().m_instances == 0;
+		std::cout << "two instances on one cache, symbols " << num_symbols << ", wrong values " << wrong << std::endl;
+		ok &= wrong == 0;
+	}
+	ok &= shared.expired();
+	RtdServer next;
+	ok &= next.cache().stats().m_symbols == 0;
+	std::cout << "last instance gone: cache " << (shared.expired() ? "released" : "STILL THERE") << std::endl;
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		std::cout << "enter churn <num symbols> <cycles> | filter <num symbols> <num packets> | tms <num packets> | derived <num packets> | bars <num symbols> <num ticks> | rolling <num packets> | expr <num symbols> <num packets> | options <num strikes> | depth <num levels> <num updates> | ticks <dir> <num packets> | snapshot <file> <num cells> | shm <num symbols> <num updates> | journal <num symbols> <num packets> | deadband <num packets> | pacing <seconds> | batches <num cells> <batch size> | blocked <num cells> <seconds> | strings <num symbols> <num packets> | stale <num symbols> | server <num symbols> | instances <num symbols> please" << std::endl;
+		exit(1);
+	}
+	Configuration::instance().setVerbose(false);
+	std::string mode(argv[1]);
+	bool ok = false;
+	if (mode == "churn" && argc > 3) {
+		ok = churn(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "filter" && argc > 3) {
+		ok = filter(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "bars" && argc > 3) {
+		ok = bars(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "derived") {
+		ok = derived(std::atoi(argv[2]));
+	}
+	else if (mode == "rolling") {
+		ok = rolling(std::atoi(argv[2]));
+	}
+	else if (mode == "expr" && argc > 3) {
+		ok = expr(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "shm" && argc > 3) {
+		ok = shm(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "snapshot" && argc > 3) {
+		ok = snapshot(argv[2], std::atoi(argv[3]));
+	}
+	else if (mode == "ticks" && argc > 3) {
+		ok = ticks(argv[2], std::atoi(argv[3]));
+	}
+	else if (mode == "batches" && argc > 3) {
+		ok = batches(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "blocked" && argc > 3) {
+		ok = blocked(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "stale") {
+		ok = stale(std::atoi(argv[2]));
+	}
+	else if (mode == "strings" && argc > 3) {
+		ok = strings(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "journal" && argc > 3) {
+		ok = journal(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "depth" && argc > 3) {
+		ok = depth(std::atoi(argv[2]), std::atoi(argv[3]));
+	}
+	else if (mode == "options") {
+		ok = optionsChain(std::atoi(argv[2]));
+	}
+	else if (mode == "deadband") {
+		ok = deadband(std::atoi(argv[2]));
+	}
+	else if (mode == "pacing") {
+		ok = pacing(std::atoi(argv[2]));
+	}
+	else if (mode == "server") {
+		ok = server(std::atoi(argv[2]));
+	}
+	else if (mode == "instances") {
+		ok = instances(std::atoi(argv[2]));
+	}
+	else if (mode == "tms") {
+		ok = tms(std::atoi(argv[2]));
+	}
+	else {
+		std::cout << "unknown mode: " << mode << std::endl;
+		exit(1);
+	}
+	std::cout << mode << (ok ? " passed" : " FAILED") << std::endl;
+	exit(ok ? 0 : -1);
+}
@@ -0,0 +1,84 @@
+// FeedHandler : joins the feed once per machine and keeps the last value of every symbol/topic in shared memory
+// AwRTDServer instances (SharedFeed registry value = same name) and other local readers map it read only,
+// see RTDCore/lastvalues.h
+// portable (linux: g++ -std=c++17 -O2 -pthread main.cpp -lrt)
+// usage: FeedHandler <shared memory name> <multicast group> <port> [interface] [slots]
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+
+#include "../aw/udp.h"
+#include "../RTDCore/udpdata.h"
+#include "../RTDCore/lastvalues.h"
+
+static std::atomic<bool> g_stop(false);
+
+struct Handler : public aw::IUDPListener
+{
+	// feed thread only, the table has one writer
+	auto onData(const char* data, size_t size) -> void override
+	{
+		if (size < offsetof(EnhancedUDPData, m_fields))
+			return;
+		const auto* myData = reinterpret_cast<const EnhancedUDPData*>(data);
+		size_t num_fields = (std::min)(static_cast<size_t>(myData->m_num_fields), (size - offsetof(EnhancedUDPData, m_fields)) / sizeof(EnhancedUDPData::Field));
+		for (size_t i = 0; i < num_fields; i++) {
+			const EnhancedUDPData::Field& f(myData->m_fields[i]);
+			char topic[lastvalues::TOPIC_SIZE] = {};
+			memcpy(topic, f.m_topic, sizeof(f.m_topic));
+			if (!m_writer.update(myData->m_symbol, topic, f.m_type, f.m_val, myData->m_timestamp))
+				m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+		m_packets.store(m_packets.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	lastvalues::Writer m_writer;
+	std::atomic<uint64_t> m_packets = 0;
+	std::atomic<uint64_t> m_dropped = 0; // table full
+};
+
+int main(int argc, char** argv)
+{
+	if (argc < 4) {
+		std::cout << "enter <shared memory name> <multicast group> <port> [interface] [slots] please" << std::endl;
+		exit(1);
+	}
+	std::string name(argv[1]);
+	uint64_t slots = 1 << 18;
+	if (argc > 5) {
+		for (slots = 1024; slots < static_cast<uint64_t>(atoll(argv[5])); slots *= 2)
+			;
+	}
+	Handler handler;
+	if (!handler.m_writer.open(name, slots, 1 << 16)) {
+		std::cout << "couldn't create shared memory " << name << std::endl;
+		exit(1);
+	}
+	aw::UDPServer udp;
+	udp.addChannel(argc > 4 ? argv[4] : "", argv[2], atoi(argv[3]), &handler);
+	if (!udp.start()) {
+		std::cout << "couldn't join " << argv[2] << ":" << argv[3] << std::endl;
+		exit(1);
+	}
+	std::signal(SIGINT, [](int) { g_stop = true; });
+	std::cout << "serving " << name << " (" << slots << " slots), ctrl-c to stop" << std::endl;
+	uint64_t last_packets = 0;
+	while (!g_stop) {
+		for (int i = 0; i < 50 && !g_stop; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		uint64_t packets = handler.m_packets;
+		std::cout << "packets/s: " << (packets - last_packets) / 5 << ", symbol/topics: " << handler.m_writer.count()
+			<< ", sequence: " << handler.m_writer.sequence() << ", dropped: " << handler.m_dropped << std::endl;
+		last_packets = packets;
+	}
+	udp.stop();
+	// table stays for readers (and the next run), remove it with: rm /dev/shm/<name>
+	exit(0);
+}
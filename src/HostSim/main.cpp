@@ -0,0 +1,421 @@
+// HostSim : headless excel, drives RtdServer the way excel drives AwRTD, portable (linux: cmake target HostSim)
+// ServerStart, ConnectData for every cell (3 per symbol: bid, ask, vol), then while a feed generator runs:
+// the notifier thread's UpdateNotify only marks the workbook dirty, excel's thread calls RefreshData once the
+// throttle interval (Excel.Application.RTD.ThrottleInterval, 2000 ms by default) since the last one has passed,
+// recalculates (optional cost per value) and waits for the next notification, ServerTerminate at the end
+// every value the feed sends is the time it was generated (us since start), so each value excel gets says how stale it is
+// feed goes straight into onData (the decode path the receive thread runs), or over multicast when AWRTD_MulticastGroup
+// and AWRTD_MulticastPort are set; other AWRTD_ settings (MaxRefreshBatch, NotifyMinMs, ...) apply as in the server
+// reports ConnectData cost, RefreshData latency, cells per refresh and end-to-end staleness percentiles,
+// in process it also checks that excel ends with every last value
+// usage: HostSim <cells> <seconds> [throttle ms] [updates/s] [recalc ns per value]
+// HostSim open <cells> [updates/s]: workbook open only, ConnectData for every cell while the feed runs, before (strings
+// converted per call, a cache lock per registration and one for the placeholder) and now (RtdServer::connect on excel's
+// array), total and per call times, then every cell must end with its last value
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+
+#include "../RTDCore/rtdserver.h"
+
+static auto steady_us() -> uint64_t
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static auto epoch_us() -> uint64_t
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+auto symbolName(uint32_t i) -> std::string
+{
+	return "SYM" + std::to_string(i);
+}
+
+static const char* TOPICS[] = { "bid", "ask", "vol" };
+
+// bid/ask/vol of one symbol, all three are t (us since start)
+class Packet
+{
+public:
+	Packet() : m_buf(offsetof(EnhancedUDPData, m_fields) + 3 * sizeof(EnhancedUDPData::Field), 0) {}
+
+	auto make(const std::string& symbol, uint64_t t) -> void
+	{
+		auto* data = reinterpret_cast<EnhancedUDPData*>(m_buf.data());
+		memset(data->m_symbol, 0, sizeof(data->m_symbol));
+		memcpy(data->m_symbol, symbol.c_str(), (std::min)(symbol.size(), sizeof(data->m_symbol)));
+		data->m_timestamp = epoch_us();
+		data->m_num_fields = 3;
+		for (int i = 0; i < 3; i++) {
+			memcpy(data->m_fields[i].m_topic, TOPICS[i], sizeof(data->m_fields[i].m_topic));
+			data->m_fields[i].m_type = i == 2 ? 1 : 2;
+			data->m_fields[i].m_val = i == 2 ? static_cast<int64_t>(t) : static_cast<int64_t>(t * SCALE);
+		}
+	}
+	auto data() const -> const char* { return m_buf.data(); }
+	auto size() const -> size_t { return m_buf.size(); }
+
+private:
+	std::vector<char> m_buf;
+};
+
+template<typename T>
+auto percentile(std::vector<T>& values, double p) -> T
+{
+	if (values.empty())
+		return T();
+	size_t i = (std::min)(values.size() - 1, static_cast<size_t>(values.size() * p));
+	std::nth_element(values.begin(), values.begin() + i, values.end());
+	return values[i];
+}
+
+// ConnectData's array as excel fills it, a BSTR per string
+auto argsOf(const std::vector<std::string>& strings) -> std::vector<VARIANT>
+{
+	std::vector<VARIANT> args(strings.size());
+	for (size_t i = 0; i < strings.size(); i++) {
+		VariantInit(&args[i]);
+		args[i].bstrVal = SysAllocStringLen(NULL, static_cast<UINT>(strings[i].size()));
+		args[i].vt = VT_BSTR;
+		for (size_t j = 0; j < strings[i].size(); j++)
+			args[i].bstrVal[j] = strings[i][j];
+	}
+	return args;
+}
+
+// ConnectData as it was: every string copied out of the array and converted (_bstr_t), the log line formatted even
+// with Verbose off, registration and placeholder text each under the cache lock
+auto connectBefore(RtdServer& server, LONG topic_id, const std::vector<VARIANT>& args, VARIANT* out) -> bool
+{
+	std::vector<std::string> strings;
+	for (const VARIANT& arg : args) {
+		VARIANT var;
+		VariantInit(&var);
+		VariantCopy(&var, &arg);
+		std::string text;
+		for (UINT i = 0; i < SysStringLen(var.bstrVal); i++)
+			text += static_cast<char>(var.bstrVal[i]);
+		strings.push_back(text);
+		VariantClear(&var);
+	}
+	if (strings.size() < 3)
+		return false;
+	std::stringstream ss;
+	ss << "RtdServer::connect: command<" << strings[0] << "> symbol<" << strings[1] << "> topic<" << strings[2] << "> topic_id<" << topic_id << ">";
+	std::string log(ss.str());
+	if (server.view().add(strings[1], strings[2], topic_id, out))
+		return true;
+	return server.cache().text("WAITING", out);
+}
+
+// workbook open with the feed running, before or now: a first sheet on symbols nobody subscribed yet, then a second
+// sheet on the same ones while the first is live (values known, the feed takes the cache lock for them), false if
+// a cell isn't registered or doesn't end with the last value of its symbol
+auto open(uint32_t num_cells, uint32_t rate, bool before) -> bool
+{
+	uint32_t num_symbols = (num_cells + 2) / 3;
+	uint64_t start = steady_us();
+	RtdServer server;
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool dirty = false;
+	bool started = server.start();
+	std::thread notifier([&]() {
+		server.notify_loop([&]() {
+			std::lock_guard<std::mutex> __(mutex);
+			dirty = true;
+			cv.notify_one();
+		});
+	});
+	std::vector<std::vector<VARIANT>> args(num_cells);
+	for (uint32_t i = 0; i < num_cells; i++)
+		args[i] = argsOf({ "quote", symbolName(i / 3), TOPICS[i % 3] });
+
+	std::atomic<bool> stop = false;
+	Packet packet;
+	std::thread feed([&]() {
+		std::mt19937 rng(11);
+		Packet packet;
+		uint32_t per_ms = (std::max)(rate / 1000, 1u);
+		auto next = std::chrono::steady_clock::now();
+		while (!stop) {
+			for (uint32_t j = 0; j < per_ms; j++) {
+				packet.make(symbolName(rng() % num_symbols), steady_us() - start);
+				server.cache().onData(packet.data(), packet.size());
+			}
+			next += std::chrono::milliseconds(1);
+			std::this_thread::sleep_until(next);
+		}
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	std::vector<double> shown(2 * num_cells, -1); // both sheets
+	auto show = [&](LONG id, const VARIANT& value) {
+		if (id >= 0 && id < static_cast<LONG>(shown.size()) && (value.vt == VT_I8 || value.vt == VT_R8))
+			shown[id] = value.vt == VT_I8 ? static_cast<double>(value.llVal) : value.dblVal;
+	};
+	// excel refreshes until the server has nothing more for it, once with the feed running
+	auto drain = [&](bool once) {
+		for (;;) {
+			RefreshBatch batch;
+			size_t count = server.refresh(batch);
+			long topic_count = 0;
+			SAFEARRAY* array = count ? batch.finish(&topic_count) : nullptr;
+			if (array) {
+				VARIANT* data = nullptr;
+				SafeArrayAccessData(array, reinterpret_cast<void**>(&data));
+				for (long i = 0; i < topic_count; i++)
+					show(data[2 * i].lVal, data[2 * i + 1]);
+				SafeArrayUnaccessData(array);
+				SafeArrayDestroy(array);
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			if (once || !cv.wait_for(lock, std::chrono::milliseconds(500), [&]() { return dirty; }))
+				break;
+			dirty = false;
+		}
+	};
+
+	for (uint32_t sheet = 0; sheet < 2; sheet++) {
+		std::vector<double> call_ns(num_cells);
+		uint32_t known = 0;
+		uint64_t open_start = steady_us();
+		for (uint32_t i = 0; i < num_cells; i++) {
+			auto entered = std::chrono::steady_clock::now();
+			VARIANT out;
+			VariantInit(&out);
+			LONG id = static_cast<LONG>(sheet * num_cells + i);
+			bool connected = before ? connectBefore(server, id, args[i], &out) : server.connect(id, args[i].data(), args[i].size(), &out);
+			call_ns[i] = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - entered).count());
+			if (connected)
+				show(id, out);
+			known += out.vt != VT_BSTR;
+			VariantClear(&out);
+		}
+		uint64_t open_us = steady_us() - open_start;
+		size_t queued = server.view().connects_queued();
+		double max_ns = *std::max_element(call_ns.begin(), call_ns.end());
+		std::cout << "  " << (before ? "before" : "now") << (sheet ? ", second sheet: " : ", first sheet: ") << open_us / 1000.0 << " ms, "
+			<< static_cast<double>(open_us) * 1000 / num_cells << " ns/cell, ConnectData ns p50 " << percentile(call_ns, 0.5) << " p99 "
+			<< percentile(call_ns, 0.99) << " max " << max_ns << ", values returned " << known << ", queued at the end " << queued << std::endl;
+		if (!sheet)
+			drain(true);
+	}
+	stop = true;
+	feed.join();
+	drain(false);
+	// last tick of every symbol, each cell of both sheets must show it
+	uint64_t last = steady_us() - start;
+	for (uint32_t s = 0; s < num_symbols; s++) {
+		packet.make(symbolName(s), last);
+		server.cache().onData(packet.data(), packet.size());
+	}
+	drain(false);
+	server.stop();
+	notifier.join();
+	for (auto& cell : args)
+		for (auto& arg : cell)
+			VariantClear(&arg);
+
+	uint32_t wrong = 0;
+	for (size_t i = 0; i < shown.size(); i++)
+		wrong += shown[i] < last - 0.5 || shown[i] > last + 0.5;
+	bool registered = server.cache().stats().m_topic_ids == 2 * num_cells;
+	if (wrong || !registered)
+		std::cout << "  wrong last values " << wrong << (registered ? "" : ", NOT ALL REGISTERED") << std::endl;
+	return started && registered && wrong == 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		std::cout << "enter <cells> <seconds> [throttle ms] [updates/s] [recalc ns per value] | open <cells> [updates/s] please" << std::endl;
+		exit(1);
+	}
+	if (std::string(argv[1]) == "open") {
+		uint32_t num_cells = (std::max)(static_cast<uint32_t>(atoi(argv[2])), 1u);
+		uint32_t rate = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 100000;
+		Configuration::instance().init();
+		Configuration::instance().setVerbose(false);
+		std::cout << "workbook open, cells " << num_cells << ", feed " << rate << " updates/s in process" << std::endl;
+		bool ok = open(num_cells, rate, true);
+		ok &= open(num_cells, rate, false);
+		std::cout << (ok ? "passed" : "FAILED") << std::endl;
+		return ok ? 0 : 1;
+	}
+	uint32_t num_cells = static_cast<uint32_t>(atoi(argv[1]));
+	uint32_t seconds = static_cast<uint32_t>(atoi(argv[2]));
+	uint64_t throttle_us = (argc > 3 ? atoll(argv[3]) : 2000) * 1000ull;
+	uint32_t rate = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 100000;
+	uint64_t recalc_ns = argc > 5 ? atoll(argv[5]) : 0;
+	uint32_t num_symbols = (num_cells + 2) / 3;
+
+	Configuration::instance().init();
+	Configuration::instance().setVerbose(false); // no log file here
+	bool multicast = !Configuration::instance().getMulticastGroup().empty() && Configuration::instance().getMulticastPort() != 0;
+	uint64_t start = steady_us();
+
+	// excel's side: UpdateNotify from the notifier thread, RefreshData and recalc on its own thread
+	RtdServer server;
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool dirty = false;
+	uint64_t notifies = 0;
+	bool started = server.start();
+	std::thread notifier([&]() {
+		server.notify_loop([&]() {
+			std::lock_guard<std::mutex> __(mutex);
+			dirty = true;
+			notifies++;
+			cv.notify_one();
+		});
+	});
+
+	// workbook open
+	uint64_t connect_start = steady_us();
+	uint32_t waiting = 0;
+	for (uint32_t i = 0; i < num_cells; i++) {
+		VARIANT out;
+		VariantInit(&out);
+		if (server.connect(static_cast<LONG>(i), { "quote", symbolName(i / 3), TOPICS[i % 3] }, &out))
+			waiting += out.vt == VT_BSTR;
+		VariantClear(&out);
+	}
+	uint64_t connect_us = steady_us() - connect_start;
+
+	std::vector<uint64_t> expected(num_symbols, 0); // last t sent per symbol, in process only
+	std::atomic<bool> stop = false;
+	std::atomic<uint64_t> sent = 0;
+	std::thread feed([&]() {
+		aw::UDPSender sender(Configuration::instance().getInterface(), Configuration::instance().getMulticastGroup(), Configuration::instance().getMulticastPort());
+		if (multicast && !sender.start()) {
+			std::cout << "couldn't send to " << Configuration::instance().getMulticastGroup() << ":" << Configuration::instance().getMulticastPort() << std::endl;
+			return;
+		}
+		std::mt19937 rng(11);
+		Packet packet;
+		uint32_t per_ms = (std::max)(rate / 1000, 1u);
+		auto next = std::chrono::steady_clock::now();
+		while (!stop) {
+			for (uint32_t j = 0; j < per_ms; j++) {
+				uint32_t s = rng() % num_symbols;
+				uint64_t t = steady_us() - start;
+				packet.make(symbolName(s), t);
+				if (multicast)
+					sender.send(packet.data(), packet.size());
+				else
+					server.cache().onData(packet.data(), packet.size());
+				expected[s] = t;
+			}
+			sent += per_ms;
+			next += std::chrono::milliseconds(1);
+			std::this_thread::sleep_until(next);
+		}
+	});
+
+	std::vector<double> shown(num_cells, -1); // what the sheet shows, t of each cell's last value
+	std::vector<double> refresh_us, stale_us;
+	std::vector<size_t> cells;
+	uint64_t values = 0;
+	auto refresh = [&]() -> size_t {
+		uint64_t entered = steady_us();
+		RefreshBatch batch;
+		size_t count = server.refresh(batch);
+		long topic_count = 0;
+		SAFEARRAY* array = count ? batch.finish(&topic_count) : nullptr;
+		uint64_t now = steady_us();
+		refresh_us.push_back(static_cast<double>(now - entered));
+		cells.push_back(count);
+		if (!array)
+			return 0;
+		VARIANT* data = nullptr;
+		SafeArrayAccessData(array, reinterpret_cast<void**>(&data));
+		for (long i = 0; i < topic_count; i++) {
+			LONG id = data[2 * i].lVal;
+			const VARIANT& value = data[2 * i + 1];
+			double t = value.vt == VT_I8 ? static_cast<double>(value.llVal) : value.vt == VT_R8 ? value.dblVal : -1;
+			if (id >= 0 && id < static_cast<LONG>(num_cells))
+				shown[id] = t;
+			if (t >= 0)
+				stale_us.push_back(static_cast<double>(now - start) - t);
+		}
+		SafeArrayUnaccessData(array);
+		SafeArrayDestroy(array); // excel's side
+		values += count;
+		if (recalc_ns) {
+			uint64_t until = steady_us() + count * recalc_ns / 1000;
+			while (steady_us() < until)
+				;
+		}
+		return count;
+	};
+
+	uint64_t end = steady_us() + seconds * 1000000ull;
+	uint64_t last_refresh = 0;
+	while (steady_us() < end) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!cv.wait_for(lock, std::chrono::milliseconds(100), [&]() { return dirty; }))
+				continue;
+			dirty = false;
+		}
+		uint64_t due = last_refresh + throttle_us;
+		uint64_t now = steady_us();
+		if (last_refresh && now < due)
+			std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+		last_refresh = steady_us();
+		refresh();
+	}
+	stop = true;
+	feed.join();
+	// quiet feed: excel keeps refreshing while it is notified (several times with MaxRefreshBatch), no throttle
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!cv.wait_for(lock, std::chrono::milliseconds(500), [&]() { return dirty; }))
+				break;
+			dirty = false;
+		}
+		refresh();
+	}
+	server.stop();
+	notifier.join();
+
+	uint32_t wrong = 0;
+	if (!multicast && started) {
+		for (uint32_t i = 0; i < num_cells; i++) {
+			uint64_t t = expected[i / 3];
+			wrong += t != 0 && (shown[i] < t - 0.5 || shown[i] > t + 0.5);
+		}
+	}
+	size_t refreshes = cells.size();
+	double max_refresh = refresh_us.empty() ? 0 : *std::max_element(refresh_us.begin(), refresh_us.end());
+	double max_stale = stale_us.empty() ? 0 : *std::max_element(stale_us.begin(), stale_us.end());
+	size_t max_cells = cells.empty() ? 0 : *std::max_element(cells.begin(), cells.end());
+	std::cout << "cells " << num_cells << " (" << num_symbols << " symbols), feed " << (multicast ? "multicast" : "in process") << ", throttle " << throttle_us / 1000 << " ms"
+		<< std::endl << "  ConnectData: " << connect_us / 1000.0 << " ms, " << static_cast<double>(connect_us) * 1000 / (std::max)(num_cells, 1u) << " ns/cell, " << waiting << " WAITING"
+		<< std::endl << "  updates " << sent << " (" << sent / (std::max)(seconds, 1u) << "/s), notifications " << notifies << ", refreshes " << refreshes << ", values " << values
+		<< std::endl << "  RefreshData us: p50 " << percentile(refresh_us, 0.5) << " p99 " << percentile(refresh_us, 0.99) << " max " << max_refresh
+		<< std::endl << "  cells per refresh: mean " << (refreshes ? values / refreshes : 0) << " p50 " << percentile(cells, 0.5) << " max " << max_cells
+		<< std::endl << "  staleness ms (generated to RefreshData returned): p50 " << percentile(stale_us, 0.5) / 1000 << " p99 " << percentile(stale_us, 0.99) / 1000
+		<< " max " << max_stale / 1000 << std::endl;
+	if (!multicast)
+		std::cout << "  wrong last values " << wrong << std::endl;
+	bool ok = started && wrong == 0 && (seconds == 0 || values > 0);
+	std::cout << (ok ? "passed" : "FAILED") << std::endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// OptionsBench : OptionsEngine without excel or a feed, portable (linux: g++ -std=c++17 -O2 -mavx2 main.cpp)
+// builds chains of OCC symbols priced off a vol smile, then
+//	accuracy: engine iv/delta/gamma/vega against a scalar reference (std::erfc, bisection to machine precision)
+//	speed: underlying ticks reprice whole chains, options per second through evaluate()
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+
+#include "../RTDCore/options.h"
+
+namespace reference
+{
+	auto cdf(double x) -> double { return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+	auto price(double s, double k, double t, double r, double sign, double vol) -> double
+	{
+		double vs = vol * std::sqrt(t);
+		double d1 = (std::log(s / k) + (r + 0.5 * vol * vol) * t) / vs;
+		double d2 = d1 - vs;
+		return sign * (s * cdf(sign * d1) - k * std::exp(-r * t) * cdf(sign * d2));
+	}
+
+	auto implied_vol(double s, double k, double t, double r, double sign, double p) -> double
+	{
+		double lo = options::MIN_VOL, hi = options::MAX_VOL;
+		while (hi - lo > 1e-15 * hi) {
+			double mid = 0.5 * (lo + hi);
+			if (mid == lo || mid == hi)
+				break;
+			(price(s, k, t, r, sign, mid) > p ? hi : lo) = mid;
+		}
+		return 0.5 * (lo + hi);
+	}
+
+	struct Greeks
+	{
+		double m_delta, m_gamma, m_vega;
+	};
+
+	auto greeks(double s, double k, double t, double r, double sign, double vol) -> Greeks
+	{
+		double vs = vol * std::sqrt(t);
+		double d1 = (std::log(s / k) + (r + 0.5 * vol * vol) * t) / vs;
+		double pdf = std::exp(-0.5 * d1 * d1) * 0.3989422804014327; // 1 / sqrt(2 pi)
+		return Greeks{ sign * cdf(sign * d1), pdf / (s * vs), s * pdf * std::sqrt(t) * 0.01 };
+	}
+}
+
+struct Option
+{
+	std::string m_symbol;
+	options::Contract m_contract;
+	double m_spot;
+	double m_price;
+	double m_out[OptionsEngine<int>::NUM_OUTPUTS];
+};
+
+int main(int argc, char** argv)
+{
+	int num_roots = argc > 1 ? atoi(argv[1]) : 10;
+	int rounds = argc > 2 ? atoi(argv[2]) : 200;
+	const double rate = 0.03;
+	const uint64_t now = static_cast<uint64_t>(options::days_from_civil(2024, 1, 2) * 86400 + 14 * 3600 + 30 * 60) * 1000000;
+	const char* expiries[] = { "240119", "240216", "240315", "240621", "241220", "251219" };
+
+	std::vector<Option> chain;
+	for (int r = 0; r < num_roots; r++) {
+		std::string root = "RT" + std::to_string(r);
+		double spot = 80 + 5 * r;
+		for (const char* expiry : expiries) {
+			for (int strike = 50; strike <= 150; strike++) {
+				for (char cp : { 'C', 'P' }) {
+					char symbol[32];
+					snprintf(symbol, sizeof(symbol), "%-6s%s%c%08d", root.c_str(), expiry, cp, strike * 1000);
+					Option o;
+					o.m_symbol = symbol;
+					if (!options::parse_occ(o.m_symbol, o.m_contract)) {
+						std::cout << "didn't parse " << symbol << std::endl;
+						return -1;
+					}
+					o.m_spot = spot;
+					double t = static_cast<double>(o.m_contract.m_expiry_mks - now) / options::YEAR_MKS;
+					double m = std::log(strike / spot);
+					double vol = 0.2 + 0.3 * m * m - 0.05 * m + 0.02 * std::sqrt(t); // smile and term structure
+					o.m_price = reference::price(spot, strike, t, rate, cp == 'C' ? 1 : -1, vol);
+					chain.push_back(o);
+				}
+			}
+		}
+	}
+
+	// subscribe every output of every option, handle is option index * NUM_OUTPUTS + output
+	const int NUM_OUTPUTS = OptionsEngine<int>::NUM_OUTPUTS;
+	OptionsEngine<int> engine;
+	engine.set_rate(rate);
+	std::vector<OptionsEngine<int>::LegRef> legs;
+	std::vector<OptionsEngine<int>::Chain*> roots;
+	for (size_t i = 0; i < chain.size(); i++) {
+		OptionsEngine<int>::LegRef ref;
+		for (int o = 0; o < NUM_OUTPUTS; o++) {
+			bool new_chain = false;
+			ref = engine.subscribe(chain[i].m_symbol, chain[i].m_contract, o, static_cast<int>(i) * NUM_OUTPUTS + o, new_chain);
+			if (new_chain)
+				roots.push_back(ref.m_chain);
+		}
+		legs.push_back(ref);
+		engine.quote(ref, chain[i].m_price, now);
+		for (double& v : chain[i].m_out)
+			v = NAN;
+	}
+	auto publish = [&](int handle, double value) {
+		chain[handle / NUM_OUTPUTS].m_out[handle % NUM_OUTPUTS] = value;
+	};
+	for (size_t r = 0; r < roots.size(); r++)
+		engine.spot(*roots[r], 80 + 5.0 * r, now);
+	engine.evaluate(publish);
+
+	// accuracy where iv is well defined
+	double err[NUM_OUTPUTS] = {};
+	size_t checked = 0, missing = 0;
+	auto ref_start = std::chrono::steady_clock::now();
+	for (auto& o : chain) {
+		double t = static_cast<double>(o.m_contract.m_expiry_mks - now) / options::YEAR_MKS;
+		double sign = o.m_contract.m_call ? 1 : -1;
+		double iv = reference::implied_vol(o.m_spot, o.m_contract.m_strike, t, rate, sign, o.m_price);
+		auto g = reference::greeks(o.m_spot, o.m_contract.m_strike, t, rate, sign, iv);
+		if (g.m_vega < 1e-6)
+			continue; // time value under rounding of the price, no iv to speak of
+		if (std::isnan(o.m_out[0])) {
+			missing++;
+			continue;
+		}
+		const double expected[NUM_OUTPUTS] = { iv, g.m_delta, g.m_gamma, g.m_vega };
+		for (int k = 0; k < NUM_OUTPUTS; k++)
+			err[k] = (std::max)(err[k], std::fabs(o.m_out[k] - expected[k]));
+		checked++;
+	}
+	auto ref_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ref_start).count();
+	std::cout << "options: " << chain.size() << ", checked: " << checked << ", no value: " << missing << std::endl;
+	std::cout << "max abs error iv: " << err[0] << ", delta: " << err[1] << ", gamma: " << err[2] << ", vega: " << err[3] << std::endl;
+	bool ok = missing == 0 && err[0] < 1e-8 && err[1] < 1e-9 && err[2] < 1e-9 && err[3] < 1e-9;
+
+	// speed, every round moves every underlying by a cent so whole chains reprice
+	auto start = std::chrono::steady_clock::now();
+	size_t computed = 0;
+	for (int round = 0; round < rounds; round++) {
+		for (size_t r = 0; r < roots.size(); r++)
+			engine.spot(*roots[r], 80 + 5.0 * r + ((round & 1) ? 0.01 : -0.01), now + round * 1000);
+		computed += engine.evaluate(publish);
+	}
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << aw::simd::Vec::NAME << " engine options/s: " << static_cast<double>(computed) / ns * 1e9
+		<< ", scalar reference options/s: " << static_cast<double>(chain.size()) / ref_ns * 1e9 << std::endl;
+	std::cout << (ok ? "passed" : "FAILED") << std::endl;
+	return ok ? 0 : -1;
+}
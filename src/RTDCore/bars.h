@@ -0,0 +1,227 @@
+// bars.h
+// open/high/low/close/volume bars of mid per symbol, =RTD("AwRTDServer",,"quote","IBM","c1m")
+// topic is [p]<field><length><unit>, field: o, h, l, c, v, unit: s, m, h, "p" prefix is last completed bar
+//	ex: o1s, h1m, c5m (current bar), pc5m, pv1m (last completed bar)
+// bar i of interval I covers [i * I, (i + 1) * I) of feed time
+// a bar is closed either by the first tick of a later bar or by its timer on the shared aw::TimerWheel,
+// the wheel only holds bars that have ticks, so a minute boundary touches those bars and nothing else
+// a closed bar becomes "last", the new current bar shows flat at the last close with no volume until its first tick
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "../aw/timerwheel.h"
+#include "derived.h"
+
+struct Bar
+{
+	uint64_t m_index = 0; // start time / interval
+	double m_open = 0;
+	double m_high = 0;
+	double m_low = 0;
+	double m_close = 0;
+	double m_volume = 0;
+	uint64_t m_ticks = 0;
+};
+
+// Handle identifies the subscriber (DataCache uses Cell*)
+template<typename Handle>
+class BarTopics
+{
+public:
+	enum Field { OPEN, HIGH, LOW, CLOSE, VOLUME, NUM_FIELDS };
+	static constexpr uint64_t WHEEL_UNIT_MKS = 1000; // timer wheel runs in milliseconds
+
+	// bars of one interval, also the timer closing its current bar
+	struct Series : aw::TimerNode
+	{
+		Series(BarTopics* owner, uint64_t interval_mks) : m_owner(owner), m_interval_mks(interval_mks) {}
+		BarTopics* m_owner;
+		uint64_t m_interval_mks;
+		Bar m_cur;
+		Bar m_last;
+		bool m_has_cur = false;
+		bool m_has_last = false;
+	};
+
+	// false if topic is not a bar topic
+	static auto parse(const std::string& topic, int& field, bool& previous, uint64_t& interval_mks) -> bool
+	{
+		static const char names[NUM_FIELDS] = { 'o', 'h', 'l', 'c', 'v' };
+		size_t pos = 0;
+		previous = topic.size() > 1 && topic[0] == 'p';
+		if (previous)
+			pos++;
+		if (pos >= topic.size())
+			return false;
+		const char* f = std::find(names, names + NUM_FIELDS, topic[pos]);
+		if (f == names + NUM_FIELDS)
+			return false;
+		pos++;
+		size_t digits = pos;
+		uint64_t length = 0;
+		while (pos < topic.size() && topic[pos] >= '0' && topic[pos] <= '9' && length < 1000000)
+			length = length * 10 + (topic[pos++] - '0');
+		if (pos == digits || length == 0 || pos + 1 != topic.size())
+			return false;
+		uint64_t unit = topic[pos] == 's' ? 1 : topic[pos] == 'm' ? 60 : topic[pos] == 'h' ? 3600 : 0;
+		if (unit == 0 || length * unit > MAX_INTERVAL_SECONDS)
+			return false;
+		field = static_cast<int>(f - names);
+		interval_mks = length * unit * 1000000;
+		return true;
+	}
+
+	auto subscribe(int field, bool previous, uint64_t interval_mks, Handle cell) -> void
+	{
+		Series* series = nullptr;
+		for (auto& s : m_series) {
+			if (s->m_interval_mks == interval_mks)
+				series = s.get();
+		}
+		if (!series) {
+			m_series.push_back(std::make_unique<Series>(this, interval_mks));
+			series = m_series.back().get();
+		}
+		m_outputs.push_back(Output{ cell, field, previous, series });
+	}
+	// series (and its timer) goes with the last output using it
+	auto unsubscribe(Handle cell) -> void
+	{
+		for (size_t i = 0; i < m_outputs.size(); i++) {
+			if (m_outputs[i].m_cell != cell)
+				continue;
+			Series* series = m_outputs[i].m_series;
+			m_outputs[i] = m_outputs.back();
+			m_outputs.pop_back();
+			bool used = false;
+			for (auto& o : m_outputs)
+				used |= o.m_series == series;
+			if (!used) {
+				m_series.erase(std::find_if(m_series.begin(), m_series.end(), [series](const std::unique_ptr<Series>& s) { return s.get() == series; }));
+			}
+			return;
+		}
+	}
+	auto subscribed() const -> bool { return !m_outputs.empty(); }
+
+	// from data source side, one call per field of a packet (DerivedTopics::Input)
+	auto set(int input, double value) -> void
+	{
+		switch (input) {
+		case DerivedTopics::BID:
+			m_bid = value;
+			m_has |= 1u << input;
+			break;
+		case DerivedTopics::ASK:
+			m_ask = value;
+			m_has |= 1u << input;
+			break;
+		case DerivedTopics::VOL:
+			if ((m_has & (1u << input)) && value > m_last_volume)
+				m_volume_delta += value - m_last_volume;
+			m_last_volume = value;
+			m_has |= 1u << input;
+			break;
+		default:
+			break;
+		}
+	}
+
+	// once per packet, wheel must already be advanced to mks
+	template<typename Publish>
+	auto tick(uint64_t mks, aw::TimerWheel& wheel, Publish publish) -> void
+	{
+		double volume = m_volume_delta;
+		m_volume_delta = 0;
+		if ((m_has & QUOTE) != QUOTE)
+			return; // no price yet, nothing to put in a bar
+		double mid = (m_bid + m_ask) / 2;
+		for (auto& s : m_series) {
+			Series& series(*s);
+			uint64_t index = mks / series.m_interval_mks;
+			if (series.m_has_cur && index > series.m_cur.m_index)
+				close(series, index, publish);
+			else if (series.m_has_cur && index < series.m_cur.m_index)
+				index = series.m_cur.m_index; // late packet goes into current bar
+			Bar& bar(series.m_cur);
+			if (!series.m_has_cur || bar.m_ticks == 0) { // first tick opens the bar and arms its close
+				bar.m_index = index;
+				bar.m_open = bar.m_high = bar.m_low = mid;
+				series.m_has_cur = true;
+				wheel.schedule(series, (index + 1) * series.m_interval_mks / WHEEL_UNIT_MKS);
+			}
+			bar.m_high = (std::max)(bar.m_high, mid);
+			bar.m_low = (std::min)(bar.m_low, mid);
+			bar.m_close = mid;
+			bar.m_volume += volume;
+			bar.m_ticks++;
+			publish_series(series, false, publish);
+		}
+	}
+
+	// aw::TimerWheel fired for node, a Series of some BarTopics
+	template<typename Publish>
+	static auto on_timer(aw::TimerNode& node, Publish publish) -> void
+	{
+		Series& series(static_cast<Series&>(node));
+		if (series.m_has_cur && series.m_cur.m_ticks > 0)
+			series.m_owner->close(series, series.m_cur.m_index + 1, publish);
+	}
+
+private:
+	static constexpr uint64_t MAX_INTERVAL_SECONDS = 24 * 3600;
+	static constexpr uint32_t QUOTE = (1u << DerivedTopics::BID) | (1u << DerivedTopics::ASK);
+
+	struct Output
+	{
+		Handle m_cell;
+		int m_field;
+		bool m_previous;
+		Series* m_series;
+	};
+
+	// current bar becomes last, next bar starts flat at close
+	template<typename Publish>
+	auto close(Series& series, uint64_t next_index, Publish publish) -> void
+	{
+		series.cancel();
+		if (series.m_cur.m_ticks > 0) {
+			series.m_last = series.m_cur;
+			series.m_has_last = true;
+			publish_series(series, true, publish);
+		}
+		Bar& bar(series.m_cur);
+		double close = bar.m_close;
+		bar = Bar();
+		bar.m_index = next_index;
+		bar.m_open = bar.m_high = bar.m_low = bar.m_close = close;
+		publish_series(series, false, publish);
+	}
+
+	template<typename Publish>
+	auto publish_series(const Series& series, bool previous, Publish publish) -> void
+	{
+		const Bar& bar(previous ? series.m_last : series.m_cur);
+		for (auto& o : m_outputs) {
+			if (o.m_series != &series || o.m_previous != previous)
+				continue;
+			double value = o.m_field == OPEN ? bar.m_open : o.m_field == HIGH ? bar.m_high :
+				o.m_field == LOW ? bar.m_low : o.m_field == CLOSE ? bar.m_close : bar.m_volume;
+			publish(o.m_cell, value);
+		}
+	}
+
+	std::vector<std::unique_ptr<Series>> m_series; // unique_ptr: wheel links point into Series
+	std::vector<Output> m_outputs;
+	double m_bid = 0;
+	double m_ask = 0;
+	double m_last_volume = 0;
+	uint32_t m_has = 0; // DerivedTopics::Input bits seen
+	double m_volume_delta = 0; // since last tick()
+};
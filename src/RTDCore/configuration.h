@@ -0,0 +1,187 @@
+// configuration.h
+// settings of the server, read from a configuration source: read(name, value) is false when it has no such setting
+// windows: values of the key regsvr32 registered (HKEY_CLASSES_ROOT\AwRTDServer.RTDFunctions), elsewhere environment
+// variables named AWRTD_ and the setting (AWRTD_MulticastGroup=239.1.1.1), load() takes any other source
+
+#pragma once
+
+#ifdef _WIN64
+#include <wtypes.h>
+#else
+#include <stdlib.h>
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+
+#include "../aw/logger.h"
+
+// formatted only when verbose, ConnectData logs per cell
+#define AW_LOG(x) { if (Configuration::instance().getVerbose()) { std::stringstream ss; ss << x; std::string s(ss.str()); aw::logger::log(s); } }
+
+class Configuration {
+public:
+	static Configuration& instance() {
+		static Configuration __instance;
+		return __instance;
+	}
+
+	static constexpr const char* command = "quote";
+	static constexpr const char* expr_command = "expr"; // =RTD("AwRTDServer",,"expr","IBM.bid-MSFT.ask*0.5")
+	static constexpr const char* depth_command = "depth"; // =RTD("AwRTDServer",,"depth","IBM","bid3")
+
+	// settings from the platform's source, false if it isn't there (defaults stay)
+	auto init() -> bool
+	{
+#ifdef _WIN64
+		HKEY hkey;
+		// registry format, HKEY_CLASSES_ROOT is one of 5 root dir that should have AwRTDServer.RTDFunctions in it after regsvr cmd
+		if (ERROR_SUCCESS != RegOpenKeyEx(HKEY_CLASSES_ROOT, "AwRTDServer.RTDFunctions", 0, KEY_READ, &hkey)) {
+			return false;
+		}
+		load([hkey](const char* token, std::string& value) { return readRegistry(hkey, token, value); });
+		RegCloseKey(hkey);
+#else
+		load(readEnvironment);
+#endif
+		return true;
+	}
+
+	// settings from read(name, value), a missing one gets its default
+	template<typename F>
+	auto load(F read) -> void
+	{
+		std::string value;
+		m_verbose = read("Verbose", value) ? (value == "1" ? true : false) : true;
+		m_log_dir = read("LogDir", value) ? value : "E:\\AwRTDlog";
+		m_multicast_group = read("MulticastGroup", value) ? value : "";
+		m_multicast_port = read("MulticastPort", value) ? std::stoi(value) : 0;
+		m_depth_multicast_port = read("DepthMulticastPort", value) ? std::stoi(value) : 0; // level 2 on same group, 0: none
+		m_interface = read("Interface", value) ? value : "";
+		m_risk_free_rate = read("RiskFreeRate", value) ? std::stod(value) : 0; // continuous, 0.05 is 5%
+		m_tick_store_dir = read("TickStoreDir", value) ? value : ""; // empty: no tick history
+		m_snapshot_file = read("SnapshotFile", value) ? value : ""; // empty: no warm start
+		m_snapshot_seconds = read("SnapshotSeconds", value) ? std::stoi(value) : 10;
+		m_shared_feed = read("SharedFeed", value) ? value : ""; // FeedHandler shared memory name, empty: join multicast
+		m_deadband = read("Deadband", value) ? value : ""; // "bid=1t,ask=1t,*=0.01%", 4th RTD argument overrides
+		m_tick_size = read("TickSize", value) ? std::stod(value) : 0.01;
+		m_notify_min_ms = read("NotifyMinMs", value) ? std::stoi(value) : 10; // UpdateNotify at most this often
+		m_notify_max_ms = read("NotifyMaxMs", value) ? std::stoi(value) : 2000; // widest interval a slow excel gets
+		m_max_refresh_batch = read("MaxRefreshBatch", value) ? std::stoi(value) : 0; // values per RefreshData, 0: all
+		m_stale_ms = read("StaleMs", value) ? value : ""; // "IBM=500,*=5000": no packet for that long marks a symbol stale
+	}
+
+	auto getVerbose() -> bool
+	{
+		return m_verbose;
+	}
+
+	auto setVerbose(bool verbose) -> void { m_verbose = verbose; } // stress tests turn logging off
+
+	auto getLogDir() -> std::string { return m_log_dir; }
+
+	auto getMulticastGroup() -> std::string { return m_multicast_group; }
+
+	auto getMulticastPort() -> int { return m_multicast_port; }
+
+	auto getDepthMulticastPort() -> int { return m_depth_multicast_port; }
+
+	auto getInterface() -> std::string { return m_interface; }
+
+	auto getRiskFreeRate() -> double { return m_risk_free_rate; }
+
+	auto getTickStoreDir() -> std::string { return m_tick_store_dir; }
+	auto setTickStoreDir(const std::string& dir) -> void { m_tick_store_dir = dir; } // stress tests use a scratch dir
+
+	auto getSnapshotFile() -> std::string { return m_snapshot_file; }
+	auto setSnapshotFile(const std::string& file) -> void { m_snapshot_file = file; }
+
+	auto getSnapshotSeconds() -> int { return m_snapshot_seconds; }
+
+	auto getSharedFeed() -> std::string { return m_shared_feed; }
+	auto setSharedFeed(const std::string& name) -> void { m_shared_feed = name; }
+
+	auto getDeadband() -> std::string { return m_deadband; }
+	auto setDeadband(const std::string& list) -> void { m_deadband = list; }
+
+	auto getTickSize() -> double { return m_tick_size; }
+
+	auto getNotifyMinMs() -> int { return m_notify_min_ms; }
+	auto getNotifyMaxMs() -> int { return m_notify_max_ms; }
+
+	auto getMaxRefreshBatch() -> int { return m_max_refresh_batch; }
+	auto setMaxRefreshBatch(int max) -> void { m_max_refresh_batch = max; }
+
+	auto getStaleMs() -> std::string { return m_stale_ms; }
+	auto setStaleMs(const std::string& list) -> void { m_stale_ms = list; }
+
+	auto notifyCounter() -> uint64_t { return m_notify_counter; }
+	auto notifyCounter(uint64_t val) -> void { m_notify_counter = val; }
+	auto incrementNotify() -> uint64_t { return m_notify_counter++; }
+	auto incrementRefresh() -> uint64_t { return m_refresh_counter++; }
+	auto refreshCounter() -> uint64_t { return m_refresh_counter; }
+	auto refreshCounter(uint64_t val) -> void { m_refresh_counter = val; }
+	// time excel's thread spent inside RefreshData, microseconds
+	auto addRefreshBlocked(uint64_t mks) -> uint64_t { return m_refresh_blocked_mks += mks; }
+	auto refreshBlocked() -> uint64_t { return m_refresh_blocked_mks; }
+
+	auto readVerbose() -> void { // update verbose if changed in the source
+		std::string value;
+#ifdef _WIN64
+		HKEY hkey;
+		if (ERROR_SUCCESS != RegOpenKeyEx(HKEY_CLASSES_ROOT, "AwRTDServer.RTDFunctions", 0, KEY_READ, &hkey)) {
+			return;
+		}
+		m_verbose = readRegistry(hkey, "Verbose", value) ? (value == "1" ? true : false) : true;
+		RegCloseKey(hkey);
+#else
+		m_verbose = readEnvironment("Verbose", value) ? (value == "1" ? true : false) : true;
+#endif
+	}
+
+private:
+
+#ifdef _WIN64
+	static auto readRegistry(HKEY hkey, const char* token, std::string& value) -> bool
+	{
+		char buf[1024];
+		DWORD bufsize = sizeof(buf);
+		if (ERROR_SUCCESS != RegQueryValueEx(hkey, token, NULL, NULL, (LPBYTE)buf, &bufsize)) {
+			return false;
+		}
+		value = buf;
+		return true;
+	}
+#else
+	static auto readEnvironment(const char* token, std::string& value) -> bool
+	{
+		const char* env = getenv((std::string("AWRTD_") + token).c_str());
+		if (!env)
+			return false;
+		value = env;
+		return true;
+	}
+#endif
+
+	std::string m_multicast_group;
+	int m_multicast_port = 0;
+	int m_depth_multicast_port = 0;
+	std::string m_interface;
+	double m_risk_free_rate = 0;
+	std::string m_tick_store_dir;
+	std::string m_snapshot_file;
+	int m_snapshot_seconds = 10;
+	std::string m_shared_feed;
+	std::string m_deadband;
+	double m_tick_size = 0.01;
+	int m_notify_min_ms = 10;
+	int m_notify_max_ms = 2000;
+	int m_max_refresh_batch = 0;
+	std::string m_stale_ms;
+	bool m_verbose = true;
+	std::string m_log_dir = "E:\\aw\\var";
+	std::atomic<uint64_t> m_notify_counter = 0;
+	std::atomic<uint64_t> m_refresh_counter = 0;
+	std::atomic<uint64_t> m_refresh_blocked_mks = 0;
+};
\ No newline at end of file
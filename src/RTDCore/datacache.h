@@ -0,0 +1,1761 @@
+#pragma once
+
+#include "variant.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+
+#include "../aw/udp.h"
+#include "../aw/pacer.h"
+#include "../aw/event.h"
+#include "../aw/timerwheel.h"
+#include "udpdata.h"
+#include "configuration.h"
+#include "symbolfilter.h"
+#include "derived.h"
+#include "rolling.h"
+#include "bars.h"
+#include "expression.h"
+#include "options.h"
+#include "depth.h"
+#include "tickstore.h"
+#include "snapshot.h"
+#include "lastvalues.h"
+#include "journal.h"
+#include "deadband.h"
+#include "refreshqueue.h"
+#include "refreshbatch.h"
+#include "refreshbuffer.h"
+#include "stringpool.h"
+
+struct SymbolData;
+
+// cell owns its VARIANT (BSTR included, unless it's pooled text, m_text), so it is never copied
+struct Cell
+{
+	Cell() { VariantInit(&m_var); }
+	Cell(const Cell&) = delete;
+	Cell& operator=(const Cell&) = delete;
+	~Cell()
+	{
+		release_text();
+		VariantClear(&m_var);
+	}
+
+	auto update(const VARIANT& var) -> void
+	{
+		AW_LOG("Cell update: topic<" << m_topic << "> topic_ids<" << m_topic_ids.size());
+		release_text();
+		VariantClear(&m_var);
+		VariantCopy(&m_var, &var);
+		if (m_journal) {
+			int64_t raw = 0;
+			if (m_band >= 0 && Deadband::raw(m_var, raw) && std::abs(raw - m_sent) < m_band)
+				m_journal->hold(); // excel keeps the last value it got, expressions still see this one
+			else {
+				m_changes++;
+				m_journal->touch(m_slot);
+			}
+		}
+		if (m_graph)
+			m_graph->touch(m_dependents);
+	}
+
+	// "tms" cell only keeps raw microseconds from the feed, text is made when excel pulls it
+	auto update_timestamp(uint64_t mks) -> void
+	{
+		m_mks = mks;
+		m_changes++;
+		if (m_journal)
+			m_journal->touch(m_slot);
+	}
+
+	// excel TopicIDs plus expressions reading this cell, cell is reclaimed at 0
+	auto users() const -> size_t
+	{
+		return m_topic_ids.size() + m_dependents.size();
+	}
+
+	// numeric value for expressions, NaN if none yet
+	auto value() const -> double
+	{
+		switch (m_var.vt) {
+		case VT_R8: return m_var.dblVal;
+		case VT_I8: return static_cast<double>(m_var.llVal);
+		case VT_I4: return static_cast<double>(m_var.lVal);
+		default: return NAN;
+		}
+	}
+
+	// subscriber key: excel TopicIDs are per instance, the DataCache::View they came through makes them unique
+	static auto key(uint32_t view, LONG topic_id) -> uint64_t { return static_cast<uint64_t>(view) << 32 | static_cast<uint32_t>(topic_id); }
+	static auto view_of(uint64_t key) -> uint32_t { return static_cast<uint32_t>(key >> 32); }
+	static auto topic_id_of(uint64_t key) -> LONG { return static_cast<LONG>(static_cast<uint32_t>(key)); }
+
+	// excel got m_var (RefreshData or ConnectData), the deadband is centered on it
+	auto delivered() -> void
+	{
+		if (m_deadband.enabled() && Deadband::raw(m_var, m_sent))
+			m_band = m_deadband.width(m_sent, m_var.vt != VT_R8);
+	}
+	// another sheet subscribing with a different band only narrows it
+	auto set_deadband(const Deadband& band, bool first) -> void
+	{
+		m_deadband = first ? band : m_deadband.tighter(band);
+		if (!m_deadband.enabled())
+			m_band = -1;
+		else if (m_band >= 0)
+			m_band = m_deadband.width(m_sent, m_var.vt != VT_R8);
+	}
+
+	auto set_topic(const std::string& topic, uint64_t topic_id) -> bool
+	{
+		m_topic = topic;
+		return add_topic_id(topic_id);
+	}
+
+	// returns true if topic_id (key()) is a new subscriber
+	auto add_topic_id(uint64_t topic_id) -> bool
+	{
+		if (std::find(m_topic_ids.begin(), m_topic_ids.end(), topic_id) != m_topic_ids.end())
+			return false;
+		m_topic_ids.push_back(topic_id);
+		return true;
+	}
+
+	// returns true if topic_id (key()) was subscribed, refcount is m_topic_ids.size()
+	auto remove_topic_id(uint64_t topic_id) -> bool
+	{
+		auto it = std::find(m_topic_ids.begin(), m_topic_ids.end(), topic_id);
+		if (it == m_topic_ids.end())
+			return false;
+		*it = m_topic_ids.back(); // order doesn't matter, swap and pop
+		m_topic_ids.pop_back();
+		return true;
+	}
+
+	auto format_timestamp(aw::TimestampFormatter& formatter, StringPool& strings) -> void
+	{
+		char buf[aw::TimestampFormatter::SIZE];
+		size_t len = formatter.format(m_mks, buf);
+		set_text(strings, buf, len);
+	}
+
+	// m_var shows the pooled text (its BSTR, not a copy), VT_EMPTY if out of memory
+	auto set_text(StringPool& strings, const char* text, size_t len) -> void
+	{
+		StringPool::Entry* entry = strings.intern(text, len); // before the old one is released: same text, same entry
+		release_text();
+		VariantClear(&m_var);
+		if (!entry)
+			return;
+		m_text = entry;
+		m_strings = &strings;
+		m_var.vt = VT_BSTR;
+		m_var.bstrVal = entry->m_bstr;
+	}
+	auto release_text() -> void
+	{
+		if (!m_text)
+			return;
+		m_strings->release(m_text);
+		m_text = nullptr;
+		m_var.vt = VT_EMPTY; // the pool's BSTR, not freed here
+	}
+
+	bool m_is_timestamp = false;
+	bool m_is_derived = false; // computed by DerivedTopics, RollingTopics or BarTopics, feed can't overwrite it
+	uint64_t m_mks = 0; // only for m_is_timestamp
+	StringPool::Entry* m_text = nullptr; // m_var's BSTR belongs to it when set
+	StringPool* m_strings = nullptr;
+	VARIANT m_var;
+	std::vector<uint64_t> m_topic_ids; // key()s, same symbol/topic can be on many sheets, usually only one or two
+	std::string m_topic;
+	SymbolData* m_owner = nullptr; // nullptr for "expr" cells, m_topic is then the expression text
+	std::vector<uint32_t> m_dependents; // ExpressionGraph nodes reading this cell
+	ExpressionGraph<Cell*>* m_graph = nullptr; // set once m_dependents is used
+	uint32_t m_node = 0; // "expr" cells only, node computing this cell
+	ChangeJournal<Cell*>* m_journal = nullptr; // set while the cell has users, changes are recorded there
+	uint32_t m_slot = 0; // in m_journal
+	Deadband m_deadband;
+	int64_t m_sent = 0; // raw value excel last got, while m_band >= 0
+	int64_t m_band = -1; // changes smaller than this are held, -1: none (no deadband or nothing sent yet)
+	int m_priority = RefreshQueue::NORMAL; // hottest of its subscribers
+	bool m_stale = false; // its symbol missed the StaleMs deadline, readers of changes (consume()) get it with the value
+	uint64_t m_changes = 0; // value changes recorded, a record without one only flipped m_stale (excel isn't sent those)
+};
+
+struct SymbolData
+{
+	// StaleMs deadline in DataCache's stale wheel while the symbol is subscribed
+	struct StaleTimer : aw::TimerNode
+	{
+		StaleTimer(SymbolData* symbol) : m_symbol(symbol) {}
+		SymbolData* m_symbol;
+	};
+
+	SymbolData() {}
+
+	SymbolData(const std::string& symbol_name) : m_symbol_name(symbol_name)
+	{}
+
+	// from excel side, topic_id is Cell::key()
+	auto add(const std::string& topic, uint64_t topic_id) -> Cell&
+	{
+		Cell& cell(m_fields[topic]);
+		if (cell.set_topic(topic, topic_id)) {
+			m_refcount++;
+			if (cell.users() == 1)
+				attach(cell);
+		}
+		return cell;
+	}
+	// expression node reads this topic, counts like a TopicID
+	auto add_dependent(const std::string& topic, uint32_t node) -> Cell&
+	{
+		Cell& cell(m_fields[topic]);
+		cell.m_topic = topic;
+		cell.m_dependents.push_back(node);
+		m_refcount++;
+		if (cell.users() == 1)
+			attach(cell);
+		return cell;
+	}
+	// drops topic_id from cell, cell itself is reclaimed once nobody subscribes to it
+	auto remove(Cell& cell, uint64_t topic_id) -> void
+	{
+		if (!cell.remove_topic_id(topic_id))
+			return;
+		m_refcount--;
+		if (cell.users() == 0)
+			detach(cell);
+	}
+	auto remove_dependent(Cell& cell, uint32_t node) -> void
+	{
+		auto it = std::find(cell.m_dependents.begin(), cell.m_dependents.end(), node);
+		if (it == cell.m_dependents.end())
+			return;
+		*it = cell.m_dependents.back();
+		cell.m_dependents.pop_back();
+		m_refcount--;
+		if (cell.users() == 0)
+			detach(cell);
+	}
+	// first user of cell, hooks it to whatever computes its topic
+	auto attach(Cell& cell) -> void
+	{
+		const std::string& topic(cell.m_topic);
+		cell.m_owner = this;
+		cell.m_journal = m_journal; // before anything below publishes a first value
+		cell.m_slot = m_journal->add(&cell);
+		if (topic == TIMESTAMP_TOPIC) {
+			cell.m_is_timestamp = true;
+			m_tms = &cell;
+		}
+		if (topic == STALE_TOPIC) {
+			m_stale = &cell;
+			cell.m_is_derived = true;
+			publish(cell, m_live && !m_expired ? 0 : 1);
+		}
+		cell.m_stale = m_expired;
+		int output = DerivedTopics::output(topic);
+		if (output >= 0) {
+			if (!m_derived)
+				m_derived = std::make_unique<DerivedTopics>();
+			m_derived->subscribe(output);
+			m_derived_cells[output] = &cell;
+			cell.m_is_derived = true;
+		}
+		int aggregate = 0;
+		uint64_t window_mks = 0;
+		if (RollingTopics<Cell*>::parse(topic, aggregate, window_mks)) {
+			if (!m_rolling)
+				m_rolling = std::make_unique<RollingTopics<Cell*>>();
+			m_rolling->subscribe(aggregate, window_mks, &cell);
+			cell.m_is_derived = true;
+		}
+		bool previous = false;
+		if (BarTopics<Cell*>::parse(topic, aggregate, previous, window_mks)) {
+			if (!m_bars)
+				m_bars = std::make_unique<BarTopics<Cell*>>();
+			m_bars->subscribe(aggregate, previous, window_mks, &cell);
+			cell.m_is_derived = true;
+		}
+		int side = 0;
+		size_t rank = 0;
+		if (DepthTopics<Cell*>::parse(topic, side, aggregate, rank)) {
+			if (!m_depth)
+				m_depth = std::make_unique<DepthTopics<Cell*>>();
+			m_depth->subscribe(side, aggregate, rank, &cell);
+			cell.m_is_derived = true;
+			if (m_depth->live()) { // book from before the subscription
+				m_depth->flush(SCALE, [](Cell* cell, double value) {
+					publish(*cell, value);
+				});
+			}
+		}
+		uint32_t field = 0;
+		uint64_t arg = 0;
+		if (m_ticks && HistoryTopics<Cell*>::parse(topic, field, aggregate, arg)) {
+			if (!m_history)
+				m_history = std::make_unique<HistoryTopics<Cell*>>();
+			m_history->subscribe(field, aggregate, arg, &cell);
+			cell.m_is_derived = true;
+			update_history(); // history from before the subscription (or the restart) shows right away
+		}
+	}
+	// last user of cell gone
+	auto detach(Cell& cell) -> void
+	{
+		if (&cell == m_tms)
+			m_tms = nullptr;
+		if (&cell == m_stale)
+			m_stale = nullptr;
+		int output = DerivedTopics::output(cell.m_topic);
+		if (output >= 0) {
+			m_derived->unsubscribe(output);
+			m_derived_cells[output] = nullptr;
+			if (!m_derived->subscribed())
+				m_derived.reset();
+		}
+		if (m_rolling) {
+			m_rolling->unsubscribe(&cell);
+			if (!m_rolling->subscribed())
+				m_rolling.reset();
+		}
+		if (m_bars) {
+			m_bars->unsubscribe(&cell);
+			if (!m_bars->subscribed())
+				m_bars.reset();
+		}
+		if (m_depth)
+			m_depth->unsubscribe(&cell); // book stays, the next depth subscriber starts from it
+		if (m_history) {
+			m_history->unsubscribe(&cell);
+			if (!m_history->subscribed())
+				m_history.reset();
+		}
+		m_journal->remove(cell.m_slot); // records of this cell still in the ring are skipped from now on
+		m_fields.erase(std::string(cell.m_topic)); // copy key, erase destroys cell
+	}
+	// back to just constructed state, keeps map buckets around for the next symbol
+	auto reset() -> void
+	{
+		m_fields.clear();
+		m_symbol_name.clear();
+		m_refcount = 0;
+		m_tms = nullptr;
+		m_timestamp = 0;
+		m_derived.reset();
+		std::fill(std::begin(m_derived_cells), std::end(m_derived_cells), nullptr);
+		m_rolling.reset();
+		m_bars.reset();
+		m_depth.reset();
+		m_ticks = nullptr;
+		m_history.reset();
+		m_stale = nullptr;
+		m_live = false;
+		m_stale_timer.cancel();
+		m_stale_ms = 0;
+		m_updated_ms = 0;
+		m_expired = false;
+		m_leg = OptionsEngine<Cell*>::LegRef();
+		m_chain = nullptr;
+		m_bid = m_ask = NAN;
+	}
+
+	// from data source side, only subscribed topics are stored
+	auto update(const std::string topic, const VARIANT& var) -> void
+	{
+		if (m_derived || m_rolling || m_bars || m_leg.m_chain || m_chain) {
+			int input = DerivedTopics::input(topic);
+			if (input >= 0) {
+				double value = var.vt == VT_I8 ? static_cast<double>(var.llVal) : var.dblVal;
+				if (input == DerivedTopics::BID)
+					m_bid = value;
+				else if (input == DerivedTopics::ASK)
+					m_ask = value;
+				if (m_derived)
+					m_derived->set(input, value);
+				if (m_rolling)
+					m_rolling->set(input, value);
+				if (m_bars)
+					m_bars->set(input, value);
+			}
+		}
+		auto it = m_fields.find(topic);
+		if (it == m_fields.end() || it->second.m_is_derived)
+			return;
+		AW_LOG("SymbolData update: symbol<" << m_symbol_name << "> topic<" << topic << "> var<" << var.vt);
+		it->second.update(var);
+	}
+	// once per packet after all its fields went through update(), mks is packet timestamp
+	// bar_wheel must already be advanced to mks, option analytics only get the new mid, they are solved on refresh
+	auto compute_derived(uint64_t mks, aw::TimerWheel& bar_wheel, aw::TimerWheel& rolling_wheel, OptionsEngine<Cell*>& options) -> void
+	{
+		if (m_leg.m_chain || m_chain) {
+			double mid = (m_bid + m_ask) / 2;
+			if (!std::isnan(mid)) {
+				if (m_leg.m_chain)
+					options.quote(m_leg, mid, mks);
+				if (m_chain)
+					options.spot(*m_chain, mid, mks);
+			}
+		}
+		if (m_derived) {
+			m_derived->compute([this](int output, double value) {
+				publish(*m_derived_cells[output], value);
+			});
+		}
+		if (m_rolling) {
+			m_rolling->tick(mks, rolling_wheel, [](Cell* cell, double value) {
+				publish(*cell, value);
+			});
+		}
+		if (m_bars) {
+			m_bars->tick(mks, bar_wheel, [](Cell* cell, double value) {
+				publish(*cell, value);
+			});
+		}
+	}
+	// every field of the packet goes to the log, subscribed or not
+	auto store(const std::vector<std::pair<std::string, VARIANT>>& topic_var, uint64_t mks, TickStore& ticks) -> void
+	{
+		for (auto& it : topic_var) {
+			double value = it.second.vt == VT_I8 ? static_cast<double>(it.second.llVal) : it.second.dblVal;
+			ticks.count(m_ticks->append(mks, TickLog::code(it.first), value));
+		}
+		update_history();
+	}
+	auto update_history() -> void
+	{
+		if (m_history) {
+			m_history->update(*m_ticks, [](Cell* cell, double value) {
+				publish(*cell, value);
+			});
+		}
+	}
+	// NaN (hi/lo of a window that drained) leaves the cell empty
+	static auto publish(Cell& cell, double value) -> void
+	{
+		VARIANT var;
+		VariantInit(&var);
+		if (!std::isnan(value)) {
+			var.vt = VT_R8;
+			var.dblVal = value;
+		}
+		cell.update(var);
+	}
+	// once per packet, stale_wheel's clock is the last update time: the deadline isn't moved here but when it fires
+	// (DataCache::expire()), a symbol that went stale is fresh again and its deadline set from now
+	auto update_timestamp(uint64_t mks, aw::TimerWheel& stale_wheel) -> void
+	{
+		m_timestamp = mks;
+		m_updated_ms = stale_wheel.now();
+		if (m_tms)
+			m_tms->update_timestamp(mks);
+		if (m_live && !m_expired)
+			return;
+		m_live = true;
+		if (m_expired) {
+			m_expired = false;
+			stale_wheel.schedule(m_stale_timer, m_updated_ms + m_stale_ms);
+			flag_stale(false);
+		}
+		if (m_stale)
+			publish(*m_stale, 0);
+	}
+	// no packet for m_stale_ms, the next one clears it
+	auto expire() -> void
+	{
+		m_expired = true;
+		flag_stale(true);
+		if (m_stale)
+			publish(*m_stale, 1);
+	}
+	// every cell of the symbol with the flag, recorded so readers of changes see it, m_changes stays: RefreshData
+	// doesn't send excel a value it already has (the "stale" topic is how excel sees it)
+	auto flag_stale(bool stale) -> void
+	{
+		for (auto& field : m_fields) {
+			Cell& cell(field.second);
+			cell.m_stale = stale;
+			if (&cell != m_stale && !cell.m_is_timestamp)
+				m_journal->touch(cell.m_slot);
+		}
+	}
+
+	static constexpr const char* TIMESTAMP_TOPIC = "tms";
+	// 1 until the first packet (values so far came from the snapshot) and while no packet came for StaleMs
+	static constexpr const char* STALE_TOPIC = "stale";
+
+	std::string m_symbol_name;
+	uint64_t m_timestamp = 0; // microseconds from epoch of last packet
+	Cell* m_tms = nullptr; // subscribed "tms" cell, saves a lookup per packet
+	std::unique_ptr<DerivedTopics> m_derived; // only while a derived topic is subscribed
+	Cell* m_derived_cells[DerivedTopics::NUM_OUTPUTS] = {};
+	std::unique_ptr<RollingTopics<Cell*>> m_rolling; // only while a rolling topic is subscribed
+	std::unique_ptr<BarTopics<Cell*>> m_bars; // only while a bar topic is subscribed
+	std::unique_ptr<DepthTopics<Cell*>> m_depth; // level 2 book, from the first depth update or topic until released
+	TickLog* m_ticks = nullptr; // owned by DataCache's TickStore, nullptr if no TickStoreDir
+	std::unique_ptr<HistoryTopics<Cell*>> m_history; // only while a history topic is subscribed
+	Cell* m_stale = nullptr;
+	bool m_live = false; // a packet arrived since the symbol was subscribed
+	StaleTimer m_stale_timer{ this };
+	uint32_t m_stale_ms = 0; // StaleMs of the symbol, 0: never stale once live
+	uint64_t m_updated_ms = 0; // last packet, DataCache's stale wheel clock
+	bool m_expired = false; // no packet for m_stale_ms, m_stale_timer isn't scheduled meanwhile
+	OptionsEngine<Cell*>::LegRef m_leg; // option symbol with analytics subscribed
+	OptionsEngine<Cell*>::Chain* m_chain = nullptr; // underlying of a chain with analytics subscribed
+	double m_bid = NAN; // last quote, kept while m_leg or m_chain is set
+	double m_ask = NAN;
+	uint32_t m_refcount = 0; // number of excel TopicIDs and expression inputs on any cell of this symbol
+	ChangeJournal<Cell*>* m_journal = nullptr; // DataCache's, set for the pool's lifetime
+	std::unordered_map<std::string, Cell> m_fields;
+};
+
+class DataCache : public aw::IUDPListener
+{
+public:
+	struct Stats
+	{
+		size_t m_symbols = 0; // subscribed symbols
+		size_t m_pooled = 0; // SymbolData ever allocated (high water mark)
+		size_t m_free = 0; // SymbolData waiting on free list
+		size_t m_cells = 0;
+		size_t m_topic_ids = 0;
+		uint64_t m_filtered = 0; // packets dropped by the ingest filter
+		uint64_t m_filter_rebuilds = 0;
+		size_t m_expressions = 0; // distinct "expr" texts
+		uint64_t m_evaluated = 0; // expression evaluations so far
+		size_t m_options = 0; // option symbols with analytics subscribed
+		uint64_t m_options_computed = 0; // implied vol solves so far
+		uint64_t m_ticks_stored = 0; // rows appended to the tick store
+		uint64_t m_ticks_dropped = 0; // rows lost because a segment couldn't be created
+		size_t m_tick_logs = 0; // symbols with their tick log mapped
+		uint64_t m_snapshot_entries = 0; // in the snapshot lookups use
+		uint64_t m_seeded = 0; // cells that started from the snapshot
+		uint64_t m_journal_head = 0; // change records written so far
+		uint64_t m_journal_rescans = 0; // times a consumer fell a whole ring behind and caught up from the cells
+		uint64_t m_deadband_held = 0; // cell changes excel never saw (each one a recalculation saved)
+		uint64_t m_deadband_quiet = 0; // packets of subscribed symbols that didn't wake excel because of it
+		size_t m_stale = 0; // subscribed symbols past their StaleMs deadline
+		size_t m_stale_timers = 0; // StaleMs deadlines waiting in the wheel
+		size_t m_views = 0; // excel instances on the cache, the cache's own view included
+		size_t m_instances = 0; // started by start_shared(), the feed runs while there's one
+		size_t m_refresh_backlog = 0; // cells changed but not handed to excel yet (MaxRefreshBatch)
+		uint64_t m_refresh_carried = 0; // refreshes that left cells for the next one
+		size_t m_refresh_pending = 0; // values staged for the next refresh
+		uint64_t m_refresh_overwrites = 0; // changes written over a value still waiting in the pending batch
+		size_t m_strings_live = 0; // distinct text values cells or placeholders hold
+		size_t m_strings_idle = 0; // kept for reuse
+		uint64_t m_strings_hits = 0; // texts found already pooled
+		uint64_t m_strings_allocations = 0; // BSTRs the pool made, steady state adds none
+	};
+
+	DataCache() : m_tick_store(Configuration::instance().getTickStoreDir()),
+		m_snapshot(Configuration::instance().getSnapshotFile()), m_depth_listener(*this) {}
+	DataCache(const DataCache&) = delete;
+	DataCache& operator=(const DataCache&) = delete;
+	~DataCache()
+	{
+		if (m_instances)
+			stop(); // the last instance went without ServerTerminate
+	}
+
+	// again after stop() too (a shared cache restarted by the next instance)
+	auto start() -> bool
+	{
+		m_options.set_rate(Configuration::instance().getRiskFreeRate());
+		m_stopping = false;
+		m_stop_polling = false;
+		if (m_snapshot.enabled()) {
+			m_checkpoint_thread = std::thread([this]() {
+				std::chrono::seconds period((std::max)(Configuration::instance().getSnapshotSeconds(), 1));
+				std::unique_lock<std::mutex> lock(m_stop_mutex);
+				while (!m_stop_cv.wait_for(lock, period, [this]() { return m_stopping; })) {
+					lock.unlock();
+					checkpoint();
+					lock.lock();
+				}
+			});
+		}
+		// a FeedHandler process already decodes the feed for this machine: poll its table instead of joining
+		if (!Configuration::instance().getSharedFeed().empty()) {
+			if (open_shared_feed()) {
+				m_poll_thread = std::thread([this]() {
+					while (!m_stop_polling.load(std::memory_order_relaxed)) {
+						size_t polled = poll_shared_feed();
+						expire_now();
+						if (polled == 0)
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+				});
+				// the table only holds the quote fields, level 2 is still joined
+				if (Configuration::instance().getDepthMulticastPort() == 0)
+					return true;
+				AW_LOG("DataCache: depth from multicast port " << Configuration::instance().getDepthMulticastPort());
+				add_depth_channel();
+				return m_udp.start();
+			}
+			AW_LOG("DataCache: shared feed<" << Configuration::instance().getSharedFeed() << "> not found, joining multicast");
+		}
+		if (!m_channels_added) {
+			m_channels_added = true;
+			m_udp.addChannel(Configuration::instance().getInterface(), Configuration::instance().getMulticastGroup(), Configuration::instance().getMulticastPort(), this);
+		}
+		add_depth_channel();
+		return m_udp.start();
+	}
+
+	auto stop() -> bool
+	{
+		if (m_poll_thread.joinable()) {
+			m_stop_polling = true;
+			m_poll_thread.join();
+		}
+		m_udp.stop(); // quotes, or only depth under SharedFeed
+		if (m_checkpoint_thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> __(m_stop_mutex);
+				m_stopping = true;
+			}
+			m_stop_cv.notify_one();
+			m_checkpoint_thread.join();
+			checkpoint(); // last values as of shutdown
+		}
+		return true;
+	}
+
+	// writes last values to the snapshot, the lock is held only to copy them, false if disabled or the file failed
+	auto checkpoint() -> bool
+	{
+		if (!m_snapshot.enabled())
+			return false;
+		std::lock_guard<std::mutex> _(m_checkpoint_mutex);
+		m_checkpoint_entries.clear();
+		{
+			std::lock_guard<std::mutex> __(m_mutex);
+			for (auto& it : m_symbols) {
+				SymbolData& sd(*it.second);
+				for (auto& field : sd.m_fields) {
+					Snapshot::Entry entry;
+					if (!field.second.m_is_timestamp && &field.second != sd.m_stale &&
+						Snapshot::make(sd.m_symbol_name, field.first, field.second.m_var, sd.m_timestamp, entry))
+						m_checkpoint_entries.push_back(entry);
+				}
+			}
+		}
+		uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		aw::MappedFile file;
+		if (!m_snapshot.build(m_checkpoint_entries, now, file))
+			return false;
+		std::lock_guard<std::mutex> __(m_mutex);
+		m_snapshot.swap(std::move(file));
+		return true;
+	}
+
+	// ConnectData of a quote or depth cell, parsed by RtdServer (its scratch, copied when queued)
+	struct Connect
+	{
+		LONG m_topic_id = -1;
+		std::string m_symbol;
+		std::string m_topic;
+		Deadband m_band;
+		bool m_has_band = false;
+		int m_priority = RefreshQueue::NORMAL;
+	};
+
+	// one excel instance on the cache (AwRTD through RtdServer): its TopicIDs, its cursor on the journal, its refresh
+	// queue and batches, its notifier's pacer and event; symbols, cells and the feed are the cache's, shared by all
+	// the cache's own calls below (add, get, ...) go through its built-in view, instances sharing the process's cache
+	// (shared()) attach one each, whatever a view still has connected is disconnected when it goes
+	class View
+	{
+	public:
+		View(DataCache& cache) : m_cache(cache)
+		{
+			m_pacer.set_interval(Configuration::instance().getNotifyMinMs() * 1000ull, Configuration::instance().getNotifyMaxMs() * 1000ull);
+			std::lock_guard<std::mutex> __(m_cache.m_mutex);
+			auto it = std::find(m_cache.m_views.begin(), m_cache.m_views.end(), nullptr);
+			m_id = static_cast<uint32_t>(it - m_cache.m_views.begin());
+			if (it == m_cache.m_views.end())
+				m_cache.m_views.push_back(this);
+			else
+				*it = this;
+			m_consumer = m_cache.m_journal.add_consumer(false);
+		}
+		View(const View&) = delete;
+		View& operator=(const View&) = delete;
+		~View()
+		{
+			std::lock_guard<std::mutex> __(m_cache.m_mutex);
+			m_cache.apply_connects_no_lock();
+			for (size_t i = 0; i < m_topic_index.size(); i++)
+				remove_no_lock(static_cast<LONG>(i));
+			m_cache.m_journal.remove_consumer(m_consumer);
+			m_cache.m_views[m_id] = nullptr;
+		}
+
+		// current (or last known, from the snapshot) value goes to known if there is one, returns false if none
+		// band: 4th RTD argument, nullptr for the Deadband setting, priority: RefreshQueue class of this TopicID
+		auto add(const std::string& symbol, const std::string& topic, LONG topic_id, VARIANT* known = nullptr, const Deadband* band = nullptr,
+			int priority = RefreshQueue::NORMAL) -> bool
+		{
+			if (topic_id < 0)
+				return false;
+			std::lock_guard<std::mutex> __(m_cache.m_mutex);
+			m_cache.apply_connects_no_lock();
+			return m_cache.known_no_lock(add_no_lock(symbol, topic, topic_id, band, priority), known);
+		}
+		// add() that never blocks behind the feed: with the lock still taken after a few tries the connect is queued and
+		// false returned (excel shows WAITING), whoever takes the lock next applies the queue in one go (the next
+		// ConnectData finding it free, RefreshData, DisconnectData, the notifier thread) and a queued cell's known value
+		// goes out with the next RefreshData, with the lock free the queue and this one go in under it and known gets
+		// the value like add()
+		auto connect(const Connect& connect, VARIANT* known) -> bool
+		{
+			if (connect.m_topic_id < 0)
+				return false;
+			std::unique_lock<std::mutex> lock(m_cache.m_mutex, std::defer_lock);
+			for (int i = 0; i < CONNECT_SPINS && !lock.try_lock(); i++)
+				std::this_thread::yield();
+			if (!lock.owns_lock()) {
+				{
+					std::lock_guard<std::mutex> __(m_connect_mutex);
+					if (m_queued_connects < MAX_QUEUED_CONNECTS) {
+						if (m_queued_connects == m_connects.size())
+							m_connects.emplace_back();
+						m_connects[m_queued_connects++] = connect; // assigned over an old one, its strings' buffers are reused
+						m_connects_queued = m_queued_connects;
+						if (m_queued_connects == 1)
+							m_notify_event.set(); // the notifier thread applies them if nobody else does
+						return false;
+					}
+				}
+				lock.lock(); // queue full, this one waits
+			}
+			m_cache.apply_connects_no_lock();
+			return m_cache.known_no_lock(add_no_lock(connect.m_symbol, connect.m_topic, connect.m_topic_id,
+				connect.m_has_band ? &connect.m_band : nullptr, connect.m_priority), known);
+		}
+		// ConnectData queued by connect() but not applied yet, read without the lock
+		auto connects_queued() const -> size_t { return m_connects_queued; }
+		// "expr" command, same text from many TopicIDs shares one node, false with error if text doesn't parse
+		// known: VT_EMPTY, or the value with every input known (the node runs now instead of on the next solve)
+		auto add_expression(const std::string& text, LONG topic_id, std::string& error, VARIANT* known = nullptr) -> bool
+		{
+			if (known)
+				VariantInit(known);
+			if (topic_id < 0)
+				return false;
+			Expression expr;
+			if (!expr.parse(text, error))
+				return false;
+			std::lock_guard<std::mutex> __(m_cache.m_mutex);
+			m_cache.apply_connects_no_lock();
+			if (find_no_lock(topic_id))
+				remove_no_lock(topic_id);
+			resume_no_lock();
+			Cell& cell(m_cache.add_expression_no_lock(text, std::move(expr)));
+			bool has_value = false;
+			if (known) {
+				bool moved = false;
+				has_value = m_cache.m_exprs.evaluate(cell.m_node, [](Cell* input) {
+					return input->value();
+				}, [&moved](Cell* output, double value) {
+					SymbolData::publish(*output, value);
+					moved = true;
+				});
+				if (moved) // other TopicIDs on the same text hear of it, this one isn't on the cell yet so it only gets known
+					m_cache.stage_no_lock(this);
+			}
+			cell.add_topic_id(Cell::key(m_id, topic_id));
+			index_no_lock(cell, topic_id);
+			if (has_value)
+				m_cache.known_no_lock(&cell, known);
+			return true;
+		}
+		// excel DisconnectData, returns false if topic_id was not connected
+		auto remove(LONG topic_id) -> bool
+		{
+			std::lock_guard<std::mutex> __(m_cache.m_mutex);
+			m_cache.apply_connects_no_lock(); // topic_id may still be queued
+			return remove_no_lock(topic_id);
+		}
+		// O(1) lookup of the cell excel TopicID points to, nullptr if not connected
+		auto find(LONG topic_id) -> Cell*
+		{
+			std::lock_guard<std::mutex> __(m_cache.m_mutex);
+			m_cache.apply_connects_no_lock();
+			return find_no_lock(topic_id);
+		}
+		// RefreshData: the pending batch the feed side kept up to date is swapped with the spare under the lock, its values
+		// are then moved into the array excel gets, returns how many (0: batch not started)
+		// at most MaxRefreshBatch values by priority, the rest waits in the queue and excel is notified again
+		auto get(RefreshBatch& batch) -> size_t
+		{
+			std::lock_guard<std::mutex> _(m_handout_mutex);
+			{
+				std::lock_guard<std::mutex> __(m_cache.m_mutex);
+				if (m_cache.apply_connects_no_lock())
+					m_cache.stage_no_lock(this); // queued ConnectData's known values go out with this refresh
+				swap_no_lock();
+			}
+			size_t count = m_spare.size();
+			if (count == 0)
+				return 0;
+			if (!batch.start(count)) {
+				notify(); // out of memory, kept in the spare for the next refresh
+				return 0;
+			}
+			m_spare.move_to(batch);
+			return batch.size();
+		}
+		// same into pairs the caller owns (VariantClear), stages first: tools and tests have no notifier thread
+		auto get(std::vector<std::pair<VARIANT, VARIANT>>& data) -> void
+		{
+			stage();
+			std::lock_guard<std::mutex> _(m_handout_mutex);
+			{
+				std::lock_guard<std::mutex> __(m_cache.m_mutex);
+				swap_no_lock();
+			}
+			m_spare.move_to(data);
+		}
+		// notifier thread, before UpdateNotify: option legs and expressions are solved, backlog beyond the last batch and
+		// changes not staged by the feed side (bar closes of other symbols) go into the pending batch, other views are
+		// notified of what the solving changed for them
+		auto stage() -> void
+		{
+			std::lock_guard<std::mutex> __(m_cache.m_mutex);
+			m_cache.apply_connects_no_lock();
+			m_cache.evaluate_no_lock();
+			m_cache.stage_no_lock(this);
+		}
+		// the notifier thread polls it, RefreshData reports pulls
+		auto pacer() -> aw::NotifyPacer& { return m_pacer; }
+		// set on the first change since excel pulled, the notifier thread waits on it
+		auto notify_event() -> aw::Event& { return m_notify_event; }
+
+	private:
+		friend class DataCache;
+
+		// this view's side of a cell, by journal slot (the slot's generation tells a new cell from the one before)
+		struct Staged
+		{
+			uint32_t m_generation = 0;
+			uint32_t m_topic_ids = 0; // this view's TopicIDs on the cell
+			bool m_queued = false; // waiting in m_refresh_queue
+			uint64_t m_staged = 0; // refresh epoch whose pending buffer has the cell's values, 0: none
+			size_t m_staged_at = 0; // first pair there
+			size_t m_staged_count = 0; // TopicIDs written there
+			uint64_t m_changes = 0; // Cell::m_changes last staged, the same in a record: only the stale flag moved
+		};
+
+		auto state(const Cell& cell) -> Staged&
+		{
+			if (cell.m_slot >= m_staged.size())
+				m_staged.resize((std::max)(static_cast<size_t>(cell.m_slot) + 1, m_staged.size() * 2));
+			Staged& s(m_staged[cell.m_slot]);
+			uint32_t generation = m_cache.m_journal.generation(cell.m_slot);
+			if (s.m_generation != generation) {
+				s = Staged();
+				s.m_generation = generation;
+			}
+			return s;
+		}
+
+		// something this view's excel sees changed, the notifier thread only needs waking for the first change since it pulled
+		auto notify() -> void
+		{
+			if (m_pacer.changed())
+				m_notify_event.set();
+		}
+
+		// TopicID's cell, made or shared, nullptr for a negative topic_id
+		auto add_no_lock(const std::string& symbol, const std::string& topic, LONG topic_id, const Deadband* band, int priority) -> Cell*
+		{
+			if (topic_id < 0)
+				return nullptr;
+			if (find_no_lock(topic_id)) // excel reused TopicID without DisconnectData
+				remove_no_lock(topic_id);
+			resume_no_lock();
+			SymbolData& sd(m_cache.acquire_no_lock(symbol));
+			Cell& cell(sd.add(topic, Cell::key(m_id, topic_id))); // unordered_map nodes never move, safe to keep address
+			if (cell.users() == 1) {
+				m_cache.attach_option_no_lock(sd, cell);
+				m_cache.seed_no_lock(sd, cell);
+			}
+			if (!cell.m_is_derived && !cell.m_is_timestamp) {
+				if (!band)
+					band = m_cache.configured_deadband_no_lock(topic);
+				cell.set_deadband(band ? *band : Deadband(), cell.m_topic_ids.size() == 1);
+			}
+			cell.m_priority = cell.m_topic_ids.size() == 1 ? priority : (std::min)(cell.m_priority, priority);
+			index_no_lock(cell, topic_id);
+			return &cell;
+		}
+		// before the first TopicID's cell is made: the cursor moves to now, changes while nothing was connected aren't
+		// this view's (and aren't read, see stage_no_lock())
+		auto resume_no_lock() -> void
+		{
+			if (m_subscriptions > 0)
+				return;
+			m_cache.m_journal.remove_consumer(m_consumer);
+			m_consumer = m_cache.m_journal.add_consumer(false);
+		}
+		// cell has topic_id now
+		auto index_no_lock(Cell& cell, LONG topic_id) -> void
+		{
+			m_subscriptions++;
+			state(cell).m_topic_ids++;
+			if (static_cast<size_t>(topic_id) >= m_topic_index.size())
+				m_topic_index.resize((std::max)(static_cast<size_t>(topic_id) + 1, m_topic_index.size() * 2), nullptr);
+			m_topic_index[topic_id] = &cell;
+		}
+
+		auto find_no_lock(LONG topic_id) -> Cell*
+		{
+			if (topic_id < 0 || static_cast<size_t>(topic_id) >= m_topic_index.size())
+				return nullptr;
+			return m_topic_index[topic_id];
+		}
+
+		auto remove_no_lock(LONG topic_id) -> bool
+		{
+			Cell* cell = find_no_lock(topic_id);
+			if (!cell)
+				return false;
+			m_topic_index[topic_id] = nullptr;
+			m_subscriptions--;
+			// a value waiting in the pending batch mustn't go to a TopicID excel disconnected, the ones left get it again
+			Staged& s(state(*cell));
+			bool restage = unstage_no_lock(s) && s.m_topic_ids > 1;
+			s.m_topic_ids--;
+			uint64_t key = Cell::key(m_id, topic_id);
+			if (!cell->m_owner) {
+				m_cache.remove_expression_no_lock(*cell, key);
+			}
+			else {
+				if (cell->users() == 1)
+					m_cache.detach_option_no_lock(*cell);
+				SymbolData* sd = cell->m_owner;
+				sd->remove(*cell, key); // cell may be gone after this
+				if (sd->m_refcount == 0)
+					m_cache.release_no_lock(sd);
+			}
+			if (restage) // still has this view's TopicIDs, so still there
+				stage_cell_no_lock(*cell, s);
+			return true;
+		}
+
+		// feed side, after every change: this view's changed cells go into its pending batch, one already there is
+		// overwritten in place, at most MaxRefreshBatch values by priority, the rest waits in the queue for a batch after
+		// returns true if a cell of this view changed
+		auto stage_no_lock() -> bool
+		{
+			if (m_subscriptions == 0)
+				return false;
+			bool changed = false;
+			m_cache.m_journal.consume(m_consumer, [&](Cell* cell) {
+				Staged& s(state(*cell));
+				if (s.m_queued || s.m_topic_ids == 0 || s.m_changes == cell->m_changes)
+					return;
+				changed = true;
+				if (s.m_staged != m_epoch) {
+					requeue_no_lock(*cell, s);
+					return;
+				}
+				stage_cell_no_lock(*cell, s);
+				m_refresh_overwrites++;
+			});
+			size_t staged = m_pending.size();
+			if (m_refresh_queue.empty() || (m_max_batch && staged >= m_max_batch))
+				return changed;
+			m_refresh_queue.pop(m_max_batch ? m_max_batch - staged : 0, [&](uint32_t slot, uint32_t generation) -> size_t {
+				Cell* cell = nullptr;
+				if (!m_cache.m_journal.find(slot, generation, cell))
+					return 0;
+				Staged& s(state(*cell));
+				s.m_queued = false;
+				return s.m_topic_ids ? stage_cell_no_lock(*cell, s) : 0;
+			});
+			return changed;
+		}
+		// one value fans out to every TopicID of this view on the cell, written into the pending RefreshBuffer, in place
+		// if the cell is already there (moved again if its TopicIDs changed since), returns values written
+		auto stage_cell_no_lock(Cell& cell, Staged& s) -> size_t
+		{
+			if (cell.m_is_timestamp)
+				cell.format_timestamp(m_cache.m_tms_formatter, m_cache.m_strings);
+			if (s.m_staged != m_epoch || s.m_staged_count != s.m_topic_ids) {
+				unstage_no_lock(s);
+				s.m_staged = m_epoch;
+				s.m_staged_at = m_pending.append(s.m_topic_ids);
+				s.m_staged_count = s.m_topic_ids;
+			}
+			s.m_changes = cell.m_changes;
+			size_t i = 0;
+			for (uint64_t key : cell.m_topic_ids) {
+				if (Cell::view_of(key) == m_id)
+					m_pending.set(s.m_staged_at + i++, Cell::topic_id_of(key), cell.m_var);
+			}
+			cell.delivered();
+			return s.m_staged_count;
+		}
+		// out of the pending buffer, returns false if it wasn't there
+		auto unstage_no_lock(Staged& s) -> bool
+		{
+			if (s.m_staged != m_epoch)
+				return false;
+			m_pending.erase(s.m_staged_at, s.m_staged_count);
+			s.m_staged = 0;
+			return true;
+		}
+		auto requeue_no_lock(Cell& cell, Staged& s) -> void
+		{
+			s.m_queued = true;
+			m_refresh_queue.push(cell.m_slot, m_cache.m_journal.generation(cell.m_slot), cell.m_priority);
+		}
+		// excel pulls, under m_handout_mutex: the pending batch becomes the spare (emptied by the last handout) and the
+		// other way round, a spare still full (array couldn't be made) takes the pending values behind its own instead
+		// cells staged so far are in an older epoch from here on, their next change goes into the new pending batch
+		auto swap_no_lock() -> void
+		{
+			if (m_spare.empty())
+				m_pending.swap(m_spare);
+			else
+				m_pending.move_to(m_spare);
+			m_epoch++;
+			if (!m_refresh_queue.empty())
+				m_refresh_carried++;
+			if (!m_refresh_queue.empty() || m_cache.m_journal.behind(m_consumer) || m_cache.m_exprs.dirty() || m_cache.m_options.dirty())
+				notify(); // the notifier thread stages them, see stage()
+		}
+		// connect()'s queue, in the order excel called, returns true if a cell with a value now waits for RefreshData
+		auto apply_connects_no_lock() -> bool
+		{
+			if (m_connects_queued == 0)
+				return false;
+			size_t count = 0;
+			{
+				std::lock_guard<std::mutex> __(m_connect_mutex);
+				m_connects.swap(m_applying); // both keep their Connects, and with them their strings' buffers
+				count = m_queued_connects;
+				m_queued_connects = 0;
+				m_connects_queued = 0;
+			}
+			bool requeued = false;
+			for (size_t i = 0; i < count; i++) {
+				const Connect& c(m_applying[i]);
+				Cell* cell = add_no_lock(c.m_symbol, c.m_topic, c.m_topic_id, c.m_has_band ? &c.m_band : nullptr, c.m_priority);
+				if (!cell || cell->m_is_timestamp || cell->m_var.vt == VT_EMPTY)
+					continue;
+				Staged& s(state(*cell));
+				if (s.m_queued)
+					continue;
+				requeue_no_lock(*cell, s); // excel showed WAITING, it gets the value it would have had from ConnectData
+				requeued = true;
+			}
+			if (requeued)
+				notify();
+			return requeued;
+		}
+
+		static constexpr size_t MAX_QUEUED_CONNECTS = 65536;
+		static constexpr int CONNECT_SPINS = 8; // connect()'s tries, yielding between, before it queues: the feed holds the lock a packet at a time
+
+		DataCache& m_cache;
+		uint32_t m_id = 0; // in m_cache.m_views, high half of this view's Cell::key()s
+		uint32_t m_consumer = 0; // this view's cursor on the journal
+		size_t m_subscriptions = 0; // TopicIDs connected
+		std::vector<Cell*> m_topic_index; // indexed by excel TopicID (excel hands them out densely from 0)
+		std::vector<Staged> m_staged; // by journal slot
+		RefreshQueue m_refresh_queue; // RefreshData's side of the journal, only used under the cache's m_mutex
+		RefreshBuffer m_pending; // next refresh's values, under the cache's m_mutex
+		RefreshBuffer m_spare; // being handed out, under m_handout_mutex (swapped under both)
+		uint64_t m_epoch = 1; // of m_pending, Staged::m_staged
+		uint64_t m_refresh_overwrites = 0;
+		uint64_t m_refresh_carried = 0;
+		std::mutex m_handout_mutex; // one RefreshData at a time, taken before the cache's m_mutex
+		size_t m_max_batch = static_cast<size_t>((std::max)(Configuration::instance().getMaxRefreshBatch(), 0));
+		aw::NotifyPacer m_pacer;
+		aw::Event m_notify_event;
+		std::vector<Connect> m_connects; // connect()'s queue, first m_queued_connects, under m_connect_mutex
+		size_t m_queued_connects = 0;
+		std::vector<Connect> m_applying; // swapped with m_connects, under the cache's m_mutex
+		std::atomic<size_t> m_connects_queued = 0; // m_queued_connects for readers without the lock
+		std::mutex m_connect_mutex; // taken after the cache's m_mutex or alone
+	};
+
+	// the process's cache: every excel instance (RtdServer) attaches a View to it instead of having a cache, socket and
+	// receive thread each, made by the first caller, gone with the last reference
+	static auto shared() -> std::shared_ptr<DataCache>
+	{
+		static std::mutex mutex;
+		static std::weak_ptr<DataCache> instance;
+		std::lock_guard<std::mutex> __(mutex);
+		std::shared_ptr<DataCache> cache = instance.lock();
+		if (!cache) {
+			cache = std::make_shared<DataCache>();
+			instance = cache;
+		}
+		return cache;
+	}
+	// ServerStart and ServerTerminate of the instances sharing the cache: the feed starts with the first one and
+	// stops with the last
+	auto start_shared() -> bool
+	{
+		std::lock_guard<std::mutex> __(m_instances_mutex);
+		if (m_instances++ == 0)
+			m_instances_started = start();
+		return m_instances_started;
+	}
+	auto stop_shared() -> bool
+	{
+		std::lock_guard<std::mutex> __(m_instances_mutex);
+		if (m_instances == 0 || --m_instances > 0)
+			return true;
+		return stop();
+	}
+
+	// access from excel side, through the cache's own view (tools, tests), see View
+	auto add(const std::string& symbol, const std::string& topic, LONG topic_id, VARIANT* known = nullptr, const Deadband* band = nullptr,
+		int priority = RefreshQueue::NORMAL) -> bool
+	{
+		return m_view.add(symbol, topic, topic_id, known, band, priority);
+	}
+	auto connect(const Connect& connect, VARIANT* known) -> bool { return m_view.connect(connect, known); }
+	auto connects_queued() const -> size_t { return m_view.connects_queued(); }
+	auto add_expression(const std::string& text, LONG topic_id, std::string& error, VARIANT* known = nullptr) -> bool
+	{
+		return m_view.add_expression(text, topic_id, error, known);
+	}
+	auto remove(LONG topic_id) -> bool { return m_view.remove(topic_id); }
+	auto find(LONG topic_id) -> Cell* { return m_view.find(topic_id); }
+	auto get(RefreshBatch& batch) -> size_t { return m_view.get(batch); }
+	auto get(std::vector<std::pair<VARIANT, VARIANT>>& data) -> void { m_view.get(data); }
+	auto stage() -> void { m_view.stage(); }
+	auto pacer() -> aw::NotifyPacer& { return m_view.pacer(); }
+	auto notify_event() -> aw::Event& { return m_view.notify_event(); }
+
+	// ConnectData queued by any view, applied now (the notifier thread, a burst after the first one)
+	auto apply_connects() -> void
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		apply_connects_no_lock();
+	}
+	// ConnectData's "WAITING", made once in the pool and never released, so no lock for excel's copy
+	auto waiting(VARIANT* out) -> bool
+	{
+		return StringPool::copy(m_waiting, *out);
+	}
+	// ConnectData's placeholder or error text ("WAITING", "#EXPR ..."), made once in the pool, out gets excel's copy
+	auto text(const std::string& text, VARIANT* out) -> bool
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		StringPool::Entry* entry = m_strings.intern(text.data(), text.size());
+		if (!entry)
+			return false;
+		bool copied = StringPool::copy(entry, *out);
+		m_strings.release(entry); // idle, the next ConnectData finds it
+		return copied;
+	}
+	// other readers of the changes (recorder, logger, a second sheet), each sees every change no matter who else reads
+	// from_start: the first consume hands out every cell that has a value
+	auto add_consumer(bool from_start) -> uint32_t
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		return m_journal.add_consumer(from_start);
+	}
+	auto remove_consumer(uint32_t consumer) -> void
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		m_journal.remove_consumer(consumer);
+	}
+	// f(symbol, topic, value, stale) for every cell changed since this consumer's last call, latest value only, returns how
+	// many, stale: the symbol is past its StaleMs deadline (the cell comes again with false on its next packet)
+	// "expr" cells come as symbol "expr" with the expression text as topic, f runs under the lock
+	template<typename F>
+	auto consume(uint32_t consumer, F f) -> size_t
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		evaluate_no_lock();
+		return m_journal.consume(consumer, [&](Cell* cell) {
+			if (cell->m_is_timestamp)
+				cell->format_timestamp(m_tms_formatter, m_strings);
+			f(cell->m_owner ? cell->m_owner->m_symbol_name : std::string(Configuration::expr_command), cell->m_topic, cell->m_var, cell->m_stale);
+		});
+	}
+	auto stats() -> Stats
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		Stats st;
+		st.m_symbols = m_symbols.size();
+		st.m_pooled = m_symbol_pool.size();
+		st.m_free = m_free_symbols.size();
+		for (auto& it : m_symbols)
+		{
+			st.m_cells += it.second->m_fields.size();
+			st.m_topic_ids += it.second->m_refcount;
+			st.m_stale += it.second->m_expired;
+		}
+		st.m_stale_timers = m_stale_wheel.size();
+		st.m_filtered = m_filtered;
+		st.m_filter_rebuilds = m_filter.rebuilds();
+		st.m_expressions = m_exprs.size();
+		st.m_evaluated = m_exprs.evaluated();
+		st.m_options = m_options.size();
+		st.m_options_computed = m_options.computed();
+		st.m_ticks_stored = m_tick_store.rows();
+		st.m_ticks_dropped = m_tick_store.dropped();
+		st.m_tick_logs = m_tick_store.logs();
+		st.m_snapshot_entries = m_snapshot.entries();
+		st.m_seeded = m_seeded;
+		st.m_journal_head = m_journal.head();
+		st.m_journal_rescans = m_journal.rescans();
+		st.m_deadband_held = m_journal.held();
+		st.m_deadband_quiet = m_deadband_quiet;
+		st.m_instances = m_instances;
+		for (const View* view : m_views) {
+			if (!view)
+				continue;
+			st.m_views++;
+			st.m_refresh_backlog += view->m_refresh_queue.size();
+			st.m_refresh_carried += view->m_refresh_carried;
+			st.m_refresh_pending += view->m_pending.size();
+			st.m_refresh_overwrites += view->m_refresh_overwrites;
+		}
+		st.m_strings_live = m_strings.live();
+		st.m_strings_idle = m_strings.idle();
+		st.m_strings_hits = m_strings.hits();
+		st.m_strings_allocations = m_strings.allocations();
+		return st;
+	}
+	// from data source side (can't update from excel), unsubscribed symbol/topic is dropped
+	auto update(const std::string& symbol, const std::string& topic, const VARIANT& var) -> void
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		auto it = m_symbols.find(symbol);
+		if (it == m_symbols.end())
+			return;
+		uint64_t mks = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		advance_bars(mks);
+		it->second->update(topic, var);
+		it->second->compute_derived(mks, m_bar_wheel, m_rolling_wheel, m_options);
+		stage_no_lock();
+	}
+	// from data source side (can't update from excel) for lists, mks is packet timestamp
+	// false if excel has nothing new to pull: symbol not subscribed or every change held by its deadband
+	auto update(const std::string& symbol, const std::vector<std::pair<std::string, VARIANT>>& topic_var, uint64_t mks) -> bool
+	{
+		std::lock_guard<std::mutex> __(m_mutex);
+		advance_bars(mks);
+		auto it = m_symbols.find(symbol);
+		if (it == m_symbols.end())
+			return false;
+		uint64_t touches = m_journal.touches();
+		uint64_t held = m_journal.held();
+		for (uint32_t i = 0; i < topic_var.size(); i++) {
+			it->second->update(topic_var[i].first, topic_var[i].second);
+		}
+		if (it->second->m_ticks)
+			it->second->store(topic_var, mks, m_tick_store);
+		it->second->compute_derived(mks, m_bar_wheel, m_rolling_wheel, m_options);
+		it->second->update_timestamp(mks, m_stale_wheel);
+		bool touched = m_journal.touches() != touches;
+		if (touched)
+			stage_no_lock();
+		else if (m_journal.held() != held)
+			m_deadband_quiet++;
+		return touched;
+	}
+
+	// implement IUDPListener interface
+	auto onData(const char* data, size_t size) -> void override
+	{
+		// assert(size == sizeof(EnhancedUDPData)); // sender may not fill all fields, may send less than 368 bytes
+		if (size < offsetof(EnhancedUDPData, m_fields))
+			return;
+		const auto* myData = reinterpret_cast<const EnhancedUDPData*>(data);
+		// only the fixed 24 byte symbol is looked at before deciding, nobody watching means no decode and no lock
+		if (m_filter.contains(myData->m_symbol)) {
+			decode(*myData, size); // views with a changed cell are notified as it's staged
+		}
+		else {
+			m_filtered.store(m_filtered.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // feed thread is the only writer, no locked add
+		}
+		m_filter.quiescent();
+		expire_now();
+	}
+	auto onIdle() -> void override
+	{
+		expire_now();
+	}
+
+	// ingest thread (feed, shared feed poll), every packet and idle millisecond, now_ms from clock_ms(): symbols whose
+	// StaleMs deadline passed without a packet go stale, the lock is taken at most once a millisecond, never without
+	// StaleMs, a wheel step per millisecond and a timer per symbol and deadline, not a scan of the symbols
+	auto expire(uint64_t now_ms) -> void
+	{
+		if (m_stale_list.empty() || now_ms <= m_expired_ms)
+			return;
+		m_expired_ms = now_ms;
+		std::lock_guard<std::mutex> __(m_mutex);
+		expire_no_lock(now_ms);
+	}
+	// expire() on the ingest thread's clock, not even read without StaleMs
+	auto expire_now() -> void
+	{
+		if (!m_stale_list.empty())
+			expire(clock_ms());
+	}
+	// StaleMs clock
+	static auto clock_ms() -> uint64_t
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// DepthMulticastPort into m_depth_listener once, with or without the quote channel
+	auto add_depth_channel() -> void
+	{
+		if (m_depth_channel_added || Configuration::instance().getDepthMulticastPort() == 0)
+			return;
+		m_depth_channel_added = true;
+		m_udp.addChannel(Configuration::instance().getInterface(), Configuration::instance().getMulticastGroup(), Configuration::instance().getDepthMulticastPort(), &m_depth_listener);
+	}
+	// SharedFeed name, read only mapping of the FeedHandler's last value table
+	auto open_shared_feed() -> bool
+	{
+		return m_shared.open(Configuration::instance().getSharedFeed());
+	}
+	// takes the feed thread's place: changes since last poll go through the filter then update() like a packet,
+	// consecutive fields of one symbol in one update(), returns changes seen
+	auto poll_shared_feed() -> size_t
+	{
+		std::string symbol;
+		std::vector<std::pair<std::string, VARIANT>> topic_var;
+		uint64_t mks = 0;
+		auto flush = [&]() {
+			if (topic_var.empty())
+				return;
+			update(symbol, topic_var, mks);
+			topic_var.clear();
+		};
+		size_t count = m_shared.poll([&](const lastvalues::Value& v) {
+			if (!m_filter.contains(v.m_symbol)) {
+				m_filtered.store(m_filtered.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return;
+			}
+			size_t len = strnlen(v.m_symbol, sizeof(v.m_symbol));
+			if (symbol.compare(0, std::string::npos, v.m_symbol, len) != 0) {
+				flush();
+				symbol.assign(v.m_symbol, len);
+			}
+			topic_var.push_back(std::make_pair(std::string(v.m_topic, 3), shared_value(v)));
+			mks = v.m_mks;
+		});
+		flush();
+		m_filter.quiescent();
+		return count;
+	}
+
+	// DepthUDPData channel, same feed thread as onData
+	auto onDepth(const char* data, size_t size) -> void
+	{
+		if (size < offsetof(DepthUDPData, m_updates))
+			return;
+		const auto* depth = reinterpret_cast<const DepthUDPData*>(data);
+		if (m_filter.contains(depth->m_symbol)) {
+			decode_depth(*depth, size);
+		}
+		else {
+			m_filtered.store(m_filtered.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+		m_filter.quiescent();
+		expire_now();
+	}
+
+private:
+	struct DepthListener : aw::IUDPListener
+	{
+		DepthListener(DataCache& cache) : m_cache(cache) {}
+		auto onData(const char* data, size_t size) -> void override { m_cache.onDepth(data, size); }
+		DataCache& m_cache;
+	};
+
+	// book of an unsubscribed symbol (or one with no depth topic) isn't kept
+	auto decode_depth(const DepthUDPData& depth, size_t size) -> void
+	{
+		size_t num_updates = (std::min)(static_cast<size_t>(depth.m_num_updates), (size - offsetof(DepthUDPData, m_updates)) / sizeof(DepthUDPData::Update));
+		std::string symbol(depth.m_symbol, strnlen(depth.m_symbol, sizeof(depth.m_symbol)));
+		std::lock_guard<std::mutex> __(m_mutex);
+		advance_bars(depth.m_timestamp);
+		auto it = m_symbols.find(symbol);
+		if (it == m_symbols.end())
+			return;
+		if (!it->second->m_depth) // book kept whether or not a depth topic is subscribed yet
+			it->second->m_depth = std::make_unique<DepthTopics<Cell*>>();
+		DepthTopics<Cell*>& book(*it->second->m_depth);
+		for (size_t i = 0; i < num_updates; i++) {
+			const DepthUDPData::Update& u(depth.m_updates[i]);
+			book.apply(u.m_side, u.m_action, u.m_price, u.m_size);
+		}
+		book.flush(SCALE, [](Cell* cell, double value) {
+			SymbolData::publish(*cell, value);
+		});
+		it->second->update_timestamp(depth.m_timestamp, m_stale_wheel);
+		stage_no_lock();
+	}
+
+	// feed time drives bar closes and rolling window expiry, whatever is due by mks happens before the packet is applied
+	auto advance_bars(uint64_t mks) -> void
+	{
+		m_bar_wheel.advance(mks / BarTopics<Cell*>::WHEEL_UNIT_MKS, [](aw::TimerNode& node) {
+			BarTopics<Cell*>::on_timer(node, [](Cell* cell, double value) {
+				SymbolData::publish(*cell, value);
+			});
+		});
+		m_rolling_wheel.advance(mks / RollingTopics<Cell*>::WHEEL_UNIT_MKS, [this](aw::TimerNode& node) {
+			RollingTopics<Cell*>::on_timer(node, m_rolling_wheel, [](Cell* cell, double value) {
+				SymbolData::publish(*cell, value);
+			});
+		});
+	}
+
+	// stale wheel to now_ms: a symbol that ticked since its timer was set gets the timer again at its last update plus
+	// StaleMs (deadlines move only when they fire, a packet just stores its time), the others go stale and wait for
+	// their next packet without a timer
+	auto expire_no_lock(uint64_t now_ms) -> void
+	{
+		bool expired = false;
+		m_stale_wheel.advance(now_ms, [&](aw::TimerNode& node) {
+			SymbolData& sd(*static_cast<SymbolData::StaleTimer&>(node).m_symbol);
+			uint64_t deadline = sd.m_updated_ms + sd.m_stale_ms;
+			if (deadline > m_stale_wheel.now()) {
+				m_stale_wheel.schedule(node, deadline);
+				return;
+			}
+			sd.expire();
+			expired = true;
+		});
+		if (expired)
+			stage_no_lock();
+	}
+
+	// false if nothing excel sees changed
+	auto decode(const EnhancedUDPData& myData, size_t size) -> bool
+	{
+		AW_LOG("Data received");
+		aw::logger::log(myData, size);
+		/*
+		#char m_symbol[24];
+		uint64_t m_timestamp; // timestamp, microseconds from epoch
+		#uint16_t m_num_fields; // how many fields stored <= 20
+		#Field m_fields[20]; // can store up to 20 fields
+		#char m_filler[4]; // align 8 bytes*/
+		std::string symbol(myData.m_symbol, strnlen(myData.m_symbol, sizeof(myData.m_symbol)));
+		std::vector<std::pair<std::string, VARIANT>> topic_var;
+		// a short datagram holds fewer fields than it claims, read only the ones received
+		size_t num_fields = (std::min)(static_cast<size_t>(myData.m_num_fields), (size - offsetof(EnhancedUDPData, m_fields)) / sizeof(EnhancedUDPData::Field));
+		for (size_t i = 0; i < num_fields; i++) {
+			std::string topic(myData.m_fields[i].m_topic, sizeof(myData.m_fields[i].m_topic));
+			VARIANT var;
+			VariantInit(&var);
+			if (myData.m_fields[i].m_type == 1) { // int64_t
+				var.vt = VT_I8;
+				var.llVal = myData.m_fields[i].m_val;
+			}
+			else {
+				var.vt = VT_R8;
+				var.dblVal = static_cast<double>(myData.m_fields[i].m_val) / SCALE;
+			}
+			topic_var.push_back(std::make_pair(topic, var));
+		}
+		return update(symbol, topic_var, myData.m_timestamp); // "tms" is formatted only if subscribed and pulled by excel
+	}
+
+	// feed side after every change, and whoever applies connects or solves: every view stages its changed cells (see
+	// View::stage_no_lock) and hears of them, all of them while legs or expressions wait to be solved (the notifier
+	// thread solves them), except quiet: the one pulling or about to be notified anyway
+	auto stage_no_lock(const View* quiet = nullptr) -> void
+	{
+		bool solve = m_exprs.dirty() || m_options.dirty();
+		for (View* view : m_views) {
+			if (!view)
+				continue;
+			bool changed = view->stage_no_lock();
+			if ((changed || solve) && view != quiet)
+				view->notify();
+		}
+	}
+	// every view's connect() queue, returns true if one of them has a known value waiting for RefreshData
+	auto apply_connects_no_lock() -> bool
+	{
+		bool requeued = false;
+		for (View* view : m_views) {
+			if (view)
+				requeued |= view->apply_connects_no_lock();
+		}
+		return requeued;
+	}
+
+	// option legs quoted or repriced by their underlying and expressions whose inputs moved, solved in batches
+	// when someone reads, their cells then go through the journal like any other change
+	auto evaluate_no_lock() -> void
+	{
+		m_options.evaluate([](Cell* cell, double value) {
+			SymbolData::publish(*cell, value);
+		});
+		m_exprs.evaluate([](Cell* input) {
+			return input->value();
+		}, [](Cell* cell, double value) {
+			SymbolData::publish(*cell, value);
+		});
+	}
+
+	// "expr" cell of text, made with its node and inputs for the first TopicID (any view) or shared
+	auto add_expression_no_lock(const std::string& text, Expression&& expr) -> Cell&
+	{
+		Cell& cell(m_expr_cells[text]);
+		if (!cell.m_topic_ids.empty())
+			return cell;
+		cell.m_topic = text;
+		cell.m_journal = &m_journal;
+		cell.m_slot = m_journal.add(&cell);
+		cell.m_node = m_exprs.add(std::move(expr), &cell);
+		auto& node(m_exprs.node(cell.m_node));
+		const auto& refs(node.m_expr.refs());
+		for (size_t i = 0; i < refs.size(); i++) {
+			SymbolData& sd(acquire_no_lock(refs[i].first));
+			Cell& input(sd.add_dependent(refs[i].second, cell.m_node));
+			input.m_graph = &m_exprs;
+			if (input.users() == 1) {
+				attach_option_no_lock(sd, input);
+				seed_no_lock(sd, input);
+			}
+			node.m_inputs[i] = &input;
+		}
+		m_exprs.touch(cell.m_node); // inputs may already have values
+		return cell;
+	}
+	// excel's copy of the cell's value into known, false if it has none yet
+	auto known_no_lock(Cell* cell, VARIANT* known) -> bool
+	{
+		if (!cell || !known || cell->m_is_timestamp || cell->m_var.vt == VT_EMPTY)
+			return false;
+		VariantInit(known);
+		if (FAILED(VariantCopy(known, &cell->m_var)))
+			return false;
+		cell->delivered();
+		return true;
+	}
+	// Deadband setting of topic ("bid=1t,*=0.01%"), parsed once per topic, nullptr if none applies
+	auto configured_deadband_no_lock(const std::string& topic) -> const Deadband*
+	{
+		if (m_deadbands.empty())
+			return nullptr;
+		auto it = m_configured_deadbands.find(topic);
+		if (it == m_configured_deadbands.end()) {
+			Deadband band;
+			bool parsed = Deadband::parse(Deadband::lookup(m_deadbands, topic), Configuration::instance().getTickSize(), band);
+			it = m_configured_deadbands.emplace(topic, std::make_pair(parsed, band)).first;
+		}
+		return it->second.first ? &it->second.second : nullptr;
+	}
+
+	// last TopicID of an "expr" cell takes its node and input cells with it
+	auto remove_expression_no_lock(Cell& cell, uint64_t key) -> void
+	{
+		if (!cell.remove_topic_id(key) || !cell.m_topic_ids.empty())
+			return;
+		auto& node(m_exprs.node(cell.m_node));
+		for (Cell* input : node.m_inputs) {
+			if (input->users() == 1)
+				detach_option_no_lock(*input);
+			SymbolData* sd = input->m_owner;
+			sd->remove_dependent(*input, cell.m_node); // input may be gone after this
+			if (sd->m_refcount == 0)
+				release_no_lock(sd);
+		}
+		m_exprs.remove(cell.m_node);
+		m_journal.remove(cell.m_slot);
+		m_expr_cells.erase(std::string(cell.m_topic)); // copy key, erase destroys cell
+	}
+
+	// "iv", "delta", "gamma", "vega" on an OCC symbol, first user of cell, a chain keeps its underlying subscribed
+	auto attach_option_no_lock(SymbolData& sd, Cell& cell) -> void
+	{
+		int output = OptionsEngine<Cell*>::output(cell.m_topic);
+		options::Contract contract;
+		if (output < 0 || !options::parse_occ(sd.m_symbol_name, contract))
+			return;
+		bool new_chain = false;
+		sd.m_leg = m_options.subscribe(sd.m_symbol_name, contract, output, &cell, new_chain);
+		cell.m_is_derived = true;
+		if (new_chain) {
+			SymbolData& underlying(acquire_no_lock(contract.m_root));
+			underlying.m_chain = sd.m_leg.m_chain;
+			underlying.m_refcount++;
+		}
+	}
+
+	// last user of cell is going
+	auto detach_option_no_lock(Cell& cell) -> void
+	{
+		int output = OptionsEngine<Cell*>::output(cell.m_topic);
+		SymbolData* sd = cell.m_owner;
+		if (output < 0 || !sd->m_leg.m_chain)
+			return;
+		std::string root(sd->m_leg.m_chain->m_root);
+		bool leg_gone = false;
+		bool chain_gone = m_options.unsubscribe(sd->m_leg, output, leg_gone);
+		if (leg_gone)
+			sd->m_leg = OptionsEngine<Cell*>::LegRef();
+		if (!chain_gone)
+			return;
+		SymbolData* underlying = m_symbols[root];
+		underlying->m_chain = nullptr;
+		if (--underlying->m_refcount == 0)
+			release_no_lock(underlying);
+	}
+
+	// subscribed symbol, reuses SymbolData from free list before growing the pool
+	auto acquire_no_lock(const std::string& symbol) -> SymbolData&
+	{
+		auto it = m_symbols.find(symbol);
+		if (it != m_symbols.end())
+			return *it->second;
+		SymbolData* sd = nullptr;
+		if (!m_free_symbols.empty()) {
+			sd = m_free_symbols.back();
+			m_free_symbols.pop_back();
+		}
+		else {
+			m_symbol_pool.emplace_back();
+			sd = &m_symbol_pool.back();
+		}
+		sd->m_symbol_name = symbol;
+		sd->m_ticks = m_tick_store.log(symbol);
+		sd->m_journal = &m_journal;
+		sd->m_stale_ms = stale_ms_no_lock(symbol);
+		sd->m_updated_ms = m_stale_wheel.now();
+		if (sd->m_stale_ms)
+			m_stale_wheel.schedule(sd->m_stale_timer, sd->m_updated_ms + sd->m_stale_ms);
+		m_symbols.emplace(symbol, sd);
+		m_filter.insert(symbol, m_symbols);
+		return *sd;
+	}
+
+	// StaleMs setting of symbol ("IBM=500,*=5000"), 0: none
+	auto stale_ms_no_lock(const std::string& symbol) -> uint32_t
+	{
+		if (m_stale_list.empty())
+			return 0;
+		std::string spec = Deadband::lookup(m_stale_list, symbol); // same "name=value,*=value" list
+		return static_cast<uint32_t>((std::max)(std::strtol(spec.c_str(), nullptr, 10), 0l));
+	}
+
+	// new cell with no value yet takes the snapshot's, not marked changed: excel gets it from ConnectData
+	// last value table's raw value as the feed packet would have carried it
+	static auto shared_value(const lastvalues::Value& v) -> VARIANT
+	{
+		VARIANT var;
+		VariantInit(&var);
+		if (v.m_type == 1) {
+			var.vt = VT_I8;
+			var.llVal = v.m_value;
+		}
+		else {
+			var.vt = VT_R8;
+			var.dblVal = static_cast<double>(v.m_value) / SCALE;
+		}
+		return var;
+	}
+	// new cell's first value: with SharedFeed open from the FeedHandler's table (a symbol subscribed after the poll
+	// handed out its slow fields like "cls" would wait for their next change), else from the snapshot
+	auto seed_no_lock(SymbolData& sd, Cell& cell) -> void
+	{
+		if (cell.m_is_timestamp || cell.m_var.vt != VT_EMPTY)
+			return;
+		VARIANT var;
+		uint64_t mks = 0;
+		lastvalues::Value shared;
+		if (m_shared.is_open() && !cell.m_is_derived && cell.m_topic.size() == lastvalues::TOPIC_SIZE - 1
+			&& m_shared.find(sd.m_symbol_name.c_str(), cell.m_topic.c_str(), shared)) {
+			var = shared_value(shared);
+			mks = shared.m_mks;
+		}
+		else if (!m_snapshot.find(sd.m_symbol_name, cell.m_topic, var, mks))
+			return;
+		VariantCopy(&cell.m_var, &var);
+		if (!sd.m_live)
+			sd.m_timestamp = (std::max)(sd.m_timestamp, mks); // checkpointed again with its own time
+		m_seeded++;
+	}
+
+	// last subscriber gone, only called from excel side so data source thread never frees anything
+	auto release_no_lock(SymbolData* sd) -> void
+	{
+		m_symbols.erase(sd->m_symbol_name);
+		m_filter.erase(m_symbols);
+		if (sd->m_ticks)
+			m_tick_store.close(sd->m_symbol_name); // unmapped, reopened by the next subscriber
+		sd->reset();
+		m_free_symbols.push_back(sd);
+	}
+
+	StringPool m_strings; // text values, under m_mutex, declared before the cells so it outlives them
+	std::unordered_map<std::string, SymbolData*> m_symbols; // subscribed symbols only
+	std::deque<SymbolData> m_symbol_pool; // deque never moves elements on growth
+	std::vector<SymbolData*> m_free_symbols;
+	std::vector<View*> m_views; // by View::m_id, nullptr once gone, under m_mutex
+	aw::TimestampFormatter m_tms_formatter; // only used under m_mutex
+	aw::TimerWheel m_bar_wheel; // closes bars of every symbol, only used under m_mutex
+	aw::TimerWheel m_rolling_wheel; // drains rolling windows of quiet symbols, same clock, only used under m_mutex
+	aw::TimerWheel m_stale_wheel; // StaleMs deadlines of subscribed symbols in clock_ms(), only used under m_mutex
+	std::string m_stale_list = Configuration::instance().getStaleMs();
+	uint64_t m_expired_ms = 0; // expire()'s last millisecond, ingest thread only
+	std::unordered_map<std::string, Cell> m_expr_cells; // "expr" cells by expression text
+	ExpressionGraph<Cell*> m_exprs; // input cell -> expressions, only used under m_mutex
+	OptionsEngine<Cell*> m_options; // chains by underlying, only used under m_mutex
+	ChangeJournal<Cell*> m_journal; // every cell with users, only used under m_mutex
+	std::string m_deadbands = Configuration::instance().getDeadband();
+	std::unordered_map<std::string, std::pair<bool, Deadband>> m_configured_deadbands; // by topic, only used under m_mutex
+	uint64_t m_deadband_quiet = 0;
+	TickStore m_tick_store; // history of subscribed symbols, only used under m_mutex
+	Snapshot m_snapshot; // lookups and swap under m_mutex, build under m_checkpoint_mutex
+	uint64_t m_seeded = 0;
+	std::vector<Snapshot::Entry> m_checkpoint_entries; // scratch, under m_checkpoint_mutex
+	std::mutex m_checkpoint_mutex;
+	std::thread m_checkpoint_thread;
+	std::mutex m_stop_mutex;
+	std::condition_variable m_stop_cv;
+	bool m_stopping = false;
+	std::mutex m_mutex;
+	SubscriptionFilter m_filter; // read by feed thread without m_mutex
+	DepthListener m_depth_listener;
+	std::atomic<uint64_t> m_filtered = 0;
+	aw::UDPServer m_udp;
+	lastvalues::Reader m_shared; // SharedFeed instead of m_udp, the poll thread polls it, seed_no_lock() finds in it
+	std::thread m_poll_thread;
+	std::atomic<bool> m_stop_polling = false;
+	bool m_channels_added = false;
+	bool m_depth_channel_added = false;
+	StringPool::Entry* m_waiting = m_strings.intern("WAITING", 7); // held for good, see waiting()
+	std::atomic<size_t> m_instances = 0; // started by start_shared(), changed under m_instances_mutex
+	bool m_instances_started = false; // start()'s result for every instance
+	std::mutex m_instances_mutex;
+	View m_view{ *this }; // tools and tests calling the cache directly, last: it needs everything above
+};
@@ -0,0 +1,111 @@
+// deadband.h
+// per cell change filter: a feed value within the band around the last value excel got is stored but not published,
+// so excel isn't woken and nothing recalculates for a flicker
+// =RTD("AwRTDServer",,"quote","IBM","bid","2t") or Deadband in the registry for every sheet ("bid=1t,ask=1t,*=0.01%")
+//	"2t": at least 2 ticks (TickSize for prices, 1 for integer topics like vol)
+//	"0.05%": relative to the last value excel got
+//	"0" or "": every change goes through
+// compared on the raw fixed point feed value (double * SCALE), the band is fixed each time excel gets a value
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include "udpdata.h"
+
+struct Deadband
+{
+	int64_t m_ticks = 0;
+	int64_t m_ppm = 0; // relative, parts per million
+	int64_t m_tick_raw = 0; // price tick in raw feed units
+
+	auto enabled() const -> bool { return m_ticks > 0 || m_ppm > 0; }
+
+	// false if spec doesn't parse
+	static auto parse(const std::string& spec, double tick_size, Deadband& band) -> bool
+	{
+		band = Deadband();
+		band.m_tick_raw = (std::max)(static_cast<int64_t>(std::llround(tick_size * SCALE)), static_cast<int64_t>(1));
+		if (spec.empty() || spec == "0")
+			return true;
+		size_t used = 0;
+		double n = 0;
+		try {
+			n = std::stod(spec, &used);
+		}
+		catch (...) {
+			return false;
+		}
+		if (n < 0 || used + 1 != spec.size())
+			return false;
+		if (!std::isfinite(n) || n > 1e15) // "inft", "1e30t": out of int64_t range
+			return false;
+		if (spec.back() == 't' && n == std::floor(n))
+			band.m_ticks = static_cast<int64_t>(n);
+		else if (spec.back() == '%' && n <= 100)
+			band.m_ppm = std::llround(n * 10000);
+		else
+			return false;
+		return true;
+	}
+
+	// spec for topic in a "topic=spec,..." list, "*" matches any topic, "" if none
+	static auto lookup(const std::string& list, const std::string& topic) -> std::string
+	{
+		std::string any;
+		size_t begin = 0;
+		while (begin < list.size()) {
+			size_t end = list.find(',', begin);
+			if (end == std::string::npos)
+				end = list.size();
+			size_t eq = list.find('=', begin);
+			if (eq < end) {
+				std::string name(list, begin, eq - begin);
+				if (name == topic)
+					return list.substr(eq + 1, end - eq - 1);
+				if (name == "*")
+					any = list.substr(eq + 1, end - eq - 1);
+			}
+			begin = end + 1;
+		}
+		return any;
+	}
+
+	// one cell, several sheets asking for different bands: the tighter of each kind, width() takes the narrower of a
+	// tick and a relative band ("2t" with "0.05%"), none if anyone wants every change
+	auto tighter(const Deadband& other) const -> Deadband
+	{
+		Deadband band(*this);
+		if (!enabled() || !other.enabled()) {
+			band.m_ticks = band.m_ppm = 0;
+			return band;
+		}
+		band.m_ticks = !m_ticks ? other.m_ticks : !other.m_ticks ? m_ticks : (std::min)(m_ticks, other.m_ticks);
+		band.m_ppm = !m_ppm ? other.m_ppm : !other.m_ppm ? m_ppm : (std::min)(m_ppm, other.m_ppm);
+		return band;
+	}
+
+	// feed values only, false for text
+	static auto raw(const VARIANT& var, int64_t& value) -> bool
+	{
+		switch (var.vt) {
+		case VT_R8: value = std::llround(var.dblVal * SCALE); return std::abs(var.dblVal) < 9e9;
+		case VT_I8: value = var.llVal; return true;
+		case VT_I4: value = var.lVal; return true;
+		default: return false;
+		}
+	}
+
+	// a move smaller than width from sent is held back, width 0 lets every change through
+	auto width(int64_t sent, bool integer) const -> int64_t
+	{
+		int64_t ticks = m_ticks * (integer ? 1 : m_tick_raw);
+		int64_t relative = static_cast<int64_t>(std::fabs(static_cast<double>(sent)) * static_cast<double>(m_ppm) / 1e6);
+		if (m_ticks && m_ppm) // both kinds asked for on one cell
+			return (std::min)(ticks, relative);
+		return m_ticks ? ticks : relative;
+	}
+};
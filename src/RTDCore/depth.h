@@ -0,0 +1,234 @@
+// depth.h
+// level 2 book per symbol, =RTD("AwRTDServer",,"depth","IBM","bid3")
+// topic is <side>[Size]<rank>, side: bid, ask, rank 1 is best, ex: bid1, ask3, bidSize1, askSize5
+// a rank past the end of the book shows 0
+// OrderBook: each side is a sorted array of price levels with the best level last,
+//	lookup is a binary search (O(log levels)), size changes touch nothing else,
+//	add/delete only move the levels between the change and the touch, which is where book traffic is
+// DepthTopics: only ranks some cell subscribed are published, a size change marks that rank,
+//	an add/delete marks its rank and every subscribed rank behind it (their levels moved up or down)
+//	the book is kept with no rank subscribed (DataCache: from a symbol's first depth update until it is released), so a
+//	rank subscribed later shows levels added before it
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+class OrderBook
+{
+public:
+	enum Side { BID, ASK, NUM_SIDES };
+	enum Action { ADD = 1, MODIFY = 2, REMOVE = 3, CLEAR = 4 }; // not DELETE, winnt.h has that macro
+
+	struct Level
+	{
+		int64_t m_key; // price for bids, -price for asks, ascending so best is last
+		int64_t m_size;
+	};
+
+	// returns rank (1 is best) of the level that changed, 0 if nothing did
+	// shifted: level was added or removed, every rank from the returned one on now holds another level
+	// add and modify both set the level (a modify of a missing level adds it), size <= 0 deletes
+	auto apply(Side side, Action action, int64_t price, int64_t size, bool& shifted) -> size_t
+	{
+		shifted = false;
+		std::vector<Level>& levels(m_levels[side]);
+		int64_t key = side == BID ? price : -price;
+		auto it = std::lower_bound(levels.begin(), levels.end(), key, [](const Level& l, int64_t k) { return l.m_key < k; });
+		bool found = it != levels.end() && it->m_key == key;
+		size_t rank = static_cast<size_t>(levels.end() - it); // rank of the level at it, or of a level inserted before it
+		if (action == REMOVE || size <= 0) {
+			if (!found)
+				return 0;
+			levels.erase(it);
+			shifted = true;
+			return rank;
+		}
+		if (found) {
+			if (it->m_size == size)
+				return 0;
+			it->m_size = size;
+			return rank;
+		}
+		levels.insert(it, Level{ key, size });
+		shifted = true;
+		return rank + 1;
+	}
+	auto clear() -> void
+	{
+		for (auto& levels : m_levels)
+			levels.clear();
+	}
+
+	auto depth(Side side) const -> size_t { return m_levels[side].size(); }
+	// nullptr past the end of the book
+	auto level(Side side, size_t rank) const -> const Level*
+	{
+		const std::vector<Level>& levels(m_levels[side]);
+		return rank == 0 || rank > levels.size() ? nullptr : &levels[levels.size() - rank];
+	}
+	static auto price(Side side, const Level& level) -> int64_t { return side == BID ? level.m_key : -level.m_key; }
+
+private:
+	std::vector<Level> m_levels[NUM_SIDES];
+};
+
+// Handle identifies the subscriber (DataCache uses Cell*)
+template<typename Handle>
+class DepthTopics
+{
+public:
+	enum Field { PRICE, SIZE, NUM_FIELDS };
+	static constexpr size_t MAX_RANK = 100;
+
+	// false if topic is not a depth topic
+	static auto parse(const std::string& topic, int& side, int& field, size_t& rank) -> bool
+	{
+		if (topic.compare(0, 3, "bid") == 0)
+			side = OrderBook::BID;
+		else if (topic.compare(0, 3, "ask") == 0)
+			side = OrderBook::ASK;
+		else
+			return false;
+		size_t pos = 3;
+		field = PRICE;
+		if (topic.compare(pos, 4, "Size") == 0) {
+			field = SIZE;
+			pos += 4;
+		}
+		if (pos == topic.size())
+			return false;
+		rank = 0;
+		for (; pos < topic.size(); pos++) {
+			if (topic[pos] < '0' || topic[pos] > '9' || rank > MAX_RANK)
+				return false;
+			rank = rank * 10 + (topic[pos] - '0');
+		}
+		return rank >= 1 && rank <= MAX_RANK;
+	}
+
+	auto subscribe(int side, int field, size_t rank, Handle cell) -> void
+	{
+		std::vector<Output>& outputs(m_outputs[side][field]);
+		if (outputs.size() < rank)
+			outputs.resize(rank);
+		outputs[rank - 1] = Output{ cell, NAN, true };
+		mark(side, rank, true); // current level on next flush
+	}
+	auto unsubscribe(Handle cell) -> void
+	{
+		for (auto& side : m_outputs) {
+			for (auto& outputs : side) {
+				for (auto& o : outputs) {
+					if (o.m_used && o.m_cell == cell)
+						o = Output();
+				}
+				while (!outputs.empty() && !outputs.back().m_used)
+					outputs.pop_back();
+			}
+		}
+	}
+	auto subscribed() const -> bool
+	{
+		for (auto& side : m_outputs) {
+			for (auto& outputs : side) {
+				if (!outputs.empty())
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// one level update from the feed, published on flush()
+	auto apply(int side, int action, int64_t price, int64_t size) -> void
+	{
+		m_live = true;
+		if (action == OrderBook::CLEAR) {
+			m_book.clear();
+			mark(OrderBook::BID, 1, true);
+			mark(OrderBook::ASK, 1, true);
+			return;
+		}
+		if (side != OrderBook::BID && side != OrderBook::ASK)
+			return;
+		bool shifted = false;
+		size_t rank = m_book.apply(static_cast<OrderBook::Side>(side), static_cast<OrderBook::Action>(action), price, size, shifted);
+		if (rank)
+			mark(side, rank, shifted);
+	}
+
+	// once per packet, publish(cell, value) for subscribed ranks whose level changed
+	template<typename Publish>
+	auto flush(double scale, Publish publish) -> void
+	{
+		for (int side = 0; side < OrderBook::NUM_SIDES; side++) {
+			size_t from = m_shifted_from[side];
+			if (from != NONE) {
+				size_t to = (std::max)(m_outputs[side][PRICE].size(), m_outputs[side][SIZE].size());
+				for (size_t rank = from; rank <= to; rank++)
+					publish_rank(side, rank, scale, publish);
+			}
+			for (size_t rank : m_size_changed[side]) {
+				if (rank < from)
+					publish_rank(side, rank, scale, publish);
+			}
+			m_shifted_from[side] = NONE;
+			m_size_changed[side].clear();
+		}
+	}
+
+	auto book() const -> const OrderBook& { return m_book; }
+	// a depth update came, a new subscriber's ranks can be flushed right away
+	auto live() const -> bool { return m_live; }
+
+private:
+	static constexpr size_t NONE = static_cast<size_t>(-1);
+
+	struct Output
+	{
+		Handle m_cell = {};
+		double m_last = NAN;
+		bool m_used = false;
+	};
+
+	// ranks past the deepest subscribed one are never looked at
+	auto mark(int side, size_t rank, bool shifted) -> void
+	{
+		if (rank > m_outputs[side][PRICE].size() && rank > m_outputs[side][SIZE].size())
+			return;
+		if (shifted)
+			m_shifted_from[side] = (std::min)(m_shifted_from[side], rank);
+		else if (rank < m_shifted_from[side])
+			m_size_changed[side].push_back(rank);
+	}
+
+	template<typename Publish>
+	auto publish_rank(int side, size_t rank, double scale, Publish publish) -> void
+	{
+		const OrderBook::Level* level = m_book.level(static_cast<OrderBook::Side>(side), rank);
+		double values[NUM_FIELDS] = {
+			level ? static_cast<double>(OrderBook::price(static_cast<OrderBook::Side>(side), *level)) / scale : 0,
+			level ? static_cast<double>(level->m_size) : 0,
+		};
+		for (int field = 0; field < NUM_FIELDS; field++) {
+			std::vector<Output>& outputs(m_outputs[side][field]);
+			if (rank > outputs.size())
+				continue;
+			Output& o(outputs[rank - 1]);
+			if (!o.m_used || o.m_last == values[field])
+				continue;
+			o.m_last = values[field];
+			publish(o.m_cell, values[field]);
+		}
+	}
+
+	OrderBook m_book;
+	std::vector<Output> m_outputs[OrderBook::NUM_SIDES][NUM_FIELDS]; // [side][field][rank - 1]
+	size_t m_shifted_from[OrderBook::NUM_SIDES] = { NONE, NONE }; // lowest rank whose level moved since flush
+	std::vector<size_t> m_size_changed[OrderBook::NUM_SIDES]; // ranks whose size changed in place since flush
+	bool m_live = false;
+};
@@ -0,0 +1,144 @@
+// derived.h
+// server side topics computed from feed topics, so excel only displays them
+// =RTD("AwRTDServer",,"quote","IBM","mid")
+//	mid: (bid + ask) / 2
+//	spread: ask - bid
+//	vwap: mid weighted by volume traded since subscription (feed only has cumulative "vol", no trade price)
+//	chg: percent change of mid against "cls" (previous close) if the feed sends it, first mid seen otherwise
+// each output lists the inputs it depends on, a packet marks inputs dirty and only dependent outputs are recomputed
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <cmath>
+
+class DerivedTopics
+{
+public:
+	enum Input { BID, ASK, VOL, CLS, NUM_INPUTS };
+	enum Output { MID, SPREAD, VWAP, CHANGE, NUM_OUTPUTS };
+
+	// -1 if topic is not an input/output
+	static auto input(const std::string& topic) -> int
+	{
+		static const char* names[NUM_INPUTS] = { "bid", "ask", "vol", "cls" };
+		return find(names, NUM_INPUTS, topic);
+	}
+	static auto output(const std::string& topic) -> int
+	{
+		static const char* names[NUM_OUTPUTS] = { "mid", "spread", "vwap", "chg" };
+		return find(names, NUM_OUTPUTS, topic);
+	}
+
+	// subscribed outputs, nothing is computed for the others
+	auto subscribe(int output) -> void { m_subscribed |= 1u << output; }
+	auto unsubscribe(int output) -> void { m_subscribed &= ~(1u << output); }
+	auto subscribed() const -> bool { return m_subscribed != 0; }
+	auto computed() const -> uint64_t { return m_computed; }
+
+	// from data source side, one call per field of a packet
+	auto set(int input, double value) -> void
+	{
+		if (input == VOL)
+			accumulate(value);
+		m_in[input] = value;
+		m_has |= 1u << input;
+		m_dirty |= 1u << input;
+	}
+
+	// once per packet, calls publish(output, value) for every subscribed output whose inputs changed
+	template<typename Publish>
+	auto compute(Publish publish) -> void
+	{
+		if (!m_dirty)
+			return;
+		for (int o = 0; o < NUM_OUTPUTS; o++) {
+			if (!(m_subscribed & (1u << o)) || !(m_dirty & DEPENDS[o]))
+				continue;
+			double value = 0;
+			m_computed++;
+			if (!calculate(o, value) || value == m_out[o])
+				continue;
+			m_out[o] = value;
+			publish(o, value);
+		}
+		m_dirty = 0;
+	}
+
+private:
+	static constexpr uint32_t DEPENDS[NUM_OUTPUTS] = {
+		(1u << BID) | (1u << ASK), // mid
+		(1u << BID) | (1u << ASK), // spread
+		(1u << VOL), // vwap moves when volume trades
+		(1u << BID) | (1u << ASK) | (1u << CLS), // chg
+	};
+
+	static auto find(const char* const* names, int n, const std::string& topic) -> int
+	{
+		for (int i = 0; i < n; i++) {
+			if (topic == names[i])
+				return i;
+		}
+		return -1;
+	}
+
+	auto has(int input) const -> bool { return (m_has & (1u << input)) != 0; }
+	auto has_quote() const -> bool { return has(BID) && has(ASK); }
+	auto mid() const -> double { return (m_in[BID] + m_in[ASK]) / 2; }
+
+	// volume delta is priced at the latest mid (python sender puts vol after bid/ask in a packet)
+	auto accumulate(double vol) -> void
+	{
+		if (has(VOL) && has_quote() && vol > m_in[VOL]) {
+			double dv = vol - m_in[VOL];
+			m_pv += mid() * dv;
+			m_v += dv;
+		}
+	}
+
+	auto calculate(int output, double& value) -> bool
+	{
+		switch (output) {
+		case MID:
+			if (!has_quote())
+				return false;
+			value = mid();
+			return true;
+		case SPREAD:
+			if (!has_quote())
+				return false;
+			value = m_in[ASK] - m_in[BID];
+			return true;
+		case VWAP:
+			if (m_v <= 0)
+				return false;
+			value = m_pv / m_v;
+			return true;
+		case CHANGE:
+			if (!has_quote())
+				return false;
+			if (!has(CLS) && m_ref == 0)
+				m_ref = mid();
+			{
+				double ref = has(CLS) ? m_in[CLS] : m_ref;
+				if (ref == 0)
+					return false;
+				value = (mid() - ref) / ref * 100;
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	double m_in[NUM_INPUTS] = {};
+	double m_out[NUM_OUTPUTS] = { NAN, NAN, NAN, NAN };
+	uint32_t m_has = 0;
+	uint32_t m_dirty = 0;
+	uint32_t m_subscribed = 0;
+	double m_pv = 0; // sum of price * volume
+	double m_v = 0;
+	double m_ref = 0; // first mid when feed has no "cls"
+	uint64_t m_computed = 0; // outputs calculated, the others were skipped by DEPENDS
+};
@@ -0,0 +1,337 @@
+// expression.h
+// server side arithmetic over cells of any symbol, =RTD("AwRTDServer",,"expr","IBM.bid-MSFT.ask*0.5")
+// operand is <symbol>.<topic> (split at the last '.') or a number, operators: + - * / unary -, parentheses
+// Expression: parsed once on ConnectData into stack bytecode, inputs are the distinct cells it references
+// ExpressionGraph: input cell -> expressions reading it, a cell update marks its expressions dirty,
+//	evaluate() runs only the dirty ones, once per refresh however many packets arrived in between
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cmath>
+
+class Expression
+{
+public:
+	static constexpr size_t MAX_STACK = 64;
+	static constexpr size_t MAX_INPUTS = 1 << 16;
+
+	// false with error set if text doesn't parse
+	auto parse(const std::string& text, std::string& error) -> bool
+	{
+		m_text = text;
+		m_pos = 0;
+		m_depth = 0;
+		m_max_depth = 0;
+		m_code.clear();
+		m_consts.clear();
+		m_refs.clear();
+		m_error.clear();
+		if (!parse_sum())
+			return fail(error);
+		skip_space();
+		if (m_pos != m_text.size()) {
+			m_error = "unexpected '" + m_text.substr(m_pos, 1) + "'";
+			return fail(error);
+		}
+		return true;
+	}
+
+	// distinct (symbol, topic) read by the expression, LOAD i reads refs()[i]
+	auto refs() const -> const std::vector<std::pair<std::string, std::string>>& { return m_refs; }
+	auto text() const -> const std::string& { return m_text; }
+	auto code_size() const -> size_t { return m_code.size(); }
+
+	// in[i] is value of refs()[i], NaN in, NaN out
+	auto eval(const double* in) const -> double
+	{
+		double stack[MAX_STACK];
+		size_t sp = 0;
+		for (uint32_t instr : m_code) {
+			uint32_t arg = instr >> 8;
+			switch (static_cast<Op>(instr & 0xff)) {
+			case CONST: stack[sp++] = m_consts[arg]; break;
+			case LOAD: stack[sp++] = in[arg]; break;
+			case NEG: stack[sp - 1] = -stack[sp - 1]; break;
+			case ADD: sp--; stack[sp - 1] += stack[sp]; break;
+			case SUB: sp--; stack[sp - 1] -= stack[sp]; break;
+			case MUL: sp--; stack[sp - 1] *= stack[sp]; break;
+			case DIV: sp--; stack[sp - 1] /= stack[sp]; break;
+			}
+		}
+		return sp == 1 ? stack[0] : NAN;
+	}
+
+private:
+	enum Op : uint8_t { CONST, LOAD, NEG, ADD, SUB, MUL, DIV };
+
+	// low 8 bits op, upper 24 bits const/input index
+	auto emit(Op op, uint32_t arg = 0) -> void
+	{
+		m_code.push_back(static_cast<uint32_t>(op) | (arg << 8));
+		if (op == CONST || op == LOAD)
+			m_depth++;
+		else if (op != NEG)
+			m_depth--;
+		if (m_depth > m_max_depth)
+			m_max_depth = m_depth;
+	}
+
+	auto fail(std::string& error) -> bool
+	{
+		error = m_error + " at " + std::to_string(m_pos);
+		return false;
+	}
+
+	auto skip_space() -> void
+	{
+		while (m_pos < m_text.size() && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t'))
+			m_pos++;
+	}
+
+	auto accept(char c) -> bool
+	{
+		skip_space();
+		if (m_pos < m_text.size() && m_text[m_pos] == c) {
+			m_pos++;
+			return true;
+		}
+		return false;
+	}
+
+	// sum := product (('+' | '-') product)*
+	auto parse_sum() -> bool
+	{
+		if (!parse_product())
+			return false;
+		while (true) {
+			Op op = accept('+') ? ADD : accept('-') ? SUB : CONST;
+			if (op == CONST)
+				return true;
+			if (!parse_product())
+				return false;
+			emit(op);
+		}
+	}
+
+	// product := unary (('*' | '/') unary)*
+	auto parse_product() -> bool
+	{
+		if (!parse_unary())
+			return false;
+		while (true) {
+			Op op = accept('*') ? MUL : accept('/') ? DIV : CONST;
+			if (op == CONST)
+				return true;
+			if (!parse_unary())
+				return false;
+			emit(op);
+		}
+	}
+
+	// unary := ('-' | '+') unary | '(' sum ')' | number | symbol.topic
+	auto parse_unary() -> bool
+	{
+		if (accept('-')) {
+			if (!parse_unary())
+				return false;
+			emit(NEG);
+			return true;
+		}
+		if (accept('+'))
+			return parse_unary();
+		if (accept('(')) {
+			if (!parse_sum())
+				return false;
+			if (!accept(')')) {
+				m_error = "missing ')'";
+				return false;
+			}
+			return true;
+		}
+		if (m_depth >= MAX_STACK) {
+			m_error = "too deep";
+			return false;
+		}
+		return parse_operand();
+	}
+
+	static auto is_name(char c) -> bool
+	{
+		return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+			c == '_' || c == '.' || c == ':' || c == '^' || c == '$' || c == '#';
+	}
+
+	auto parse_operand() -> bool
+	{
+		skip_space();
+		size_t start = m_pos;
+		while (m_pos < m_text.size() && is_name(m_text[m_pos]))
+			m_pos++;
+		if (start == m_pos) {
+			m_error = m_pos < m_text.size() ? "unexpected '" + m_text.substr(m_pos, 1) + "'" : "unexpected end";
+			return false;
+		}
+		std::string token(m_text, start, m_pos - start);
+		char* end = nullptr;
+		double value = strtod(token.c_str(), &end);
+		bool numeric = token[0] == '.' || (token[0] >= '0' && token[0] <= '9'); // "nan", "inf" are not numbers here
+		if (numeric && end == token.c_str() + token.size()) {
+			m_consts.push_back(value);
+			emit(CONST, static_cast<uint32_t>(m_consts.size() - 1));
+			return true;
+		}
+		size_t dot = token.rfind('.');
+		if (dot == std::string::npos || dot == 0 || dot + 1 == token.size()) {
+			m_pos = start;
+			m_error = "expected symbol.topic";
+			return false;
+		}
+		std::pair<std::string, std::string> ref(token.substr(0, dot), token.substr(dot + 1));
+		size_t i = 0;
+		while (i < m_refs.size() && m_refs[i] != ref)
+			i++;
+		if (i == m_refs.size()) {
+			if (i == MAX_INPUTS) {
+				m_error = "too many inputs";
+				return false;
+			}
+			m_refs.push_back(std::move(ref));
+		}
+		emit(LOAD, static_cast<uint32_t>(i));
+		return true;
+	}
+
+	std::string m_text;
+	std::vector<uint32_t> m_code;
+	std::vector<double> m_consts;
+	std::vector<std::pair<std::string, std::string>> m_refs;
+	// parser state
+	size_t m_pos = 0;
+	size_t m_depth = 0;
+	size_t m_max_depth = 0;
+	std::string m_error;
+};
+
+// Handle identifies a cell (DataCache uses Cell*), node ids are stable until remove()
+template<typename Handle>
+class ExpressionGraph
+{
+public:
+	struct Node
+	{
+		Expression m_expr;
+		std::vector<Handle> m_inputs; // m_inputs[i] holds m_expr.refs()[i]
+		Handle m_output;
+		double m_last = NAN;
+		bool m_dirty = false;
+		bool m_used = false;
+	};
+
+	// caller fills node(id).m_inputs, then touch() once it has values
+	auto add(Expression&& expr, Handle output) -> uint32_t
+	{
+		uint32_t id;
+		if (!m_free.empty()) {
+			id = m_free.back();
+			m_free.pop_back();
+		}
+		else {
+			id = static_cast<uint32_t>(m_nodes.size());
+			m_nodes.emplace_back();
+		}
+		Node& n(m_nodes[id]);
+		n.m_expr = std::move(expr);
+		n.m_inputs.assign(n.m_expr.refs().size(), Handle());
+		n.m_output = output;
+		n.m_last = NAN;
+		n.m_dirty = false;
+		n.m_used = true;
+		m_size++;
+		return id;
+	}
+	auto remove(uint32_t id) -> void
+	{
+		Node& n(m_nodes[id]);
+		n.m_used = false;
+		n.m_inputs.clear();
+		n.m_expr = Expression();
+		m_free.push_back(id);
+		m_size--;
+	}
+	auto node(uint32_t id) -> Node& { return m_nodes[id]; }
+	auto size() const -> size_t { return m_size; }
+	auto evaluated() const -> uint64_t { return m_evaluated; }
+	auto dirty() const -> bool { return !m_dirty.empty(); }
+
+	// an input cell changed, its dependents run on next evaluate()
+	auto touch(const std::vector<uint32_t>& dependents) -> void
+	{
+		for (uint32_t id : dependents)
+			touch(id);
+	}
+	auto touch(uint32_t id) -> void
+	{
+		Node& n(m_nodes[id]);
+		if (n.m_dirty)
+			return;
+		n.m_dirty = true;
+		m_dirty.push_back(id);
+	}
+
+	// value(Handle) -> double (NaN if no value yet), publish(Handle output, double) for results that moved
+	template<typename Value, typename Publish>
+	auto evaluate(Value value, Publish publish) -> size_t
+	{
+		size_t count = 0;
+		for (uint32_t id : m_dirty) {
+			Node& n(m_nodes[id]);
+			if (!n.m_used || !n.m_dirty) // removed (and maybe reused) since touched
+				continue;
+			run(n, value, publish);
+			count++;
+		}
+		m_dirty.clear();
+		m_evaluated += count;
+		return count;
+	}
+	// only node id, if it waits to run (excel connecting to it wants its value now), false if it has none
+	template<typename Value, typename Publish>
+	auto evaluate(uint32_t id, Value value, Publish publish) -> bool
+	{
+		Node& n(m_nodes[id]);
+		if (n.m_dirty) {
+			run(n, value, publish);
+			m_evaluated++;
+			if (!m_dirty.empty() && m_dirty.back() == id) // just touched, the usual case
+				m_dirty.pop_back();
+		}
+		return std::isfinite(n.m_last);
+	}
+
+private:
+	template<typename Value, typename Publish>
+	auto run(Node& n, Value value, Publish publish) -> void
+	{
+		n.m_dirty = false;
+		m_in.resize(n.m_inputs.size());
+		for (size_t i = 0; i < n.m_inputs.size(); i++)
+			m_in[i] = value(n.m_inputs[i]);
+		double result = n.m_expr.eval(m_in.data());
+		if (!std::isfinite(result) || result == n.m_last)
+			return;
+		n.m_last = result;
+		publish(n.m_output, result);
+	}
+
+	std::vector<Node> m_nodes; // grows only, ids index it
+	std::vector<uint32_t> m_free;
+	std::vector<uint32_t> m_dirty; // touched since last evaluate(), no duplicates
+	std::vector<double> m_in; // scratch
+	size_t m_size = 0;
+	uint64_t m_evaluated = 0;
+};
@@ -0,0 +1,167 @@
+// journal.h
+// cell changes as a ring of records, any number of consumers each with its own sequence cursor
+// (RefreshData is one, a recorder or a second workbook can be others), reading never consumes for anyone else
+// cells are registered into slots with a generation, so a record of a cell removed since is skipped, not dereferenced
+// touch(): appends (slot, seq) unless every consumer is still behind the cell's last record, which they'll all
+//	read anyway (a cell ticking 1000 times between refreshes is one record, not 1000)
+// consume(): records from the cursor on, a cell is handed out at its latest record only (once per call);
+//	a consumer the ring lapped catches up from the slots instead (every cell changed after its cursor, conflated),
+//	the writer never waits for a slow consumer
+// hold(): a change the cell kept to itself (deadband), only counted
+// single threaded, DataCache uses it under m_mutex
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <algorithm>
+
+template<typename Handle>
+class ChangeJournal
+{
+public:
+	static constexpr size_t RING_SIZE = 1 << 16;
+
+	// ring_size power of 2
+	ChangeJournal(size_t ring_size = RING_SIZE) : m_ring(ring_size) {}
+
+	// cells
+	auto add(Handle handle) -> uint32_t
+	{
+		uint32_t slot;
+		if (!m_free.empty()) {
+			slot = m_free.back();
+			m_free.pop_back();
+		}
+		else {
+			slot = static_cast<uint32_t>(m_slots.size());
+			m_slots.emplace_back();
+		}
+		Slot& s(m_slots[slot]);
+		s.m_handle = handle;
+		s.m_seq = 0;
+		s.m_used = true;
+		m_size++;
+		return slot;
+	}
+	auto remove(uint32_t slot) -> void
+	{
+		Slot& s(m_slots[slot]);
+		s.m_used = false;
+		s.m_seq = 0;
+		s.m_generation++; // records still in the ring no longer match
+		m_free.push_back(slot);
+		m_size--;
+	}
+	auto touch(uint32_t slot) -> void
+	{
+		m_touches++;
+		Slot& s(m_slots[slot]);
+		if (s.m_seq > m_max_cursor)
+			return;
+		uint64_t seq = ++m_head;
+		Record& r(m_ring[seq & (m_ring.size() - 1)]);
+		r.m_slot = slot;
+		r.m_generation = s.m_generation;
+		r.m_seq = seq;
+		s.m_seq = seq;
+	}
+	auto hold() -> void { m_held++; }
+
+	// consumers, from_start: every cell that ever changed (and is still there) on the first consume
+	auto add_consumer(bool from_start) -> uint32_t
+	{
+		uint32_t id = 0;
+		while (id < m_consumers.size() && m_consumers[id].m_used)
+			id++;
+		if (id == m_consumers.size())
+			m_consumers.emplace_back();
+		m_consumers[id].m_cursor = from_start ? 0 : m_head;
+		if (!from_start)
+			m_max_cursor = (std::max)(m_max_cursor, m_head); // else touch() skips cells recorded before it joined
+		m_consumers[id].m_used = true;
+		return id;
+	}
+	auto remove_consumer(uint32_t id) -> void { m_consumers[id].m_used = false; }
+	// changes recorded since the consumer's last call (maybe none left once consumed: removed or touched again)
+	auto behind(uint32_t id) const -> bool { return m_consumers[id].m_cursor != m_head; }
+
+	// f(Handle) for each cell changed since the consumer's last call, returns how many
+	template<typename F>
+	auto consume(uint32_t id, F f) -> size_t
+	{
+		uint64_t& cursor(m_consumers[id].m_cursor);
+		size_t count = 0;
+		if (m_head - cursor > m_ring.size()) {
+			for (Slot& s : m_slots) {
+				if (s.m_used && s.m_seq > cursor) {
+					f(s.m_handle);
+					count++;
+				}
+			}
+			m_rescans++;
+		}
+		else {
+			for (uint64_t seq = cursor + 1; seq <= m_head; seq++) {
+				const Record& r(m_ring[seq & (m_ring.size() - 1)]);
+				const Slot& s(m_slots[r.m_slot]);
+				if (s.m_used && s.m_generation == r.m_generation && s.m_seq == seq) {
+					f(s.m_handle);
+					count++;
+				}
+			}
+		}
+		cursor = m_head;
+		m_max_cursor = (std::max)(m_max_cursor, cursor);
+		return count;
+	}
+
+	// cell in slot if it's still the one of that generation (a queued reference may outlive its cell)
+	auto find(uint32_t slot, uint32_t generation, Handle& handle) const -> bool
+	{
+		const Slot& s(m_slots[slot]);
+		if (!s.m_used || s.m_generation != generation)
+			return false;
+		handle = s.m_handle;
+		return true;
+	}
+	auto generation(uint32_t slot) const -> uint32_t { return m_slots[slot].m_generation; }
+
+	auto head() const -> uint64_t { return m_head; }
+	auto size() const -> size_t { return m_size; }
+	auto rescans() const -> uint64_t { return m_rescans; }
+	auto touches() const -> uint64_t { return m_touches; }
+	auto held() const -> uint64_t { return m_held; }
+
+private:
+	struct Slot
+	{
+		Handle m_handle = {};
+		uint64_t m_seq = 0; // last record of this cell, 0: none
+		uint32_t m_generation = 0;
+		bool m_used = false;
+	};
+	struct Record
+	{
+		uint32_t m_slot = 0;
+		uint32_t m_generation = 0;
+		uint64_t m_seq = 0;
+	};
+	struct Consumer
+	{
+		uint64_t m_cursor = 0;
+		bool m_used = false;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_free;
+	std::vector<Record> m_ring;
+	std::vector<Consumer> m_consumers;
+	uint64_t m_head = 0; // last record written
+	uint64_t m_max_cursor = 0; // furthest any consumer got, only grows
+	size_t m_size = 0;
+	uint64_t m_rescans = 0;
+	uint64_t m_touches = 0; // changes published, recorded or conflated
+	uint64_t m_held = 0;
+};
@@ -0,0 +1,293 @@
+// lastvalues.h
+// last value of every (symbol, topic) on the feed in named shared memory, written by one FeedHandler process,
+// read by any number of local processes (AwRTDServer with SharedFeed set, recorders, tools), so the feed is
+// joined and decoded once per machine
+// layout: header, ring of changes, hash table of 64 byte slots (linear probing, never deleted)
+// slot: seqlock (odd while written, 0 while empty), key is written once before the slot turns non zero, a writer
+//	killed mid write leaves it odd: the next writer to open the table evens it, readers give up on it after a while
+// ring: slot index per change sequence, a reader keeps its own cursor and replays ring[cursor + 1 .. head],
+//	a reader lapped by the writer rescans the table for slots changed after its cursor (conflated, never blocks the writer)
+//	an entry's sequence is 0 while its slot index is rewritten, so a reader never pairs a new index with an old sequence
+// values are raw feed values (type 1: int64, 2: double scaled by SCALE), same as EnhancedUDPData
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <atomic>
+#include <unordered_map>
+
+#include "../aw/mmap.h"
+
+namespace lastvalues
+{
+	static constexpr char MAGIC[8] = { 'A', 'W', 'L', 'V', 'T', '1', 0, 0 };
+	static constexpr size_t SYMBOL_SIZE = 24;
+	static constexpr size_t TOPIC_SIZE = 4; // 3 char feed topic, 0 padded
+
+	struct Value
+	{
+		char m_symbol[SYMBOL_SIZE]; // not 0 terminated when full
+		char m_topic[TOPIC_SIZE];
+		int32_t m_type;
+		int64_t m_value;
+		uint64_t m_mks; // packet timestamp
+		uint64_t m_change; // sequence of the write
+	};
+
+	struct Header
+	{
+		char m_magic[8];
+		uint64_t m_slots; // power of 2
+		uint64_t m_ring; // power of 2
+		std::atomic<uint64_t> m_sequence; // last change written, ring[m_sequence & (m_ring - 1)]
+		std::atomic<uint64_t> m_count; // slots in use
+		uint64_t m_start_mks; // writer start, wall clock
+		char m_filler[16];
+	};
+	static_assert(sizeof(Header) == 64, "header is 64 bytes");
+
+	struct Slot
+	{
+		std::atomic<uint64_t> m_lock;
+		uint64_t m_change;
+		char m_symbol[SYMBOL_SIZE];
+		char m_topic[TOPIC_SIZE];
+		int32_t m_type;
+		int64_t m_value;
+		uint64_t m_mks;
+	};
+	static_assert(sizeof(Slot) == 64, "slot is 64 bytes");
+
+	struct RingEntry
+	{
+		std::atomic<uint64_t> m_sequence; // 0 while m_slot is rewritten
+		std::atomic<uint64_t> m_slot;
+	};
+	static_assert(sizeof(RingEntry) == 16, "ring entry is 16 bytes");
+
+	inline auto bytes(uint64_t slots, uint64_t ring) -> size_t { return sizeof(Header) + ring * sizeof(RingEntry) + slots * sizeof(Slot); }
+	inline auto ring(char* base) -> RingEntry* { return reinterpret_cast<RingEntry*>(base + sizeof(Header)); }
+	inline auto slots(char* base) -> Slot* { return reinterpret_cast<Slot*>(base + sizeof(Header) + reinterpret_cast<Header*>(base)->m_ring * sizeof(RingEntry)); }
+
+	// symbol up to the first 0 (or 24 chars) then the 3 char topic, fnv-1a
+	inline auto hash(const char* symbol, const char* topic) -> uint64_t
+	{
+		uint64_t h = 14695981039346656037ull;
+		for (size_t i = 0; i < SYMBOL_SIZE && symbol[i]; i++)
+			h = (h ^ static_cast<unsigned char>(symbol[i])) * 1099511628211ull;
+		for (size_t i = 0; i < TOPIC_SIZE - 1; i++)
+			h = (h ^ static_cast<unsigned char>(topic[i])) * 1099511628211ull;
+		return h;
+	}
+	// symbol/topic 0 padded to their sizes
+	inline auto key(const char* symbol, const char* topic, char (&s)[SYMBOL_SIZE], char (&t)[TOPIC_SIZE]) -> void
+	{
+		memset(s, 0, sizeof(s));
+		memcpy(s, symbol, strnlen(symbol, SYMBOL_SIZE));
+		memset(t, 0, sizeof(t));
+		memcpy(t, topic, strnlen(topic, TOPIC_SIZE - 1));
+	}
+
+	// the FeedHandler side, one per shared memory name
+	class Writer
+	{
+	public:
+		// an existing table of the same geometry is kept (last values survive a feed handler restart)
+		auto open(const std::string& name, uint64_t num_slots, uint64_t ring_size) -> bool
+		{
+			if (!m_file.open_shared(name, bytes(num_slots, ring_size)))
+				return false;
+			Header* h = header();
+			if (memcmp(h->m_magic, MAGIC, sizeof(MAGIC)) != 0 || h->m_slots != num_slots || h->m_ring != ring_size) {
+				memset(m_file.data(), 0, bytes(num_slots, ring_size));
+				h->m_slots = num_slots;
+				h->m_ring = ring_size;
+				memcpy(h->m_magic, MAGIC, sizeof(MAGIC));
+			}
+			m_index.clear();
+			Slot* s = slots(m_file.data());
+			for (uint64_t i = 0; i < h->m_slots; i++) {
+				uint64_t lock = s[i].m_lock.load(std::memory_order_relaxed);
+				if (lock & 1) // previous writer died inside update(), lock + 2 would stay odd and readers spin on it
+					s[i].m_lock.store(lock + 1, std::memory_order_release);
+				if (lock != 0)
+					m_index[std::string(s[i].m_symbol, SYMBOL_SIZE) + std::string(s[i].m_topic, TOPIC_SIZE)] = i;
+			}
+			return true;
+		}
+
+		// false if the table is full (value dropped)
+		auto update(const char* symbol, const char* topic, int32_t type, int64_t value, uint64_t mks) -> bool
+		{
+			Header* h = header();
+			char sym[SYMBOL_SIZE], top[TOPIC_SIZE];
+			key(symbol, topic, sym, top);
+			m_key.assign(sym, SYMBOL_SIZE);
+			m_key.append(top, TOPIC_SIZE);
+			uint64_t index = 0;
+			auto it = m_index.find(m_key);
+			if (it != m_index.end()) {
+				index = it->second;
+			}
+			else {
+				if (h->m_count.load(std::memory_order_relaxed) * 4 >= h->m_slots * 3) // load <= 0.75 keeps probes short
+					return false;
+				Slot* s = slots(m_file.data());
+				for (index = hash(sym, top) & (h->m_slots - 1); s[index].m_lock.load(std::memory_order_relaxed) != 0; index = (index + 1) & (h->m_slots - 1))
+					;
+				memcpy(s[index].m_symbol, sym, SYMBOL_SIZE);
+				memcpy(s[index].m_topic, top, TOPIC_SIZE);
+				s[index].m_lock.store(2, std::memory_order_release); // key visible, no value yet (m_type 0)
+				h->m_count.store(h->m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				m_index.emplace(m_key, index);
+			}
+			uint64_t seq = h->m_sequence.load(std::memory_order_relaxed) + 1;
+			Slot& slot(slots(m_file.data())[index]);
+			uint64_t lock = slot.m_lock.load(std::memory_order_relaxed);
+			slot.m_lock.store(lock + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.m_change = seq;
+			slot.m_type = type;
+			slot.m_value = value;
+			slot.m_mks = mks;
+			slot.m_lock.store(lock + 2, std::memory_order_release);
+			RingEntry& e(ring(m_file.data())[seq & (h->m_ring - 1)]);
+			e.m_sequence.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			e.m_slot.store(index, std::memory_order_relaxed);
+			e.m_sequence.store(seq, std::memory_order_release);
+			h->m_sequence.store(seq, std::memory_order_release);
+			return true;
+		}
+
+		auto sequence() const -> uint64_t { return header()->m_sequence.load(std::memory_order_relaxed); }
+		auto count() const -> uint64_t { return header()->m_count.load(std::memory_order_relaxed); }
+
+	private:
+		auto header() const -> Header* { return reinterpret_cast<Header*>(m_file.data()); }
+
+		aw::MappedFile m_file;
+		std::unordered_map<std::string, uint64_t> m_index; // key -> slot, so the writer never probes twice
+		std::string m_key; // scratch
+	};
+
+	// read only mapping, each reader has its own cursor
+	class Reader
+	{
+	public:
+		// false if no writer created the table yet
+		auto open(const std::string& name) -> bool
+		{
+			if (!m_file.open_shared(name, 0) || m_file.size() < sizeof(Header))
+				return false;
+			const Header* h = header();
+			if (memcmp(h->m_magic, MAGIC, sizeof(MAGIC)) != 0 || m_file.size() < bytes(h->m_slots, h->m_ring)) {
+				m_file.close();
+				return false;
+			}
+			m_cursor = 0; // first poll hands out everything
+			return true;
+		}
+		auto is_open() const -> bool { return m_file.is_open(); }
+
+		auto find(const char* symbol, const char* topic, Value& value) const -> bool
+		{
+			const Header* h = header();
+			char sym[SYMBOL_SIZE], top[TOPIC_SIZE];
+			key(symbol, topic, sym, top);
+			const Slot* s = slots(m_file.data());
+			for (uint64_t i = hash(sym, top) & (h->m_slots - 1);; i = (i + 1) & (h->m_slots - 1)) {
+				if (s[i].m_lock.load(std::memory_order_acquire) == 0)
+					return false;
+				if (memcmp(s[i].m_symbol, sym, SYMBOL_SIZE) == 0 && memcmp(s[i].m_topic, top, TOPIC_SIZE) == 0)
+					return read(s[i], value);
+			}
+		}
+
+		// f(const Value&) for every slot changed since the last poll, latest value only, returns how many
+		template<typename F>
+		auto poll(F f) -> size_t
+		{
+			const Header* h = header();
+			uint64_t head = h->m_sequence.load(std::memory_order_acquire);
+			if (head == m_cursor)
+				return 0;
+			const RingEntry* r = ring(m_file.data());
+			const Slot* s = slots(m_file.data());
+			size_t count = 0;
+			Value value;
+			if (head - m_cursor <= h->m_ring) {
+				for (uint64_t seq = m_cursor + 1; seq <= head; seq++) {
+					const RingEntry& e(r[seq & (h->m_ring - 1)]);
+					if (e.m_sequence.load(std::memory_order_acquire) != seq)
+						return count + rescan(head, f); // lapped while replaying
+					uint64_t index = e.m_slot.load(std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (e.m_sequence.load(std::memory_order_relaxed) != seq)
+						return count + rescan(head, f);
+					// a later change of the same slot comes up again, only hand out the write this entry is for
+					if (read(s[index], value) && value.m_change == seq) {
+						f(value);
+						count++;
+					}
+				}
+				m_cursor = head;
+				return count;
+			}
+			return rescan(head, f);
+		}
+
+		auto cursor() const -> uint64_t { return m_cursor; }
+		auto rescans() const -> uint64_t { return m_rescans; }
+
+	private:
+		auto header() const -> const Header* { return reinterpret_cast<const Header*>(m_file.data()); }
+
+		static constexpr int READ_SPINS = 1 << 16; // a write takes nanoseconds, an odd lock for longer is a dead writer's
+
+		// seqlock read, false if the slot has no value yet or stays locked (its next write hands it out again)
+		static auto read(const Slot& slot, Value& value) -> bool
+		{
+			for (int spin = 0; spin < READ_SPINS; spin++) {
+				uint64_t lock = slot.m_lock.load(std::memory_order_acquire);
+				if (lock & 1)
+					continue;
+				memcpy(value.m_symbol, slot.m_symbol, SYMBOL_SIZE);
+				memcpy(value.m_topic, slot.m_topic, TOPIC_SIZE);
+				value.m_type = slot.m_type;
+				value.m_value = slot.m_value;
+				value.m_mks = slot.m_mks;
+				value.m_change = slot.m_change;
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.m_lock.load(std::memory_order_relaxed) == lock)
+					return value.m_type != 0;
+			}
+			return false;
+		}
+
+		// every slot written after the cursor, each once with its latest value
+		template<typename F>
+		auto rescan(uint64_t head, F f) -> size_t
+		{
+			const Header* h = header();
+			const Slot* s = slots(m_file.data());
+			size_t count = 0;
+			Value value;
+			for (uint64_t i = 0; i < h->m_slots; i++) {
+				if (s[i].m_lock.load(std::memory_order_acquire) != 0 && read(s[i], value) && value.m_change > m_cursor) {
+					f(value);
+					count++;
+				}
+			}
+			m_cursor = head; // changes after head may have been handed out already, they come again: harmless
+			m_rescans++;
+			return count;
+		}
+
+		aw::MappedFile m_file;
+		uint64_t m_cursor = 0;
+		uint64_t m_rescans = 0;
+	};
+}
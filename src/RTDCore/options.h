@@ -0,0 +1,410 @@
+// options.h
+// implied vol and greeks of listed options, =RTD("AwRTDServer",,"quote","IBM   240119C00150000","iv")
+// topics on an OCC option symbol (root padded or not, YYMMDD, C/P, strike * 1000 in 8 digits):
+//	iv: Black-Scholes implied vol of option mid, delta, gamma, vega (price change for 1 vol point)
+// options are grouped in chains by root, the root is also the underlying symbol (its mid is the spot)
+// an underlying tick dirties its whole chain, an option tick only itself, dirty legs of every chain are
+// gathered into one structure of arrays batch and solved aw::simd::Vec::WIDTH lanes at a time on refresh
+// expiry is 21:00 UTC (16:00 New York standard time) of the expiry date, time is feed time of the last tick,
+// rate is Configuration RiskFreeRate (continuous), no dividends
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+#include "../aw/simd.h"
+
+namespace options
+{
+	static constexpr uint64_t EXPIRY_UTC_SECONDS = 21 * 3600;
+	static constexpr double YEAR_MKS = 365.0 * 86400 * 1000000;
+
+	struct Contract
+	{
+		std::string m_root;
+		uint64_t m_expiry_mks = 0;
+		bool m_call = true;
+		double m_strike = 0;
+	};
+
+	// days since 1970-01-01 of a gregorian date
+	inline auto days_from_civil(int y, unsigned m, unsigned d) -> int64_t
+	{
+		y -= m <= 2;
+		const int64_t era = (y >= 0 ? y : y - 399) / 400;
+		const unsigned yoe = static_cast<unsigned>(y - era * 400);
+		const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+		const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + static_cast<int64_t>(doe) - 719468;
+	}
+
+	// false if symbol is not an OCC option symbol
+	inline auto parse_occ(const std::string& symbol, Contract& contract) -> bool
+	{
+		const size_t TAIL = 15; // YYMMDD C/P 8 digit strike
+		if (symbol.size() <= TAIL)
+			return false;
+		size_t tail = symbol.size() - TAIL;
+		auto digits = [&](size_t pos, size_t n, uint64_t& value) {
+			value = 0;
+			for (size_t i = pos; i < pos + n; i++) {
+				if (symbol[i] < '0' || symbol[i] > '9')
+					return false;
+				value = value * 10 + (symbol[i] - '0');
+			}
+			return true;
+		};
+		uint64_t yy, mm, dd, strike;
+		char cp = symbol[tail + 6];
+		if (!digits(tail, 2, yy) || !digits(tail + 2, 2, mm) || !digits(tail + 4, 2, dd) || !digits(tail + 7, 8, strike) ||
+			(cp != 'C' && cp != 'P') || mm < 1 || mm > 12 || dd < 1 || dd > 31 || strike == 0)
+			return false;
+		size_t root_end = tail;
+		while (root_end > 0 && symbol[root_end - 1] == ' ')
+			root_end--;
+		if (root_end == 0)
+			return false;
+		contract.m_root = symbol.substr(0, root_end);
+		int64_t days = days_from_civil(2000 + static_cast<int>(yy), static_cast<unsigned>(mm), static_cast<unsigned>(dd));
+		contract.m_expiry_mks = static_cast<uint64_t>(days * 86400 + EXPIRY_UTC_SECONDS) * 1000000;
+		contract.m_call = cp == 'C';
+		contract.m_strike = static_cast<double>(strike) / 1000;
+		return true;
+	}
+
+	// standard normal cdf given e = exp(-x * x / 2), Hart's double precision approximation as given by West (2005)
+	inline auto norm_cdf(aw::simd::Vec x, aw::simd::Vec e) -> aw::simd::Vec
+	{
+		using namespace aw::simd;
+		Vec a = abs(x);
+		Vec num = set1(3.52624965998911e-02) * a + set1(0.700383064443688);
+		num = num * a + set1(6.37396220353165);
+		num = num * a + set1(33.912866078383);
+		num = num * a + set1(112.079291497871);
+		num = num * a + set1(221.213596169931);
+		num = num * a + set1(220.206867912376);
+		Vec den = set1(8.83883476483184e-02) * a + set1(1.75566716318264);
+		den = den * a + set1(16.064177579207);
+		den = den * a + set1(86.7807322029461);
+		den = den * a + set1(296.564248779674);
+		den = den * a + set1(637.333633378831);
+		den = den * a + set1(793.826512519948);
+		den = den * a + set1(440.413735824752);
+		Vec near = e * num / den;
+		Vec cf = a + set1(0.65); // continued fraction for the tail
+		cf = a + set1(4.0) / cf;
+		cf = a + set1(3.0) / cf;
+		cf = a + set1(2.0) / cf;
+		cf = a + set1(1.0) / cf;
+		Vec far = e / cf / set1(2.506628274631);
+		Vec tail = select(lt(a, set1(7.07106781186547)), near, far);
+		tail = select(lt(a, set1(37.0)), tail, set1(0.0));
+		return select(gt(x, set1(0.0)), set1(1.0) - tail, tail);
+	}
+
+	// structure of arrays, padded to whole vectors, pad lanes have no price so they come out NaN
+	struct Batch
+	{
+		auto resize(size_t n) -> void
+		{
+			m_size = n;
+			size_t padded = (n + aw::simd::Vec::WIDTH - 1) / aw::simd::Vec::WIDTH * aw::simd::Vec::WIDTH;
+			for (auto* v : { &m_spot, &m_strike, &m_t, &m_sign, &m_price, &m_log_moneyness, &m_iv, &m_delta, &m_gamma, &m_vega })
+				v->resize(padded);
+			for (size_t i = n; i < padded; i++) {
+				m_spot[i] = m_strike[i] = m_t[i] = m_sign[i] = 1;
+				m_price[i] = NAN;
+			}
+		}
+		auto size() const -> size_t { return m_size; }
+
+		// inputs, sign is +1 call, -1 put
+		std::vector<double> m_spot, m_strike, m_t, m_sign, m_price;
+		// outputs, NaN where price is outside (intrinsic, upper bound) or time is up
+		std::vector<double> m_iv, m_delta, m_gamma, m_vega;
+		std::vector<double> m_log_moneyness; // scratch
+		size_t m_size = 0;
+	};
+
+	static constexpr double MIN_VOL = 1e-6;
+	static constexpr double MAX_VOL = 10;
+	static constexpr int MAX_ITERATIONS = 64;
+
+	// implied vol by safeguarded newton (bisection on the bracket when newton leaves it), then greeks at that vol
+	// lanes of a vector iterate together until all converged
+	inline auto solve(Batch& b, double rate) -> void
+	{
+		using namespace aw::simd;
+		const size_t n = b.m_spot.size();
+		for (size_t i = 0; i < n; i++)
+			b.m_log_moneyness[i] = std::log(b.m_spot[i] / b.m_strike[i]); // once per leg, not per iteration
+		const Vec zero = set1(0.0), half = set1(0.5), r = set1(rate), inv_sqrt_2pi = set1(0.3989422804014327);
+		for (size_t i = 0; i < n; i += Vec::WIDTH) {
+			Vec s = load(&b.m_spot[i]), k = load(&b.m_strike[i]), t = load(&b.m_t[i]), phi = load(&b.m_sign[i]);
+			Vec price = load(&b.m_price[i]), lsk = load(&b.m_log_moneyness[i]);
+			Vec sqrt_t = sqrt(max(t, zero));
+			Vec kdf = k * exp(-(r * t));
+			Vec intrinsic = max(phi * (s - kdf), zero);
+			Vec upper = select(gt(phi, zero), s, kdf);
+			Vec valid = mask_and(mask_and(mask_and(lt(zero, s), lt(zero, t)), lt(intrinsic, price)), lt(price, upper)); // NaN spot fails lt
+			Vec lo = set1(MIN_VOL), hi = set1(MAX_VOL);
+			Vec vol = min(max(sqrt(set1(2.0) * abs(lsk + r * t) / t), set1(0.05)), set1(3.0)); // max vega start
+			Vec d1, vs, e1;
+			auto evaluate = [&](Vec& model, Vec& vega) {
+				vs = vol * sqrt_t;
+				d1 = (lsk + (r + half * vol * vol) * t) / vs;
+				Vec d2 = d1 - vs;
+				e1 = exp(-(half * d1 * d1));
+				Vec e2 = exp(-(half * d2 * d2));
+				model = phi * (s * norm_cdf(phi * d1, e1) - kdf * norm_cdf(phi * d2, e2));
+				vega = s * e1 * inv_sqrt_2pi * sqrt_t;
+			};
+			Vec active = valid;
+			for (int it = 0; it < MAX_ITERATIONS && any(active); it++) {
+				Vec model, vega;
+				evaluate(model, vega);
+				Vec diff = model - price;
+				Vec above = lt(zero, diff);
+				hi = select(mask_and(active, above), vol, hi);
+				lo = select(mask_andnot(active, above), vol, lo);
+				Vec newton = vol - diff / vega;
+				Vec next = select(mask_and(lt(lo, newton), lt(newton, hi)), newton, half * (lo + hi));
+				Vec done = le(abs(next - vol), set1(1e-10)); // newton step, error after it is far smaller
+				vol = select(active, next, vol);
+				active = mask_andnot(active, done);
+			}
+			Vec model, vega;
+			evaluate(model, vega);
+			Vec pdf = e1 * inv_sqrt_2pi;
+			Vec nan = set1(NAN);
+			store(&b.m_iv[i], select(valid, vol, nan));
+			store(&b.m_delta[i], select(valid, phi * norm_cdf(phi * d1, e1), nan));
+			store(&b.m_gamma[i], select(valid, pdf / (s * vs), nan));
+			store(&b.m_vega[i], select(valid, vega * set1(0.01), nan));
+		}
+	}
+}
+
+// Handle identifies the subscriber (DataCache uses Cell*)
+template<typename Handle>
+class OptionsEngine
+{
+public:
+	enum Output { IV, DELTA, GAMMA, VEGA, NUM_OUTPUTS };
+
+	struct Leg
+	{
+		std::string m_symbol;
+		double m_strike = 0;
+		uint64_t m_expiry_mks = 0;
+		double m_sign = 1;
+		double m_price = NAN; // option mid
+		Handle m_cells[NUM_OUTPUTS] = {};
+		double m_last[NUM_OUTPUTS] = {};
+		uint32_t m_outputs = 0; // subscribed Output bits, 0 is a free slot
+		bool m_dirty = false;
+	};
+
+	struct Chain
+	{
+		std::string m_root;
+		double m_spot = NAN; // underlying mid
+		uint64_t m_mks = 0; // feed time of last tick of underlying or any leg
+		std::vector<Leg> m_legs; // slots, index stays valid until the leg is unsubscribed
+		std::vector<uint32_t> m_free;
+		std::vector<uint32_t> m_dirty; // legs quoted since last evaluate()
+		bool m_all_dirty = false; // spot moved
+		bool m_queued = false;
+		size_t m_size = 0;
+	};
+
+	struct LegRef
+	{
+		Chain* m_chain = nullptr;
+		uint32_t m_leg = 0;
+	};
+
+	// -1 if topic is not an analytics topic
+	static auto output(const std::string& topic) -> int
+	{
+		static const char* names[NUM_OUTPUTS] = { "iv", "delta", "gamma", "vega" };
+		for (int i = 0; i < NUM_OUTPUTS; i++) {
+			if (topic == names[i])
+				return i;
+		}
+		return -1;
+	}
+
+	auto set_rate(double rate) -> void { m_rate = rate; }
+
+	// new_chain: first leg of its root, caller starts feeding the underlying spot
+	auto subscribe(const std::string& symbol, const options::Contract& contract, int output, Handle cell, bool& new_chain) -> LegRef
+	{
+		Chain& chain(m_chains[contract.m_root]);
+		new_chain = chain.m_size == 0;
+		chain.m_root = contract.m_root;
+		uint32_t id = 0;
+		while (id < chain.m_legs.size() && (chain.m_legs[id].m_outputs == 0 || chain.m_legs[id].m_symbol != symbol))
+			id++;
+		if (id == chain.m_legs.size()) {
+			if (!chain.m_free.empty()) {
+				id = chain.m_free.back();
+				chain.m_free.pop_back();
+			}
+			else
+				chain.m_legs.emplace_back();
+			Leg& leg(chain.m_legs[id]);
+			leg = Leg();
+			leg.m_symbol = symbol;
+			leg.m_strike = contract.m_strike;
+			leg.m_expiry_mks = contract.m_expiry_mks;
+			leg.m_sign = contract.m_call ? 1 : -1;
+			chain.m_size++;
+		}
+		Leg& leg(chain.m_legs[id]);
+		leg.m_cells[output] = cell;
+		leg.m_last[output] = NAN;
+		leg.m_outputs |= 1u << output;
+		LegRef ref{ &chain, id };
+		mark(ref); // values for the new output on next evaluate if quotes are there
+		return ref;
+	}
+	// leg_gone: symbol has no output left, returns true if the chain went with it (caller stops feeding spot)
+	auto unsubscribe(LegRef ref, int output, bool& leg_gone) -> bool
+	{
+		Chain& chain(*ref.m_chain);
+		Leg& leg(chain.m_legs[ref.m_leg]);
+		leg.m_outputs &= ~(1u << output);
+		leg_gone = leg.m_outputs == 0;
+		if (!leg_gone)
+			return false;
+		leg = Leg();
+		chain.m_free.push_back(ref.m_leg);
+		if (--chain.m_size > 0)
+			return false;
+		auto it = std::find(m_dirty_chains.begin(), m_dirty_chains.end(), &chain);
+		if (it != m_dirty_chains.end())
+			m_dirty_chains.erase(it);
+		m_chains.erase(std::string(chain.m_root));
+		return true;
+	}
+
+	// option mid from feed
+	auto quote(LegRef ref, double price, uint64_t mks) -> void
+	{
+		Leg& leg(ref.m_chain->m_legs[ref.m_leg]);
+		ref.m_chain->m_mks = (std::max)(ref.m_chain->m_mks, mks);
+		if (price == leg.m_price)
+			return;
+		leg.m_price = price;
+		mark(ref);
+	}
+	// underlying mid from feed, whole chain reprices
+	auto spot(Chain& chain, double price, uint64_t mks) -> void
+	{
+		chain.m_mks = (std::max)(chain.m_mks, mks);
+		if (price == chain.m_spot)
+			return;
+		chain.m_spot = price;
+		chain.m_all_dirty = true;
+		queue(chain);
+	}
+
+	// solves every dirty leg of every chain in one batch, publish(cell, value) for outputs that moved
+	template<typename Publish>
+	auto evaluate(Publish publish) -> size_t
+	{
+		if (m_dirty_chains.empty())
+			return 0;
+		m_refs.clear();
+		for (Chain* chain : m_dirty_chains) {
+			if (std::isnan(chain->m_spot)) {
+				// no underlying tick yet, its first one dirties the whole chain anyway
+			}
+			else if (chain->m_all_dirty) {
+				for (uint32_t id = 0; id < chain->m_legs.size(); id++) {
+					if (chain->m_legs[id].m_outputs)
+						m_refs.push_back(LegRef{ chain, id });
+				}
+			}
+			else {
+				for (uint32_t id : chain->m_dirty) {
+					Leg& leg(chain->m_legs[id]);
+					if (leg.m_outputs && leg.m_dirty) { // slot may have been freed and reused, listed twice
+						leg.m_dirty = false;
+						m_refs.push_back(LegRef{ chain, id });
+					}
+				}
+			}
+			for (uint32_t id : chain->m_dirty)
+				chain->m_legs[id].m_dirty = false;
+			chain->m_dirty.clear();
+			chain->m_all_dirty = false;
+			chain->m_queued = false;
+		}
+		m_dirty_chains.clear();
+		m_batch.resize(m_refs.size());
+		for (size_t i = 0; i < m_refs.size(); i++) {
+			const Chain& chain(*m_refs[i].m_chain);
+			const Leg& leg(chain.m_legs[m_refs[i].m_leg]);
+			m_batch.m_spot[i] = chain.m_spot;
+			m_batch.m_strike[i] = leg.m_strike;
+			m_batch.m_t[i] = (static_cast<double>(leg.m_expiry_mks) - static_cast<double>(chain.m_mks)) / options::YEAR_MKS;
+			m_batch.m_sign[i] = leg.m_sign;
+			m_batch.m_price[i] = leg.m_price;
+		}
+		options::solve(m_batch, m_rate);
+		for (size_t i = 0; i < m_refs.size(); i++) {
+			Leg& leg(m_refs[i].m_chain->m_legs[m_refs[i].m_leg]);
+			const double values[NUM_OUTPUTS] = { m_batch.m_iv[i], m_batch.m_delta[i], m_batch.m_gamma[i], m_batch.m_vega[i] };
+			for (int o = 0; o < NUM_OUTPUTS; o++) {
+				if (!(leg.m_outputs & (1u << o)) || std::isnan(values[o]) || values[o] == leg.m_last[o])
+					continue;
+				leg.m_last[o] = values[o];
+				publish(leg.m_cells[o], values[o]);
+			}
+		}
+		m_computed += m_refs.size();
+		return m_refs.size();
+	}
+
+	auto size() const -> size_t
+	{
+		size_t n = 0;
+		for (auto& it : m_chains)
+			n += it.second.m_size;
+		return n;
+	}
+	auto computed() const -> uint64_t { return m_computed; }
+	auto dirty() const -> bool { return !m_dirty_chains.empty(); }
+
+private:
+	auto mark(LegRef ref) -> void
+	{
+		Leg& leg(ref.m_chain->m_legs[ref.m_leg]);
+		if (!leg.m_dirty) {
+			leg.m_dirty = true;
+			ref.m_chain->m_dirty.push_back(ref.m_leg);
+		}
+		queue(*ref.m_chain);
+	}
+	auto queue(Chain& chain) -> void
+	{
+		if (chain.m_queued)
+			return;
+		chain.m_queued = true;
+		m_dirty_chains.push_back(&chain);
+	}
+
+	std::unordered_map<std::string, Chain> m_chains; // by root, nodes never move so LegRef keeps Chain*
+	std::vector<Chain*> m_dirty_chains;
+	std::vector<LegRef> m_refs; // batch lane -> leg
+	options::Batch m_batch;
+	double m_rate = 0;
+	uint64_t m_computed = 0;
+};
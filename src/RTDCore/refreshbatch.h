@@ -0,0 +1,94 @@
+// refreshbatch.h
+// RefreshData's output built in place: the 2 x n SAFEARRAY excel gets is created at its final size and filled
+// through SafeArrayAccessData in one pass, no vector of pairs in between and no SafeArrayPutElement per element
+// (each one locks the array and deep copies the VARIANT)
+// element (0, i) is the topic id, (1, i) the value, the first index varies fastest: pair i is data[2i], data[2i + 1]
+// numeric values are plain struct copies, only a BSTR ("tms" text) is copied, excel owns the array and its contents
+// windows or anything providing the same VARIANT/SAFEARRAY api (RefreshBench's stand-in)
+
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+class RefreshBatch
+{
+public:
+	RefreshBatch() {}
+	RefreshBatch(const RefreshBatch&) = delete;
+	RefreshBatch& operator=(const RefreshBatch&) = delete;
+	~RefreshBatch()
+	{
+		if (!m_array)
+			return;
+		SafeArrayUnaccessData(m_array);
+		SafeArrayDestroy(m_array); // never handed out, frees the values written so far
+	}
+
+	// array for count (topic id, value) pairs, elements start out VT_EMPTY
+	auto start(size_t count) -> bool
+	{
+		SAFEARRAYBOUND bounds[2];
+		bounds[0].cElements = 2;
+		bounds[0].lLbound = 0;
+		bounds[1].cElements = static_cast<ULONG>(count);
+		bounds[1].lLbound = 0;
+		m_array = SafeArrayCreate(VT_VARIANT, 2, bounds);
+		if (!m_array)
+			return false;
+		void* data = nullptr;
+		if (FAILED(SafeArrayAccessData(m_array, &data))) {
+			SafeArrayDestroy(m_array);
+			m_array = nullptr;
+			return false;
+		}
+		m_data = static_cast<VARIANT*>(data);
+		m_count = count;
+		m_size = 0;
+		return true;
+	}
+
+	auto add(LONG topic_id, const VARIANT& value) -> void
+	{
+		VARIANT* pair = m_data + 2 * m_size++;
+		pair[0].vt = VT_I4;
+		pair[0].lVal = topic_id;
+		switch (value.vt) {
+		case VT_R8:
+		case VT_I8:
+		case VT_I4:
+			pair[1] = value;
+			break;
+		default:
+			VariantCopy(&pair[1], &value);
+			break;
+		}
+	}
+
+	// count pairs laid out like the array's, taken over as they are: the batch owns their values from here
+	auto move(const VARIANT* pairs, size_t count) -> void
+	{
+		memcpy(m_data + 2 * m_size, pairs, 2 * count * sizeof(VARIANT));
+		m_size += count;
+	}
+
+	auto size() const -> size_t { return m_size; }
+	auto capacity() const -> size_t { return m_count; }
+
+	// array for RefreshData's parrayOut, count pairs written, caller (excel) owns it from here
+	auto finish(long* count) -> SAFEARRAY*
+	{
+		SafeArrayUnaccessData(m_array);
+		*count = static_cast<long>(m_size);
+		SAFEARRAY* array = m_array;
+		m_array = nullptr;
+		m_data = nullptr;
+		return array;
+	}
+
+private:
+	SAFEARRAY* m_array = nullptr;
+	VARIANT* m_data = nullptr;
+	size_t m_count = 0;
+	size_t m_size = 0;
+};
@@ -0,0 +1,118 @@
+// refreshbuffer.h
+// next RefreshData's values, kept up to date by the feed side as cells change: DataCache holds two, the pending one
+// and a spare, and swaps them under its lock when excel pulls, RefreshData then only moves the values into excel's array
+// flat (topic id, value) VARIANT pairs in the order excel gets them, a cell already in the buffer is overwritten in
+// place (set() at its index), one leaving it (DisconnectData) leaves a hole that is skipped when moved out
+// values are owned by the buffer until moved out, numeric ones are plain struct copies, only a BSTR is copied
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+#include <utility>
+#include "refreshbatch.h"
+
+class RefreshBuffer
+{
+public:
+	RefreshBuffer() {}
+	RefreshBuffer(const RefreshBuffer&) = delete;
+	RefreshBuffer& operator=(const RefreshBuffer&) = delete;
+	~RefreshBuffer() { clear(); }
+
+	// count empty pairs at the end, returns the first one's index
+	auto append(size_t count) -> size_t
+	{
+		size_t index = m_pairs.size() / 2;
+		VARIANT empty;
+		VariantInit(&empty);
+		m_pairs.resize(m_pairs.size() + 2 * count, empty);
+		return index;
+	}
+
+	// pair at index gets topic_id and value, the value it had is released
+	auto set(size_t index, LONG topic_id, const VARIANT& value) -> void
+	{
+		VARIANT* pair = &m_pairs[2 * index];
+		pair[0].vt = VT_I4;
+		pair[0].lVal = topic_id;
+		VariantClear(&pair[1]);
+		switch (value.vt) {
+		case VT_R8:
+		case VT_I8:
+		case VT_I4:
+			pair[1] = value;
+			break;
+		default:
+			VariantCopy(&pair[1], &value);
+			break;
+		}
+	}
+
+	// count pairs from index become a hole
+	auto erase(size_t index, size_t count) -> void
+	{
+		for (size_t i = index; i < index + count; i++) {
+			m_pairs[2 * i].vt = VT_EMPTY;
+			VariantClear(&m_pairs[2 * i + 1]);
+		}
+		m_holes += count;
+	}
+
+	// values excel would get
+	auto size() const -> size_t { return m_pairs.size() / 2 - m_holes; }
+	auto empty() const -> bool { return size() == 0; }
+
+	auto swap(RefreshBuffer& other) -> void
+	{
+		m_pairs.swap(other.m_pairs);
+		std::swap(m_holes, other.m_holes);
+	}
+
+	// every pair moves to the end of other, holes too, this one is left empty
+	auto move_to(RefreshBuffer& other) -> void
+	{
+		other.m_pairs.insert(other.m_pairs.end(), m_pairs.begin(), m_pairs.end());
+		other.m_holes += m_holes;
+		m_pairs.clear();
+		m_holes = 0;
+	}
+	// values move into batch (started for size() pairs), runs between holes in one copy each, this one is left empty
+	// with its capacity
+	auto move_to(RefreshBatch& batch) -> void
+	{
+		size_t count = m_pairs.size() / 2;
+		size_t run = 0;
+		for (size_t i = 0; i <= count; i++) {
+			if (i < count && m_pairs[2 * i].vt != VT_EMPTY)
+				continue;
+			if (i > run)
+				batch.move(&m_pairs[2 * run], i - run);
+			run = i + 1;
+		}
+		m_pairs.clear();
+		m_holes = 0;
+	}
+	// same as pairs, caller owns (VariantClear) the values
+	auto move_to(std::vector<std::pair<VARIANT, VARIANT>>& data) -> void
+	{
+		for (size_t i = 0; i < m_pairs.size(); i += 2) {
+			if (m_pairs[i].vt != VT_EMPTY)
+				data.push_back(std::make_pair(m_pairs[i], m_pairs[i + 1]));
+		}
+		m_pairs.clear();
+		m_holes = 0;
+	}
+
+	auto clear() -> void
+	{
+		for (size_t i = 1; i < m_pairs.size(); i += 2)
+			VariantClear(&m_pairs[i]);
+		m_pairs.clear();
+		m_holes = 0;
+	}
+
+private:
+	std::vector<VARIANT> m_pairs; // pair i is m_pairs[2i] (topic id, VT_EMPTY for a hole), m_pairs[2i + 1]
+	size_t m_holes = 0;
+};
@@ -0,0 +1,92 @@
+// refreshqueue.h
+// cells waiting for RefreshData, one FIFO bucket per priority class, so a burst is handed to excel in bounded batches
+// =RTD("AwRTDServer",,"quote","IBM","bid","hot"): hot (visible blotters), normal (default), cold (background sheets)
+// a queued cell keeps its place when it changes again, it goes out once with its latest value
+// pop(): weighted rounds (hot 4, normal 2, cold 1 shares of what's left of the batch), a share a class can't use goes
+//	to the others, so hot goes first but cold always gets at least 1/7 of a batch while it has a backlog
+// entries are journal (slot, generation), a cell removed while queued is skipped, never dereferenced
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <deque>
+#include <algorithm>
+
+class RefreshQueue
+{
+public:
+	enum Priority { HOT, NORMAL, COLD, NUM_PRIORITIES };
+	static constexpr size_t WEIGHTS[NUM_PRIORITIES] = { 4, 2, 1 };
+
+	// false if token isn't a priority
+	static auto parse(const std::string& token, int& priority) -> bool
+	{
+		static const char* names[NUM_PRIORITIES] = { "hot", "normal", "cold" };
+		for (int i = 0; i < NUM_PRIORITIES; i++) {
+			if (token == names[i]) {
+				priority = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	auto push(uint32_t slot, uint32_t generation, int priority) -> void
+	{
+		m_buckets[priority].push_back(Entry{ slot, generation });
+		m_size++;
+	}
+
+	// emit(slot, generation) returns the values it added (0 for a cell gone since), stops once budget values are out
+	// (a cell's TopicIDs are never split, the last one may go over), budget 0: everything
+	template<typename F>
+	auto pop(size_t budget, F emit) -> size_t
+	{
+		size_t out = 0;
+		if (budget == 0) {
+			for (auto& bucket : m_buckets) {
+				for (const Entry& e : bucket)
+					out += emit(e.m_slot, e.m_generation);
+				m_size -= bucket.size();
+				bucket.clear();
+			}
+			return out;
+		}
+		while (out < budget && m_size) {
+			size_t weights = 0;
+			for (int i = 0; i < NUM_PRIORITIES; i++)
+				weights += m_buckets[i].empty() ? 0 : WEIGHTS[i];
+			size_t round = budget - out;
+			for (int i = 0; i < NUM_PRIORITIES && out < budget; i++) {
+				auto& bucket(m_buckets[i]);
+				size_t share = (std::max)(round * WEIGHTS[i] / weights, static_cast<size_t>(1));
+				size_t used = 0;
+				while (used < share && out < budget && !bucket.empty()) {
+					Entry e(bucket.front());
+					bucket.pop_front();
+					m_size--;
+					size_t n = emit(e.m_slot, e.m_generation);
+					used += n;
+					out += n;
+				}
+			}
+		}
+		return out;
+	}
+
+	auto size() const -> size_t { return m_size; }
+	auto size(int priority) const -> size_t { return m_buckets[priority].size(); }
+	auto empty() const -> bool { return m_size == 0; }
+
+private:
+	struct Entry
+	{
+		uint32_t m_slot;
+		uint32_t m_generation;
+	};
+
+	std::deque<Entry> m_buckets[NUM_PRIORITIES];
+	size_t m_size = 0;
+};
@@ -0,0 +1,344 @@
+// rolling.h
+// rolling window aggregates per symbol, =RTD("AwRTDServer",,"quote","IBM","hi5m")
+// topic is <aggregate><length><unit>, aggregate: hi, lo (of mid), vol (volume traded), tck (tick count)
+//	unit: s, m, h, ex: hi5m, lo30s, vol1h, tck5m
+// RollingWindow: fixed ring of BUCKETS time buckets, window moves one bucket at a time (5m window -> 5s buckets)
+//	hi/lo are monotonic deques of bucket indices, volume/ticks are running sums minus expired buckets
+//	every tick is O(1) amortized, memory is fixed per window, buckets expire on the ingest thread as ticks arrive and,
+//	for a symbol that went quiet, when a timer wheel on the feed clock reaches the oldest bucket still holding ticks
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+#include "derived.h"
+#include "../aw/timerwheel.h"
+
+class RollingWindow
+{
+public:
+	static constexpr uint32_t BUCKETS = 60;
+
+	explicit RollingWindow(uint64_t window_mks)
+		: m_window_mks(window_mks), m_width((std::max)(window_mks / BUCKETS, static_cast<uint64_t>(1)))
+	{}
+
+	// has_price false: packet had no quote yet, still counts as a tick
+	auto add(uint64_t mks, bool has_price, double price, double volume) -> void
+	{
+		uint64_t index = mks / m_width;
+		if (!m_started) {
+			m_cur = index;
+			m_started = true;
+		}
+		else if (index < m_cur)
+			index = m_cur; // late packet counts in the current bucket
+		advance(index);
+		Bucket& b(m_ring[index % BUCKETS]);
+		b.m_ticks++;
+		b.m_volume += volume;
+		m_ticks_total++;
+		m_volume += volume;
+		if (!has_price)
+			return;
+		if (b.m_hi < price || !b.m_has_price)
+			push(m_hi, index, price, [](double lhs, double rhs) { return lhs <= rhs; });
+		if (b.m_lo > price || !b.m_has_price)
+			push(m_lo, index, price, [](double lhs, double rhs) { return lhs >= rhs; });
+		if (!b.m_has_price) {
+			b.m_hi = b.m_lo = price;
+			b.m_has_price = true;
+		}
+		else {
+			b.m_hi = (std::max)(b.m_hi, price);
+			b.m_lo = (std::min)(b.m_lo, price);
+		}
+	}
+
+	// no tick: buckets older than the window at mks leave it
+	auto expire(uint64_t mks) -> void
+	{
+		uint64_t index = mks / m_width;
+		if (m_started && index > m_cur)
+			advance(index);
+	}
+	// when the oldest bucket with ticks leaves the window (its values move), 0 if none
+	auto expiry_mks() const -> uint64_t
+	{
+		if (!m_started)
+			return 0;
+		for (uint64_t i = m_cur >= BUCKETS ? m_cur - BUCKETS + 1 : 0; i <= m_cur; i++) {
+			if (m_ring[i % BUCKETS].m_ticks > 0)
+				return (i + BUCKETS) * m_width;
+		}
+		return 0;
+	}
+
+	auto window_mks() const -> uint64_t { return m_window_mks; }
+	auto hi() const -> double { return m_hi.empty() ? NAN : m_hi.front().m_price; }
+	auto lo() const -> double { return m_lo.empty() ? NAN : m_lo.front().m_price; }
+	auto volume() const -> double { return m_volume; }
+	auto ticks() const -> uint64_t { return m_ticks_total; }
+
+private:
+	struct Bucket
+	{
+		double m_hi = 0;
+		double m_lo = 0;
+		double m_volume = 0;
+		uint64_t m_ticks = 0;
+		bool m_has_price = false;
+	};
+
+	struct Entry
+	{
+		uint64_t m_index;
+		double m_price;
+	};
+
+	// fixed capacity deque, at most one entry per live bucket
+	class MonotonicDeque
+	{
+	public:
+		auto empty() const -> bool { return m_size == 0; }
+		auto front() const -> const Entry& { return m_entries[m_head]; }
+		auto back() const -> const Entry& { return m_entries[(m_head + m_size - 1) % BUCKETS]; }
+		auto pop_front() -> void { m_head = (m_head + 1) % BUCKETS; m_size--; }
+		auto pop_back() -> void { m_size--; }
+		auto push_back(const Entry& e) -> void { m_entries[(m_head + m_size) % BUCKETS] = e; m_size++; }
+	private:
+		std::array<Entry, BUCKETS> m_entries;
+		uint32_t m_head = 0;
+		uint32_t m_size = 0;
+	};
+
+	// dominated(back, price): back can never be the answer again once price is in the window
+	template<typename Dominated>
+	static auto push(MonotonicDeque& dq, uint64_t index, double price, Dominated dominated) -> void
+	{
+		while (!dq.empty() && (dq.back().m_index == index || dominated(dq.back().m_price, price)))
+			dq.pop_back();
+		dq.push_back(Entry{ index, price });
+	}
+
+	// moves window so index is the newest bucket, subtracting buckets that fall out
+	auto advance(uint64_t index) -> void
+	{
+		if (index != m_cur) {
+			if (index - m_cur >= BUCKETS) {
+				m_ring.fill(Bucket());
+				m_volume = 0;
+				m_ticks_total = 0;
+			}
+			else {
+				for (uint64_t i = m_cur + 1; i <= index; i++) {
+					Bucket& old(m_ring[i % BUCKETS]); // bucket i - BUCKETS leaves the window
+					m_volume -= old.m_volume;
+					m_ticks_total -= old.m_ticks;
+					old = Bucket();
+				}
+			}
+			m_cur = index;
+		}
+		uint64_t oldest = index >= BUCKETS ? index - BUCKETS + 1 : 0;
+		while (!m_hi.empty() && m_hi.front().m_index < oldest)
+			m_hi.pop_front();
+		while (!m_lo.empty() && m_lo.front().m_index < oldest)
+			m_lo.pop_front();
+		if (m_volume < 0 || m_ticks_total == 0) // rounding left overs
+			m_volume = 0;
+	}
+
+	uint64_t m_window_mks;
+	uint64_t m_width; // bucket length
+	uint64_t m_cur = 0; // newest bucket index
+	bool m_started = false;
+	std::array<Bucket, BUCKETS> m_ring;
+	MonotonicDeque m_hi;
+	MonotonicDeque m_lo;
+	double m_volume = 0;
+	uint64_t m_ticks_total = 0;
+};
+
+// rolling topics of one symbol, windows are shared by every aggregate of the same length
+// Handle identifies the subscriber (DataCache uses Cell*)
+// a symbol that stops ticking still has its windows drain: one timer per symbol on a wheel in WHEEL_UNIT_MKS, set for
+// the earliest bucket expiry of its windows, republishing what moved when it fires
+template<typename Handle>
+class RollingTopics
+{
+public:
+	enum Aggregate { HI, LO, VOL, TCK, NUM_AGGREGATES };
+	static constexpr uint64_t WHEEL_UNIT_MKS = 1000; // timer wheel runs in milliseconds
+
+	RollingTopics() : m_expiry(this) {}
+	RollingTopics(const RollingTopics&) = delete;
+	RollingTopics& operator=(const RollingTopics&) = delete;
+
+	// false if topic is not a rolling topic
+	static auto parse(const std::string& topic, int& aggregate, uint64_t& window_mks) -> bool
+	{
+		static const char* names[NUM_AGGREGATES] = { "hi", "lo", "vol", "tck" };
+		for (int a = 0; a < NUM_AGGREGATES; a++) {
+			size_t n = strlen(names[a]);
+			if (topic.compare(0, n, names[a]) != 0)
+				continue;
+			size_t pos = n;
+			uint64_t length = 0;
+			while (pos < topic.size() && topic[pos] >= '0' && topic[pos] <= '9' && length < 1000000)
+				length = length * 10 + (topic[pos++] - '0');
+			if (pos == n || length == 0 || pos + 1 != topic.size())
+				return false;
+			uint64_t unit = topic[pos] == 's' ? 1 : topic[pos] == 'm' ? 60 : topic[pos] == 'h' ? 3600 : 0;
+			if (unit == 0 || length * unit > MAX_WINDOW_SECONDS)
+				return false;
+			aggregate = a;
+			window_mks = length * unit * 1000000;
+			return true;
+		}
+		return false;
+	}
+
+	auto subscribe(int aggregate, uint64_t window_mks, Handle cell) -> void
+	{
+		size_t w = 0;
+		while (w < m_windows.size() && m_windows[w].window_mks() != window_mks)
+			w++;
+		if (w == m_windows.size())
+			m_windows.emplace_back(window_mks);
+		m_outputs.push_back(Output{ cell, aggregate, w, NAN });
+	}
+	// window memory is dropped with the last output using it
+	auto unsubscribe(Handle cell) -> void
+	{
+		for (size_t i = 0; i < m_outputs.size(); i++) {
+			if (m_outputs[i].m_cell != cell)
+				continue;
+			size_t w = m_outputs[i].m_window;
+			m_outputs[i] = m_outputs.back();
+			m_outputs.pop_back();
+			bool used = false;
+			for (auto& o : m_outputs)
+				used |= o.m_window == w;
+			if (!used) {
+				m_windows[w] = m_windows.back();
+				m_windows.pop_back();
+				for (auto& o : m_outputs) {
+					if (o.m_window == m_windows.size())
+						o.m_window = w;
+				}
+			}
+			return;
+		}
+	}
+	auto subscribed() const -> bool { return !m_outputs.empty(); }
+
+	// from data source side, one call per field of a packet (DerivedTopics::Input)
+	auto set(int input, double value) -> void
+	{
+		switch (input) {
+		case DerivedTopics::BID:
+			m_bid = value;
+			m_has |= 1u << input;
+			break;
+		case DerivedTopics::ASK:
+			m_ask = value;
+			m_has |= 1u << input;
+			break;
+		case DerivedTopics::VOL:
+			if ((m_has & (1u << input)) && value > m_last_volume)
+				m_volume_delta += value - m_last_volume;
+			m_last_volume = value;
+			m_has |= 1u << input;
+			break;
+		default:
+			break;
+		}
+	}
+
+	// once per packet, publish(cell, value) for every output that moved, the expiry timer is set if it isn't
+	template<typename Publish>
+	auto tick(uint64_t mks, aw::TimerWheel& wheel, Publish publish) -> void
+	{
+		bool has_price = (m_has & QUOTE) == QUOTE;
+		double mid = (m_bid + m_ask) / 2;
+		for (auto& w : m_windows)
+			w.add(mks, has_price, mid, m_volume_delta);
+		m_volume_delta = 0;
+		publish_outputs(publish);
+		if (!m_expiry.scheduled()) // a set one is for an older bucket, so earlier
+			schedule(wheel);
+	}
+
+	// wheel's fire for a RollingTopics timer: windows move to the wheel's time, NaN for hi/lo of a window left empty
+	template<typename Publish>
+	static auto on_timer(aw::TimerNode& node, aw::TimerWheel& wheel, Publish publish) -> void
+	{
+		RollingTopics& topics(*static_cast<Expiry&>(node).m_owner);
+		for (auto& w : topics.m_windows)
+			w.expire(wheel.now() * WHEEL_UNIT_MKS);
+		topics.publish_outputs(publish);
+		topics.schedule(wheel);
+	}
+
+private:
+	struct Expiry : aw::TimerNode
+	{
+		Expiry(RollingTopics* owner) : m_owner(owner) {}
+		RollingTopics* m_owner;
+	};
+
+	template<typename Publish>
+	auto publish_outputs(Publish publish) -> void
+	{
+		for (auto& o : m_outputs) {
+			const RollingWindow& w(m_windows[o.m_window]);
+			double value = o.m_aggregate == HI ? w.hi() : o.m_aggregate == LO ? w.lo() :
+				o.m_aggregate == VOL ? w.volume() : static_cast<double>(w.ticks());
+			if (value == o.m_last || (std::isnan(value) && std::isnan(o.m_last)))
+				continue;
+			o.m_last = value;
+			publish(o.m_cell, value);
+		}
+	}
+	// earliest bucket expiry of any window, rounded up to the wheel's unit
+	auto schedule(aw::TimerWheel& wheel) -> void
+	{
+		uint64_t next = 0;
+		for (auto& w : m_windows) {
+			uint64_t mks = w.expiry_mks();
+			if (mks && (!next || mks < next))
+				next = mks;
+		}
+		if (next)
+			wheel.schedule(m_expiry, (next + WHEEL_UNIT_MKS - 1) / WHEEL_UNIT_MKS);
+		else
+			m_expiry.cancel();
+	}
+
+	static constexpr uint64_t MAX_WINDOW_SECONDS = 24 * 3600;
+	static constexpr uint32_t QUOTE = (1u << DerivedTopics::BID) | (1u << DerivedTopics::ASK);
+
+	struct Output
+	{
+		Handle m_cell;
+		int m_aggregate;
+		size_t m_window;
+		double m_last;
+	};
+
+	std::vector<RollingWindow> m_windows;
+	std::vector<Output> m_outputs;
+	double m_bid = 0;
+	double m_ask = 0;
+	double m_last_volume = 0;
+	uint32_t m_has = 0; // DerivedTopics::Input bits seen
+	double m_volume_delta = 0; // since last tick()
+	Expiry m_expiry; // cancelled by its destructor when the symbol's last rolling topic goes
+};
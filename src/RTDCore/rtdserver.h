@@ -0,0 +1,275 @@
+// rtdserver.h
+// the RTD server without COM: what excel's IRtdServer calls do, on plain strings and the core's VARIANT (variant.h)
+// AwRTD (COM) only converts excel's arguments and forwards, a host on linux (tests, benchmarks) calls it directly
+// connect(): ConnectData's strings, quote/depth/expr actions, initial value or placeholder text into out
+//   (strings excel passed narrowed into reused buffers, options parsed once, registration queued if the feed holds the cache)
+// refresh(): RefreshData, values the feed side staged moved into a RefreshBatch
+// notify_loop(): the notifier thread, update_notify() (IRTDUpdateEvent::UpdateNotify) when the pacer says so
+// every instance in the process (excel loads one per workbook set, or per excel with several open) shares one
+// DataCache::shared(), so one socket, feed thread and copy of each symbol, with a DataCache::View of its own
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+
+#include "../aw/event.h"
+#include "configuration.h"
+#include "datacache.h"
+
+class RtdServer
+{
+public:
+	RtdServer() {}
+	RtdServer(const RtdServer&) = delete;
+	RtdServer& operator=(const RtdServer&) = delete;
+	~RtdServer() { stop(); }
+
+	// ServerStart, the feed starts with the process's first instance
+	auto start() -> bool
+	{
+		m_shutdown.reset();
+		m_started = true;
+		return m_cache->start_shared();
+	}
+
+	// ServerTerminate, notify_loop() returns, the feed stops with the last instance started, this one's TopicIDs go
+	// with it (destructor)
+	auto stop() -> bool
+	{
+		m_shutdown.set();
+		m_view.notify_event().set();
+		if (!m_started)
+			return true;
+		m_started = false;
+		return m_cache->stop_shared();
+	}
+
+	// ConnectData, strings as excel passed them ("quote", "IBM", "bid"[, "hot 2t"]), false if they aren't a topic of
+	// this server (out untouched), otherwise out has the value or the placeholder text
+	// ex: quote, MSFT, bid
+	//     expr, IBM.bid-MSFT.ask*0.5
+	//     depth, IBM, bidSize3
+	//     quote, IBM, bid@10:00 (with TickStoreDir set, also bid#2)
+	//     quote, IBM, stale (1 while values are from the SnapshotFile or no packet came for StaleMs)
+	//     quote, IBM, bid, 2t (deadband: only moves of 2 ticks or more, 0.05% for relative)
+	//     quote, IBM, bid, hot 2t (refresh priority when MaxRefreshBatch bounds RefreshData: hot, normal, cold)
+	auto connect(LONG topic_id, const std::vector<std::string>& strings, VARIANT* out) -> bool
+	{
+		return connect(topic_id, strings.data(), strings.size(), out);
+	}
+	// excel's thread only: the parsed cell goes through scratch kept here
+	auto connect(LONG topic_id, const std::string* strings, size_t count, VARIANT* out) -> bool
+	{
+		if (count == 0) {
+			AW_LOG("RtdServer::connect: no parameter (action)");
+			return false;
+		}
+		const std::string& action = strings[0];
+		if (!action.compare(Configuration::expr_command)) {
+			// expr, text: parsed once here, evaluated server side when its inputs move
+			if (count < 2) {
+				AW_LOG("RtdServer::connect: no second parameter (expression)");
+				return false;
+			}
+			const std::string& text = strings[1];
+			std::string error;
+			if (!m_view.add_expression(text, topic_id, error, out)) {
+				AW_LOG("RtdServer::connect: expression<" << text << "> topic_id<" << topic_id << "> error<" << error << ">");
+				m_cache->text("#EXPR " + error, out);
+				return true;
+			}
+			if (out->vt == VT_EMPTY) // an input has no value yet, the value comes with a RefreshData
+				m_cache->waiting(out);
+			return true;
+		}
+		// if not quote or depth, nothing to serve
+		if (action.compare(Configuration::command) && action.compare(Configuration::depth_command)) {
+			AW_LOG("RtdServer::connect: action<" << action << "> not quote (unsupported)");
+			return false;
+		}
+		if (count < 3) {
+			AW_LOG("RtdServer::connect: no second parameter (symbol) and third (topic)");
+			return false;
+		}
+		const std::string& symbol = strings[1];
+		const std::string& topic = strings[2];
+		AW_LOG("RtdServer::connect: command<" << action << "> symbol<" << symbol << "> topic<" << topic << "> topic_id<" << topic_id << ">");
+
+		// optional 4th string, space separated: deadband of this cell and/or its refresh priority, parsed once per text
+		const Options* options = count >= 4 ? &parse_options(strings[3]) : nullptr;
+		int side(0), field(0);
+		size_t rank(0);
+		if (!action.compare(Configuration::depth_command) && !DepthTopics<Cell*>::parse(topic, side, field, rank)) {
+			AW_LOG("RtdServer::connect: topic<" << topic << "> is not a depth topic");
+			m_cache->text("#DEPTH unknown topic", out);
+			return true;
+		}
+		if (options && !options->m_bad.empty()) {
+			m_cache->text("#OPTION " + options->m_bad + " (2t, 0.05%, hot, normal or cold)", out);
+			return true;
+		}
+		m_connect.m_topic_id = topic_id;
+		m_connect.m_symbol.assign(symbol);
+		m_connect.m_topic.assign(topic);
+		m_connect.m_has_band = options && options->m_has_band;
+		m_connect.m_band = options ? options->m_band : Deadband();
+		m_connect.m_priority = options ? options->m_priority : RefreshQueue::NORMAL;
+		if (m_view.connect(m_connect, out))
+			return true; // live value, or last known one from the snapshot ("stale" topic of the symbol says which)
+		// none yet, or the cache was busy with the feed and took it later: the value comes with a RefreshData
+		m_cache->waiting(out);
+		return true;
+	}
+
+	// ConnectData straight from excel's array (every element a BSTR), no conversion beyond narrowing into strings
+	// this server reuses, same as connect() above
+	auto connect(LONG topic_id, const VARIANT* strings, size_t count, VARIANT* out) -> bool
+	{
+		if (m_args.size() < count)
+			m_args.resize(count);
+		for (size_t i = 0; i < count; i++)
+			narrow(strings[i], m_args[i]);
+		return connect(topic_id, m_args.data(), count, out);
+	}
+
+	// RefreshData, everything changed from here on needs another UpdateNotify, returns the values in batch
+	auto refresh(RefreshBatch& batch) -> size_t
+	{
+		uint64_t entered = steady_mks();
+		m_view.pacer().pulled(entered);
+		Configuration::instance().incrementRefresh();
+		// values the feed side already staged (refreshbuffer.h) moved into a 2 x n array made at its final size (refreshbatch.h)
+		size_t count = m_view.get(batch);
+		uint64_t blocked = Configuration::instance().addRefreshBlocked(steady_mks() - entered);
+		AW_LOG("RtdServer::refresh: get: " << count << " blocked mks total: " << blocked);
+		return count;
+	}
+
+	// DisconnectData
+	auto disconnect(LONG topic_id) -> bool
+	{
+		if (m_view.remove(topic_id))
+			return true;
+		AW_LOG("RtdServer::disconnect: topic_id<" << topic_id << "> not connected");
+		return false;
+	}
+
+	// notifier thread until stop(): the notify event only says data changed, the pacer decides when excel hears about it
+	template<typename F>
+	auto notify_loop(F update_notify) -> void
+	{
+		aw::NotifyPacer& pacer(m_view.pacer());
+		uint64_t wait_us = 1000000;
+		uint64_t verbose_read = steady_mks();
+		uint64_t connects_seen = 0; // first wake with ConnectData queued, applied a burst later unless excel did it
+		while (!m_shutdown.is_set()) {
+			m_view.notify_event().wait((std::min<uint64_t>)(wait_us, connects_seen ? CONNECT_BURST_US : 1000000));
+			if (m_shutdown.is_set())
+				break;
+			uint64_t now = steady_mks();
+			if (!m_view.connects_queued())
+				connects_seen = 0;
+			else if (!connects_seen)
+				connects_seen = now;
+			else if (now - connects_seen >= CONNECT_BURST_US) {
+				m_cache->apply_connects(); // known values among them notify like a change
+				connects_seen = 0;
+			}
+			if (pacer.poll(now, wait_us)) {
+				m_view.stage(); // excel's RefreshData then only swaps the batch out
+				update_notify();
+				Configuration::instance().incrementNotify();
+			}
+			if (now - verbose_read >= 10000000) {
+				verbose_read = now;
+				Configuration::instance().readVerbose();
+			}
+		}
+		AW_LOG("RtdServer::notify_loop: shutdown");
+	}
+
+	// the process's cache, shared with every other instance
+	auto cache() -> DataCache& { return *m_cache; }
+	// this instance's TopicIDs and refreshes
+	auto view() -> DataCache::View& { return m_view; }
+
+	// NotifyPacer clock
+	static auto steady_mks() -> uint64_t
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+private:
+	// 4th ConnectData string, a workbook repeats a handful of them
+	struct Options
+	{
+		Deadband m_band;
+		bool m_has_band = false;
+		int m_priority = RefreshQueue::NORMAL;
+		std::string m_bad; // neither a deadband nor a priority
+	};
+
+	auto parse_options(const std::string& text) -> const Options&
+	{
+		auto it = m_options.find(text);
+		if (it != m_options.end())
+			return it->second;
+		Options& parsed(m_options[text]);
+		std::stringstream options(text);
+		std::string option;
+		while (options >> option) {
+			if (RefreshQueue::parse(option, parsed.m_priority))
+				continue;
+			parsed.m_has_band = Deadband::parse(option, Configuration::instance().getTickSize(), parsed.m_band);
+			if (!parsed.m_has_band) {
+				AW_LOG("RtdServer::connect: option<" << option << "> is neither a deadband nor a priority");
+				parsed.m_bad = option;
+			}
+		}
+		return parsed;
+	}
+
+	// BSTR into out, ascii (every action, symbol, topic and option) a char each, anything else as _bstr_t did (ansi
+	// code page, '?' off windows), a non string argument is empty
+	static auto narrow(const VARIANT& arg, std::string& out) -> void
+	{
+		out.clear();
+		if (arg.vt != VT_BSTR || !arg.bstrVal)
+			return;
+		const OLECHAR* text = arg.bstrVal;
+		size_t len = SysStringLen(arg.bstrVal);
+		size_t i = 0;
+		while (i < len && text[i] < 0x80)
+			i++;
+		if (i == len) {
+			out.assign(text, text + len);
+			return;
+		}
+#ifdef _WIN64
+		int size = WideCharToMultiByte(CP_ACP, 0, text, static_cast<int>(len), nullptr, 0, nullptr, nullptr);
+		out.resize(size > 0 ? size : 0);
+		if (size > 0)
+			WideCharToMultiByte(CP_ACP, 0, text, static_cast<int>(len), &out[0], size, nullptr, nullptr);
+#else
+		for (size_t j = 0; j < len; j++)
+			out.push_back(text[j] < 0x80 ? static_cast<char>(text[j]) : '?');
+#endif
+	}
+
+	static constexpr uint64_t CONNECT_BURST_US = 1000; // ConnectData queued behind the feed waits this long at most
+
+	std::shared_ptr<DataCache> m_cache = DataCache::shared(); // before m_view, which goes first
+	DataCache::View m_view{ *m_cache };
+	aw::Event m_shutdown{ true };
+	bool m_started = false;
+	std::vector<std::string> m_args; // ConnectData's strings, reused
+	DataCache::Connect m_connect;
+	std::unordered_map<std::string, Options> m_options; // parsed 4th strings
+};
@@ -0,0 +1,201 @@
+// snapshot.h
+// last values of every subscribed cell in a memory mapped hash table, so ConnectData after a restart
+// returns the last known value right away instead of "WAITING"
+// two files, <path>.0 and <path>.1, each a 64 byte header then an open addressing table of 64 byte entries,
+// the one with the higher generation wins on load: loading is mapping it, lookups probe the mapping, no parse
+// a checkpoint writes the other file (magic last) and only then switches, a crash mid checkpoint keeps the old one
+// numeric values only (VT_R8, VT_I8, VT_I4), topics up to 14 chars, entries not refreshed for KEEP_MKS are dropped
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../aw/mmap.h"
+
+class Snapshot
+{
+public:
+	static constexpr char MAGIC[8] = { 'A', 'W', 'S', 'N', 'A', 'P', '1', 0 };
+	static constexpr size_t SYMBOL_SIZE = 24;
+	static constexpr size_t TOPIC_SIZE = 14;
+	static constexpr uint64_t MIN_CAPACITY = 1024;
+	static constexpr uint64_t KEEP_MKS = 7ull * 86400 * 1000000; // a week, sheets not opened since are forgotten
+
+	struct Entry
+	{
+		uint64_t m_hash; // 0: empty slot
+		char m_symbol[SYMBOL_SIZE]; // not 0 terminated when full, same as the feed
+		char m_topic[TOPIC_SIZE];
+		uint16_t m_vt;
+		int64_t m_bits; // double bits for VT_R8
+		uint64_t m_mks; // feed time of the symbol when checkpointed
+	};
+	static_assert(sizeof(Entry) == 64, "snapshot entry is 64 bytes");
+
+	struct Header
+	{
+		char m_magic[8];
+		uint64_t m_generation;
+		uint64_t m_capacity; // power of 2
+		uint64_t m_count;
+		uint64_t m_written_mks; // wall clock of the checkpoint
+		char m_filler[24];
+	};
+	static_assert(sizeof(Header) == 64, "snapshot header is 64 bytes");
+
+	// empty path: disabled
+	Snapshot(const std::string& path) : m_path(path)
+	{
+		if (m_path.empty())
+			return;
+		for (int i = 0; i < 2; i++) {
+			aw::MappedFile file;
+			if (!file.open(file_name(i), 0) || !valid(file))
+				continue;
+			if (!m_file.is_open() || header(file)->m_generation > header(m_file)->m_generation) {
+				m_file = std::move(file);
+				m_current = i;
+			}
+		}
+	}
+
+	auto enabled() const -> bool { return !m_path.empty(); }
+	auto entries() const -> uint64_t { return m_file.is_open() ? header(m_file)->m_count : 0; }
+	auto generation() const -> uint64_t { return m_file.is_open() ? header(m_file)->m_generation : 0; }
+
+	// false if var isn't worth keeping (not numeric) or symbol/topic don't fit
+	static auto make(const std::string& symbol, const std::string& topic, const VARIANT& var, uint64_t mks, Entry& entry) -> bool
+	{
+		if (symbol.empty() || symbol.size() > SYMBOL_SIZE || topic.empty() || topic.size() > TOPIC_SIZE)
+			return false;
+		switch (var.vt) {
+		case VT_R8: memcpy(&entry.m_bits, &var.dblVal, sizeof(entry.m_bits)); break;
+		case VT_I8: entry.m_bits = var.llVal; break;
+		case VT_I4: entry.m_bits = var.lVal; break;
+		default: return false;
+		}
+		entry.m_hash = hash(symbol, topic);
+		memset(entry.m_symbol, 0, sizeof(entry.m_symbol));
+		memcpy(entry.m_symbol, symbol.data(), symbol.size());
+		memset(entry.m_topic, 0, sizeof(entry.m_topic));
+		memcpy(entry.m_topic, topic.data(), topic.size());
+		entry.m_vt = var.vt;
+		entry.m_mks = mks;
+		return true;
+	}
+
+	// var is set (caller clears it), mks is the feed time it was current at
+	auto find(const std::string& symbol, const std::string& topic, VARIANT& var, uint64_t& mks) const -> bool
+	{
+		if (!m_file.is_open() || symbol.size() > SYMBOL_SIZE || topic.size() > TOPIC_SIZE)
+			return false;
+		const Header* h = header(m_file);
+		const Entry* e = probe(table(m_file), h->m_capacity, hash(symbol, topic), symbol.data(), symbol.size(), topic.data(), topic.size());
+		if (e->m_hash == 0)
+			return false;
+		VariantInit(&var);
+		var.vt = e->m_vt;
+		switch (e->m_vt) {
+		case VT_R8: memcpy(&var.dblVal, &e->m_bits, sizeof(var.dblVal)); break;
+		case VT_I8: var.llVal = e->m_bits; break;
+		default: var.lVal = static_cast<LONG>(e->m_bits); break;
+		}
+		mks = e->m_mks;
+		return true;
+	}
+
+	// checkpoint, step 1 (no lock needed, only reads the current file): current entries first,
+	// then entries of the current file nobody subscribes to now (sheet not opened yet) unless too old
+	auto build(const std::vector<Entry>& current, uint64_t now_mks, aw::MappedFile& out) const -> bool
+	{
+		uint64_t bound = current.size() + entries();
+		uint64_t capacity = MIN_CAPACITY;
+		while (capacity * 3 < bound * 4) // load <= 0.75
+			capacity *= 2;
+		if (!out.open(file_name(m_current ^ 1), sizeof(Header) + capacity * sizeof(Entry)))
+			return false;
+		Header* h = header(out);
+		memset(h->m_magic, 0, sizeof(h->m_magic)); // invalid until done
+		Entry* slots = table(out);
+		memset(slots, 0, capacity * sizeof(Entry));
+		uint64_t count = 0;
+		auto insert = [&](const Entry& e) {
+			Entry* slot = probe(slots, capacity, e.m_hash, e.m_symbol, length(e.m_symbol, SYMBOL_SIZE), e.m_topic, length(e.m_topic, TOPIC_SIZE));
+			if (slot->m_hash != 0)
+				return;
+			*slot = e;
+			count++;
+		};
+		for (const Entry& e : current)
+			insert(e);
+		if (m_file.is_open()) {
+			const Header* old = header(m_file);
+			const Entry* old_slots = table(m_file);
+			for (uint64_t i = 0; i < old->m_capacity; i++) {
+				if (old_slots[i].m_hash != 0 && old_slots[i].m_mks + KEEP_MKS >= now_mks)
+					insert(old_slots[i]);
+			}
+		}
+		h->m_generation = generation() + 1;
+		h->m_capacity = capacity;
+		h->m_count = count;
+		h->m_written_mks = now_mks;
+		memcpy(h->m_magic, MAGIC, sizeof(MAGIC));
+		out.flush();
+		return true;
+	}
+	// step 2, under the lock find() runs under: lookups move to the new file, the old one is unmapped
+	auto swap(aw::MappedFile&& file) -> void
+	{
+		m_file = std::move(file);
+		m_current ^= 1;
+	}
+
+private:
+	// fnv-1a over symbol, a 0, topic
+	static auto hash(const char* symbol, size_t symbol_size, const char* topic, size_t topic_size) -> uint64_t
+	{
+		uint64_t h = 14695981039346656037ull;
+		for (size_t i = 0; i < symbol_size; i++)
+			h = (h ^ static_cast<unsigned char>(symbol[i])) * 1099511628211ull;
+		h *= 1099511628211ull;
+		for (size_t i = 0; i < topic_size; i++)
+			h = (h ^ static_cast<unsigned char>(topic[i])) * 1099511628211ull;
+		return h ? h : 1;
+	}
+	static auto hash(const std::string& symbol, const std::string& topic) -> uint64_t { return hash(symbol.data(), symbol.size(), topic.data(), topic.size()); }
+	static auto length(const char* s, size_t size) -> size_t { return strnlen(s, size); }
+
+	// slot holding symbol/topic, or the empty slot it would go to
+	template<typename E>
+	static auto probe(E* slots, uint64_t capacity, uint64_t h, const char* symbol, size_t symbol_size, const char* topic, size_t topic_size) -> E*
+	{
+		for (uint64_t i = h & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+			E* e = &slots[i];
+			if (e->m_hash == 0)
+				return e;
+			if (e->m_hash == h && length(e->m_symbol, SYMBOL_SIZE) == symbol_size && memcmp(e->m_symbol, symbol, symbol_size) == 0 &&
+				length(e->m_topic, TOPIC_SIZE) == topic_size && memcmp(e->m_topic, topic, topic_size) == 0)
+				return e;
+		}
+	}
+
+	static auto header(const aw::MappedFile& file) -> Header* { return reinterpret_cast<Header*>(file.data()); }
+	static auto table(const aw::MappedFile& file) -> Entry* { return reinterpret_cast<Entry*>(file.data() + sizeof(Header)); }
+	static auto valid(const aw::MappedFile& file) -> bool
+	{
+		if (file.size() < sizeof(Header))
+			return false;
+		const Header* h = header(file);
+		return memcmp(h->m_magic, MAGIC, sizeof(MAGIC)) == 0 && h->m_capacity >= MIN_CAPACITY && (h->m_capacity & (h->m_capacity - 1)) == 0 &&
+			h->m_count < h->m_capacity && file.size() >= sizeof(Header) + h->m_capacity * sizeof(Entry);
+	}
+	auto file_name(int i) const -> std::string { return m_path + "." + std::to_string(i); }
+
+	std::string m_path;
+	aw::MappedFile m_file; // current snapshot, lookups only
+	int m_current = 1; // index of m_file, first checkpoint writes .0
+};
@@ -0,0 +1,145 @@
+// stringpool.h
+// text values interned: one BSTR per distinct text, shared by every cell showing it and refcounted, so "tms" cells
+// of symbols ticking in the same microsecond, status strings and the like are made once
+// an entry nobody uses is kept for the next one asking for that text, up to max_idle of them, past that the oldest
+// idle entry is reused for the new text: its BSTR is rewritten in place when the length matches (every "tms" text)
+// and its index node is moved to the new key, so a steady stream of new texts allocates nothing
+// the pool owns its BSTRs, excel frees whatever it gets, so what goes out is copy()'s fresh one
+// not thread safe, DataCache uses it under its lock
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+
+class StringPool
+{
+public:
+	struct Entry
+	{
+		std::string m_text;
+		BSTR m_bstr = nullptr;
+		uint32_t m_refs = 0;
+		Entry* m_prev = nullptr; // idle list, oldest first
+		Entry* m_next = nullptr;
+	};
+
+	StringPool(size_t max_idle = 1024) : m_max_idle(max_idle) {}
+	StringPool(const StringPool&) = delete;
+	StringPool& operator=(const StringPool&) = delete;
+	~StringPool()
+	{
+		for (Entry& e : m_entries)
+			SysFreeString(e.m_bstr);
+	}
+
+	// entry of text with one reference more, nullptr if out of memory
+	auto intern(const char* text, size_t len) -> Entry*
+	{
+		auto it = m_index.find(std::string_view(text, len));
+		if (it != m_index.end()) {
+			Entry* e = it->second;
+			if (e->m_refs++ == 0)
+				unlink(e);
+			m_hits++;
+			return e;
+		}
+		Entry* e = nullptr;
+		if (m_idle >= m_max_idle && m_oldest) {
+			e = m_oldest;
+			unlink(e);
+			auto node = m_index.extract(std::string_view(e->m_text)); // no allocation, the node gets the new key
+			if (!assign(*e, text, len)) {
+				m_index.insert(std::move(node)); // still holds its old text
+				link(e);
+				return nullptr;
+			}
+			node.key() = std::string_view(e->m_text);
+			m_index.insert(std::move(node));
+			m_recycled++;
+		}
+		else {
+			m_entries.emplace_back();
+			e = &m_entries.back();
+			if (!assign(*e, text, len)) {
+				m_entries.pop_back();
+				return nullptr;
+			}
+			m_index.emplace(std::string_view(e->m_text), e);
+		}
+		e->m_refs = 1;
+		return e;
+	}
+
+	// reference dropped, the entry stays as long as max_idle allows
+	auto release(Entry* e) -> void
+	{
+		if (--e->m_refs == 0)
+			link(e);
+	}
+
+	// fresh BSTR of the entry's text for excel (it frees it), false if out of memory
+	static auto copy(const Entry* e, VARIANT& out) -> bool
+	{
+		VariantInit(&out);
+		out.bstrVal = SysAllocStringLen(e->m_bstr, SysStringLen(e->m_bstr));
+		if (!out.bstrVal)
+			return false;
+		out.vt = VT_BSTR;
+		return true;
+	}
+
+	auto size() const -> size_t { return m_entries.size(); }
+	auto live() const -> size_t { return m_entries.size() - m_idle; }
+	auto idle() const -> size_t { return m_idle; }
+	auto hits() const -> uint64_t { return m_hits; }
+	auto recycled() const -> uint64_t { return m_recycled; }
+	auto allocations() const -> uint64_t { return m_allocations; } // BSTRs made, the rest were reused
+
+private:
+	auto assign(Entry& e, const char* text, size_t len) -> bool
+	{
+		if (!e.m_bstr || SysStringLen(e.m_bstr) != len) {
+			BSTR bstr = SysAllocStringLen(NULL, static_cast<UINT>(len));
+			if (!bstr)
+				return false;
+			SysFreeString(e.m_bstr);
+			e.m_bstr = bstr;
+			m_allocations++;
+		}
+		for (size_t i = 0; i < len; i++)
+			e.m_bstr[i] = static_cast<OLECHAR>(text[i]);
+		e.m_text.assign(text, len); // keeps its capacity
+		return true;
+	}
+
+	auto link(Entry* e) -> void
+	{
+		e->m_prev = m_newest;
+		e->m_next = nullptr;
+		(m_newest ? m_newest->m_next : m_oldest) = e;
+		m_newest = e;
+		m_idle++;
+	}
+	auto unlink(Entry* e) -> void
+	{
+		(e->m_prev ? e->m_prev->m_next : m_oldest) = e->m_next;
+		(e->m_next ? e->m_next->m_prev : m_newest) = e->m_prev;
+		e->m_prev = e->m_next = nullptr;
+		m_idle--;
+	}
+
+	std::deque<Entry> m_entries; // never moves them, grows only
+	std::unordered_map<std::string_view, Entry*> m_index; // keys point into m_text
+	size_t m_max_idle;
+	size_t m_idle = 0;
+	Entry* m_oldest = nullptr;
+	Entry* m_newest = nullptr;
+	uint64_t m_hits = 0;
+	uint64_t m_recycled = 0;
+	uint64_t m_allocations = 0;
+};
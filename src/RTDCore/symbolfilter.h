@@ -0,0 +1,212 @@
+// symbolfilter.h
+// ingest side pre-filter: is this 24 byte EnhancedUDPData::m_symbol subscribed by anyone?
+// SymbolTable: bloom filter in front of a flat open addressing hash of fixed size keys
+//	one writer (excel side, under DataCache lock) inserts, one reader (feed thread) probes without lock
+//	slots are published with a release store of their hash and never modified afterwards
+// SubscriptionFilter: RCU wrapper, a grown or compacted table is swapped in atomically
+//	and the old one is freed once the feed thread went through a quiescent point (finished a packet)
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+namespace symbol_filter
+{
+	constexpr size_t SYMBOL_SIZE = 24; // same as EnhancedUDPData::m_symbol
+
+	// symbol as three words, zero padded after the terminating NUL (sender may leave garbage there)
+	struct SymbolKey
+	{
+		SymbolKey(const char* symbol, size_t len)
+		{
+			memset(m_words, 0, sizeof(m_words));
+			memcpy(m_words, symbol, len);
+		}
+		// raw 24 byte field
+		explicit SymbolKey(const char* raw) : SymbolKey(raw, strnlen(raw, SYMBOL_SIZE))
+		{}
+
+		auto hash() const -> uint64_t
+		{
+			uint64_t h = m_words[0] * 0x9E3779B97F4A7C15ull;
+			h ^= rotl(m_words[1] * 0xC2B2AE3D27D4EB4Full, 21);
+			h ^= rotl(m_words[2] * 0x165667B19E3779F9ull, 42);
+			h ^= h >> 29;
+			return h ? h : 1; // 0 marks an empty slot
+		}
+		auto operator==(const SymbolKey& rhs) const -> bool
+		{
+			return m_words[0] == rhs.m_words[0] && m_words[1] == rhs.m_words[1] && m_words[2] == rhs.m_words[2];
+		}
+
+		uint64_t m_words[SYMBOL_SIZE / sizeof(uint64_t)];
+
+	private:
+		static auto rotl(uint64_t x, int r) -> uint64_t { return (x << r) | (x >> (64 - r)); }
+	};
+
+	class SymbolTable
+	{
+	public:
+		// slots must be power of two, table is full at half load
+		explicit SymbolTable(size_t slots)
+			: m_mask(slots - 1), m_slots(new Slot[slots]), m_bloom_mask(slots * 8 - 1), m_bloom(new std::atomic<uint64_t>[slots / 8])
+		{
+			for (size_t i = 0; i < slots / 8; i++)
+				m_bloom[i].store(0, std::memory_order_relaxed);
+		}
+
+		// feed thread, raw 24 byte symbol
+		auto contains(const char* raw) const -> bool
+		{
+			SymbolKey key(raw);
+			uint64_t h = key.hash();
+			if (!bloom(h))
+				return false; // most unwatched symbols end here
+			for (size_t i = h & m_mask;; i = (i + 1) & m_mask) {
+				uint64_t slot_hash = m_slots[i].m_hash.load(std::memory_order_acquire);
+				if (slot_hash == 0)
+					return false;
+				if (slot_hash == h && m_slots[i].m_key == key)
+					return true;
+			}
+		}
+
+		// excel side, false if symbol already there or table is full (caller grows)
+		auto insert(const std::string& symbol) -> bool
+		{
+			if (full() || symbol.size() > SYMBOL_SIZE)
+				return false;
+			SymbolKey key(symbol.c_str(), symbol.size());
+			uint64_t h = key.hash();
+			size_t i = h & m_mask;
+			for (;; i = (i + 1) & m_mask) {
+				uint64_t slot_hash = m_slots[i].m_hash.load(std::memory_order_relaxed);
+				if (slot_hash == 0)
+					break;
+				if (slot_hash == h && m_slots[i].m_key == key)
+					return false;
+			}
+			m_bloom[(h & m_bloom_mask) >> 6].fetch_or(1ull << (h & 63), std::memory_order_relaxed);
+			uint64_t h2 = h >> 32;
+			m_bloom[(h2 & m_bloom_mask) >> 6].fetch_or(1ull << (h2 & 63), std::memory_order_relaxed);
+			m_slots[i].m_key = key;
+			m_slots[i].m_hash.store(h, std::memory_order_release); // publish, reader sees key after this
+			m_entries++;
+			return true;
+		}
+
+		auto full() const -> bool { return (m_entries + 1) * 2 > m_mask + 1; }
+		auto entries() const -> size_t { return m_entries; }
+		auto slots() const -> size_t { return m_mask + 1; }
+
+	private:
+		struct Slot
+		{
+			std::atomic<uint64_t> m_hash = 0;
+			SymbolKey m_key = SymbolKey("", 0);
+		};
+
+		// two bits out of one hash, 16 bits per symbol at full load
+		auto bloom(uint64_t h) const -> bool
+		{
+			uint64_t h2 = h >> 32;
+			return (m_bloom[(h & m_bloom_mask) >> 6].load(std::memory_order_relaxed) & (1ull << (h & 63))) &&
+				(m_bloom[(h2 & m_bloom_mask) >> 6].load(std::memory_order_relaxed) & (1ull << (h2 & 63)));
+		}
+
+		size_t m_mask;
+		std::unique_ptr<Slot[]> m_slots;
+		size_t m_bloom_mask; // in bits
+		std::unique_ptr<std::atomic<uint64_t>[]> m_bloom;
+		size_t m_entries = 0;
+	};
+}
+
+class SubscriptionFilter
+{
+public:
+	static constexpr size_t MIN_SLOTS = 1024;
+
+	SubscriptionFilter() : m_table(new symbol_filter::SymbolTable(MIN_SLOTS)) {}
+	~SubscriptionFilter()
+	{
+		delete m_table.load();
+		for (auto& it : m_retired)
+			delete it.second;
+	}
+
+	// feed thread: probe, then quiescent() once done with the packet
+	auto contains(const char* raw) const -> bool
+	{
+		return m_table.load(std::memory_order_acquire)->contains(raw);
+	}
+	auto quiescent() -> void
+	{
+		m_reader_seq.fetch_add(1);
+	}
+
+	// excel side, symbols is the subscribed symbol map (only keys are used) and already has symbol in it
+	template<typename Map>
+	auto insert(const std::string& symbol, const Map& symbols) -> void
+	{
+		auto* table = m_table.load(std::memory_order_relaxed);
+		if (table->insert(symbol))
+			return;
+		if (table->full())
+			rebuild(symbols);
+	}
+	// excel side, stale entries only cost a false positive (packet goes to the locked lookup and is dropped there)
+	// compact once more than half the table is stale
+	template<typename Map>
+	auto erase(const Map& symbols) -> void
+	{
+		m_stale++;
+		if (m_stale > symbols.size() && m_stale > MIN_SLOTS / 4)
+			rebuild(symbols);
+	}
+
+	template<typename Map>
+	auto rebuild(const Map& symbols) -> void
+	{
+		size_t slots = MIN_SLOTS;
+		while ((symbols.size() + 1) * 4 > slots) // half load right after build leaves room to grow
+			slots *= 2;
+		auto* table = new symbol_filter::SymbolTable(slots);
+		for (const auto& it : symbols)
+			table->insert(it.first);
+		auto* old = m_table.exchange(table);
+		m_retired.push_back(std::make_pair(m_reader_seq.load(), old));
+		m_stale = 0;
+		m_rebuilds++;
+		reclaim();
+	}
+
+	auto rebuilds() const -> uint64_t { return m_rebuilds; }
+
+private:
+	// old table is safe to free once the feed thread finished the packet it was on when we swapped
+	auto reclaim() -> void
+	{
+		uint64_t seq = m_reader_seq.load();
+		size_t kept = 0;
+		for (auto& it : m_retired) {
+			if (it.first < seq)
+				delete it.second;
+			else
+				m_retired[kept++] = it;
+		}
+		m_retired.resize(kept);
+	}
+
+	std::atomic<symbol_filter::SymbolTable*> m_table;
+	std::atomic<uint64_t> m_reader_seq = 0; // packets the feed thread finished
+	std::vector<std::pair<uint64_t, symbol_filter::SymbolTable*>> m_retired;
+	size_t m_stale = 0;
+	uint64_t m_rebuilds = 0;
+};
@@ -0,0 +1,358 @@
+// tickstore.h
+// append only tick history per symbol in memory mapped column files, survives restarts
+// file per segment: <dir>/<symbol>.<seq>.tick, header then columns mks[capacity], value[capacity], topic[capacity]
+// TickLog: appends are plain stores into the mapping (no syscall per tick), a full segment rolls to the next,
+//	capacity doubles per segment (4k rows up to 1M) so a quiet symbol costs a few pages, a busy one few files
+//	rows are visible once m_count is stored (release), so a reader in another process never sees a half row
+//	mks is clamped to the last stored so every column is sorted by time: a binary search is the time index
+// HistoryTopics: "bid@10:00" value at or before that time of day (UTC, feed day), "bid#2" second most recent bid
+// one writer per directory, two servers on the same TickStoreDir would interleave rows
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+
+#include "../aw/mmap.h"
+
+class TickLog
+{
+public:
+	static constexpr uint64_t MIN_ROWS = 4096;
+	static constexpr uint64_t MAX_ROWS = 1 << 20;
+	static constexpr char MAGIC[8] = { 'A', 'W', 'T', 'I', 'C', 'K', '1', 0 };
+
+	struct Header
+	{
+		char m_magic[8];
+		uint64_t m_capacity;
+		std::atomic<uint64_t> m_count; // rows below are complete
+		uint64_t m_first_mks;
+		uint64_t m_last_mks;
+		char m_filler[24]; // columns start on a cache line
+	};
+	static_assert(sizeof(Header) == 64, "segment header is 64 bytes");
+
+	// read only view of one segment, columns point into the mapping
+	struct Segment
+	{
+		const uint64_t* m_mks;
+		const double* m_value;
+		const uint32_t* m_topic;
+		uint64_t m_count;
+	};
+
+	// topics are the 3 char feed topics, packed in a column as uint32
+	static auto code(const std::string& topic) -> uint32_t
+	{
+		uint32_t c = 0;
+		memcpy(&c, topic.data(), (std::min)(topic.size(), sizeof(c)));
+		return c;
+	}
+
+	TickLog(const std::string& path) : m_path(path)
+	{
+		// reopen what an earlier run left, stops at the first missing or foreign file
+		while (true) {
+			aw::MappedFile file;
+			if (!file.open(file_name(m_files.size()), 0) || file.size() < sizeof(Header))
+				break;
+			const Header* h = reinterpret_cast<const Header*>(file.data());
+			if (memcmp(h->m_magic, MAGIC, sizeof(MAGIC)) != 0 || file.size() < bytes(h->m_capacity) || h->m_count.load() > h->m_capacity)
+				break;
+			m_files.push_back(std::move(file));
+		}
+		if (!m_files.empty())
+			m_last_mks = header(m_files.size() - 1)->m_last_mks;
+	}
+
+	// false if the next segment can't be created (disk full, bad dir), row is dropped
+	auto append(uint64_t mks, uint32_t topic, double value) -> bool
+	{
+		Header* h = m_files.empty() ? nullptr : header(m_files.size() - 1);
+		if (!h || h->m_count.load(std::memory_order_relaxed) == h->m_capacity) {
+			if (!roll())
+				return false;
+			h = header(m_files.size() - 1);
+		}
+		uint64_t n = h->m_count.load(std::memory_order_relaxed);
+		mks = (std::max)(mks, m_last_mks);
+		char* base = m_files.back().data();
+		reinterpret_cast<uint64_t*>(base + sizeof(Header))[n] = mks;
+		reinterpret_cast<double*>(base + sizeof(Header) + h->m_capacity * sizeof(uint64_t))[n] = value;
+		reinterpret_cast<uint32_t*>(base + sizeof(Header) + h->m_capacity * (sizeof(uint64_t) + sizeof(double)))[n] = topic;
+		if (n == 0)
+			h->m_first_mks = mks;
+		h->m_last_mks = mks;
+		m_last_mks = mks;
+		h->m_count.store(n + 1, std::memory_order_release);
+		return true;
+	}
+
+	auto segments() const -> size_t { return m_files.size(); }
+	auto segment(size_t i) const -> Segment
+	{
+		const char* base = m_files[i].data();
+		const Header* h = reinterpret_cast<const Header*>(base);
+		return Segment{
+			reinterpret_cast<const uint64_t*>(base + sizeof(Header)),
+			reinterpret_cast<const double*>(base + sizeof(Header) + h->m_capacity * sizeof(uint64_t)),
+			reinterpret_cast<const uint32_t*>(base + sizeof(Header) + h->m_capacity * (sizeof(uint64_t) + sizeof(double))),
+			h->m_count.load(std::memory_order_acquire) };
+	}
+	auto rows() const -> uint64_t
+	{
+		uint64_t count = 0;
+		for (size_t i = 0; i < m_files.size(); i++)
+			count += segment(i).m_count;
+		return count;
+	}
+	auto last_mks() const -> uint64_t { return m_last_mks; }
+
+	// last value of topic stored at or before mks and not before from
+	auto at(uint32_t topic, uint64_t mks, uint64_t from, double& value) const -> bool
+	{
+		for (size_t i = m_files.size(); i-- > 0;) {
+			Segment s(segment(i));
+			if (s.m_count == 0 || s.m_mks[0] > mks)
+				continue;
+			if (s.m_mks[s.m_count - 1] < from)
+				return false;
+			size_t row = std::upper_bound(s.m_mks, s.m_mks + s.m_count, mks) - s.m_mks;
+			while (row-- > 0) {
+				if (s.m_mks[row] < from)
+					return false;
+				if (s.m_topic[row] == topic) {
+					value = s.m_value[row];
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+	// n = 1 is the latest value of topic
+	auto back(uint32_t topic, size_t n, double& value) const -> bool
+	{
+		for (size_t i = m_files.size(); i-- > 0;) {
+			Segment s(segment(i));
+			for (uint64_t row = s.m_count; row-- > 0;) {
+				if (s.m_topic[row] == topic && --n == 0) {
+					value = s.m_value[row];
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+	// f(mks, topic, value) for rows in [from, to], oldest first
+	template<typename F>
+	auto visit(uint64_t from, uint64_t to, F f) const -> void
+	{
+		for (size_t i = 0; i < m_files.size(); i++) {
+			Segment s(segment(i));
+			if (s.m_count == 0 || s.m_mks[s.m_count - 1] < from)
+				continue;
+			if (s.m_mks[0] > to)
+				return;
+			for (size_t row = std::lower_bound(s.m_mks, s.m_mks + s.m_count, from) - s.m_mks; row < s.m_count && s.m_mks[row] <= to; row++)
+				f(s.m_mks[row], s.m_topic[row], s.m_value[row]);
+		}
+	}
+
+private:
+	static auto bytes(uint64_t capacity) -> size_t { return sizeof(Header) + capacity * (sizeof(uint64_t) + sizeof(double) + sizeof(uint32_t)); }
+	auto file_name(size_t seq) const -> std::string { return m_path + "." + std::to_string(seq) + ".tick"; }
+	auto header(size_t i) const -> Header* { return reinterpret_cast<Header*>(m_files[i].data()); }
+
+	auto roll() -> bool
+	{
+		if (!m_files.empty())
+			m_files.back().flush();
+		uint64_t capacity = (std::min)(MIN_ROWS << (std::min)(m_files.size(), static_cast<size_t>(8)), MAX_ROWS);
+		aw::MappedFile file;
+		if (!file.open(file_name(m_files.size()), bytes(capacity)))
+			return false;
+		Header* h = reinterpret_cast<Header*>(file.data());
+		h->m_capacity = capacity;
+		h->m_count.store(0, std::memory_order_relaxed);
+		h->m_first_mks = h->m_last_mks = 0;
+		memcpy(h->m_magic, MAGIC, sizeof(MAGIC)); // last, a torn file isn't picked up on restart
+		m_files.push_back(std::move(file));
+		return true;
+	}
+
+	std::string m_path; // dir + escaped symbol, segment files add .<seq>.tick
+	std::vector<aw::MappedFile> m_files; // oldest first, only the last one is written
+	uint64_t m_last_mks = 0;
+};
+
+// owns the logs of subscribed symbols, a symbol's log is unmapped when it is released, a later subscriber reopens its
+// segments (TickLog's constructor) and sees the history
+class TickStore
+{
+public:
+	// empty dir: no history kept
+	TickStore(const std::string& dir) : m_dir(dir)
+	{
+		if (!m_dir.empty() && m_dir.back() != '\\' && m_dir.back() != '/')
+			m_dir += '/';
+	}
+
+	auto enabled() const -> bool { return !m_dir.empty(); }
+	// nullptr if disabled
+	auto log(const std::string& symbol) -> TickLog*
+	{
+		if (!enabled())
+			return nullptr;
+		auto& log(m_logs[symbol]);
+		if (!log)
+			log = std::make_unique<TickLog>(m_dir + escape(symbol));
+		return log.get();
+	}
+	// symbol's TickLog* is gone, rows stay in its files
+	auto close(const std::string& symbol) -> void { m_logs.erase(symbol); }
+	auto logs() const -> size_t { return m_logs.size(); }
+	auto rows() const -> uint64_t { return m_rows; }
+	auto dropped() const -> uint64_t { return m_dropped; }
+	auto count(bool stored) -> void { (stored ? m_rows : m_dropped)++; }
+
+private:
+	// OCC symbols have spaces, some feeds use '/', anything but [A-Za-z0-9._-] becomes %XX
+	static auto escape(const std::string& symbol) -> std::string
+	{
+		static const char hex[] = "0123456789ABCDEF";
+		std::string name;
+		for (unsigned char c : symbol) {
+			if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-') {
+				name += static_cast<char>(c);
+			}
+			else {
+				name += '%';
+				name += hex[c >> 4];
+				name += hex[c & 15];
+			}
+		}
+		return name;
+	}
+
+	std::string m_dir;
+	std::unordered_map<std::string, std::unique_ptr<TickLog>> m_logs;
+	uint64_t m_rows = 0;
+	uint64_t m_dropped = 0;
+};
+
+// Handle identifies the subscriber (DataCache uses Cell*)
+template<typename Handle>
+class HistoryTopics
+{
+public:
+	enum Kind { AT, BACK };
+	static constexpr uint64_t DAY_MKS = 86400ull * 1000000;
+	static constexpr uint64_t MAX_BACK = 1000;
+
+	// <topic>@HH:MM[:SS] or <topic>#N, false if topic is neither
+	static auto parse(const std::string& topic, uint32_t& field, int& kind, uint64_t& arg) -> bool
+	{
+		size_t pos = topic.find_first_of("@#");
+		if (pos == std::string::npos || pos == 0 || pos + 1 == topic.size())
+			return false;
+		field = TickLog::code(topic.substr(0, pos));
+		kind = topic[pos] == '@' ? AT : BACK;
+		uint64_t parts[3] = {};
+		size_t num_parts = 1, digits = 0;
+		for (size_t i = pos + 1; i < topic.size(); i++) {
+			char c = topic[i];
+			if (c == ':' && kind == AT && digits && num_parts < 3) {
+				num_parts++;
+				digits = 0;
+			}
+			else if (c >= '0' && c <= '9' && digits < 4) {
+				parts[num_parts - 1] = parts[num_parts - 1] * 10 + (c - '0');
+				digits++;
+			}
+			else {
+				return false;
+			}
+		}
+		if (!digits)
+			return false;
+		if (kind == BACK) {
+			arg = parts[0];
+			return arg >= 1 && arg <= MAX_BACK;
+		}
+		if (num_parts < 2 || parts[0] > 23 || parts[1] > 59 || parts[2] > 59)
+			return false;
+		arg = ((parts[0] * 60 + parts[1]) * 60 + parts[2]) * 1000000;
+		return true;
+	}
+
+	auto subscribe(uint32_t field, int kind, uint64_t arg, Handle cell) -> void
+	{
+		Subscription s;
+		s.m_cell = cell;
+		s.m_field = field;
+		s.m_kind = kind;
+		s.m_arg = arg;
+		m_subscriptions.push_back(s);
+	}
+	auto unsubscribe(Handle cell) -> void
+	{
+		m_subscriptions.erase(std::remove_if(m_subscriptions.begin(), m_subscriptions.end(), [&](const Subscription& s) {
+			return s.m_cell == cell;
+		}), m_subscriptions.end());
+	}
+	auto subscribed() const -> bool { return !m_subscriptions.empty(); }
+
+	// after rows were appended (and on subscribe), publish(cell, value) for values that moved
+	// an "@" value is final once the log is past its time, until the feed day changes
+	template<typename Publish>
+	auto update(const TickLog& log, Publish publish) -> void
+	{
+		uint64_t latest = log.last_mks();
+		if (latest == 0)
+			return;
+		uint64_t day = latest - latest % DAY_MKS;
+		for (Subscription& s : m_subscriptions) {
+			double value = NAN;
+			bool found = false;
+			if (s.m_kind == AT) {
+				if (s.m_target != day + s.m_arg) {
+					s.m_target = day + s.m_arg;
+					s.m_final = false;
+				}
+				if (s.m_final)
+					continue;
+				found = log.at(s.m_field, s.m_target, day, value);
+				s.m_final = latest > s.m_target;
+			}
+			else {
+				found = log.back(s.m_field, static_cast<size_t>(s.m_arg), value);
+			}
+			if (!found || value == s.m_last)
+				continue;
+			s.m_last = value;
+			publish(s.m_cell, value);
+		}
+	}
+
+private:
+	struct Subscription
+	{
+		Handle m_cell = {};
+		uint32_t m_field = 0;
+		int m_kind = AT;
+		uint64_t m_arg = 0; // AT: mks from midnight, BACK: n
+		uint64_t m_target = 0; // AT: absolute mks in the current feed day
+		bool m_final = false;
+		double m_last = NAN;
+	};
+
+	std::vector<Subscription> m_subscriptions;
+};
@@ -31,4 +31,20 @@ struct EnhancedUDPData {
     Field m_fields[1]; // indeterminate number of fields (will be stored right after first one in sequential memory)
     // sizeof(EnhancedUDPData) may return incorrect size since it only accounts for first field (out of possibly more) 
 };
-#pragma pack()
\ No newline at end of file
+#pragma pack()
+// level 2 updates, sent on their own channel (Configuration DepthMulticastPort)
+#pragma pack(1)
+struct DepthUDPData {
+    struct Update {
+        uint8_t m_action; // OrderBook::Action, 1: add, 2: modify, 3: delete, 4: clear both sides (side/price/size ignored)
+        uint8_t m_side; // 0: bid, 1: ask
+        int64_t m_price; // scaled by SCALE
+        int64_t m_size;
+    };
+
+    char m_symbol[24];
+    uint64_t m_timestamp; // timestamp, microseconds from epoch
+    uint16_t m_num_updates; // applied in order
+    Update m_updates[1]; // indeterminate number of updates, same as EnhancedUDPData::m_fields
+};
+#pragma pack()
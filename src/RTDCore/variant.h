@@ -0,0 +1,207 @@
+// variant.h
+// the core's value type: oleaut32's VARIANT/SAFEARRAY on windows (what excel gets, no conversion on the way out),
+// elsewhere a stand-in with the same api, so the core, its tests and benchmarks build and run on linux
+// same layouts where it matters (24 byte VARIANT, length prefixed BSTR, first index of a SAFEARRAY varies fastest)
+// and the same work per call: SafeArrayPutElement locks, finds the element, clears it and deep copies into it
+
+#pragma once
+
+#ifdef _WIN64
+#include <comdef.h>
+#else
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef unsigned int UINT;
+typedef int32_t HRESULT;
+typedef uint16_t VARTYPE;
+typedef char16_t OLECHAR;
+typedef OLECHAR* BSTR;
+
+#define S_OK ((HRESULT)0)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define DISP_E_BADINDEX ((HRESULT)0x8002000B)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+enum { VT_EMPTY = 0, VT_I4 = 3, VT_R8 = 5, VT_BSTR = 8, VT_VARIANT = 12, VT_I8 = 20 };
+
+struct VARIANT
+{
+	VARTYPE vt;
+	uint16_t wReserved1, wReserved2, wReserved3;
+	union
+	{
+		LONG lVal;
+		int64_t llVal;
+		double dblVal;
+		BSTR bstrVal;
+		void* record[2]; // BRECORD, makes it 24 bytes like x64
+	};
+};
+
+struct SAFEARRAYBOUND
+{
+	ULONG cElements;
+	LONG lLbound;
+};
+
+struct SAFEARRAY
+{
+	uint16_t cDims;
+	uint16_t fFeatures;
+	ULONG cbElements;
+	ULONG cLocks;
+	void* pvData;
+	SAFEARRAYBOUND rgsabound[2]; // in SafeArrayCreate order here, 2 dimensions at most
+};
+
+// BSTRs made and freed so far, CacheStressTest checks leaks and BSTRs per value with them (oleaut32 has no such count)
+inline std::atomic<uint64_t> g_bstr_allocations{ 0 };
+inline std::atomic<uint64_t> g_bstr_frees{ 0 };
+
+inline auto SysAllocStringLen(const OLECHAR* s, UINT len) -> BSTR
+{
+	char* p = static_cast<char*>(malloc(sizeof(uint32_t) + (len + 1) * sizeof(OLECHAR)));
+	if (!p)
+		return nullptr;
+	g_bstr_allocations.fetch_add(1, std::memory_order_relaxed);
+	*reinterpret_cast<uint32_t*>(p) = len * sizeof(OLECHAR);
+	BSTR b = reinterpret_cast<BSTR>(p + sizeof(uint32_t));
+	if (s)
+		memcpy(b, s, len * sizeof(OLECHAR));
+	b[len] = 0;
+	return b;
+}
+inline auto SysStringLen(BSTR b) -> UINT { return b ? reinterpret_cast<uint32_t*>(b)[-1] / sizeof(OLECHAR) : 0; }
+inline auto SysFreeString(BSTR b) -> void
+{
+	if (b) {
+		g_bstr_frees.fetch_add(1, std::memory_order_relaxed);
+		free(reinterpret_cast<char*>(b) - sizeof(uint32_t));
+	}
+}
+
+inline auto VariantInit(VARIANT* v) -> void { v->vt = VT_EMPTY; }
+inline auto VariantClear(VARIANT* v) -> HRESULT
+{
+	if (v->vt == VT_BSTR)
+		SysFreeString(v->bstrVal);
+	v->vt = VT_EMPTY;
+	return S_OK;
+}
+inline auto VariantCopy(VARIANT* dst, const VARIANT* src) -> HRESULT
+{
+	if (dst == src)
+		return S_OK;
+	VariantClear(dst);
+	*dst = *src;
+	if (src->vt == VT_BSTR && src->bstrVal) {
+		dst->bstrVal = SysAllocStringLen(src->bstrVal, SysStringLen(src->bstrVal));
+		if (!dst->bstrVal) {
+			dst->vt = VT_EMPTY;
+			return E_OUTOFMEMORY;
+		}
+	}
+	return S_OK;
+}
+
+// VT_VARIANT arrays only
+inline auto SafeArrayCreate(VARTYPE, UINT dims, SAFEARRAYBOUND* bounds) -> SAFEARRAY*
+{
+	if (dims == 0 || dims > 2)
+		return nullptr;
+	size_t count = 1;
+	for (UINT i = 0; i < dims; i++)
+		count *= bounds[i].cElements;
+	SAFEARRAY* a = static_cast<SAFEARRAY*>(calloc(1, sizeof(SAFEARRAY)));
+	if (!a)
+		return nullptr;
+	a->cDims = static_cast<uint16_t>(dims);
+	a->cbElements = sizeof(VARIANT);
+	a->pvData = calloc(count ? count : 1, sizeof(VARIANT)); // all VT_EMPTY
+	if (!a->pvData) {
+		free(a);
+		return nullptr;
+	}
+	memcpy(a->rgsabound, bounds, dims * sizeof(SAFEARRAYBOUND));
+	return a;
+}
+inline auto SafeArrayElements(const SAFEARRAY* a) -> size_t
+{
+	size_t count = 1;
+	for (UINT i = 0; i < a->cDims; i++)
+		count *= a->rgsabound[i].cElements;
+	return count;
+}
+inline auto SafeArrayDestroy(SAFEARRAY* a) -> HRESULT
+{
+	if (!a)
+		return S_OK;
+	VARIANT* v = static_cast<VARIANT*>(a->pvData);
+	for (size_t i = 0, n = SafeArrayElements(a); i < n; i++)
+		VariantClear(&v[i]);
+	free(a->pvData);
+	free(a);
+	return S_OK;
+}
+inline auto SafeArrayLock(SAFEARRAY* a) -> HRESULT
+{
+	__atomic_add_fetch(&a->cLocks, 1, __ATOMIC_ACQ_REL);
+	return S_OK;
+}
+inline auto SafeArrayUnlock(SAFEARRAY* a) -> HRESULT
+{
+	__atomic_sub_fetch(&a->cLocks, 1, __ATOMIC_ACQ_REL);
+	return S_OK;
+}
+inline auto SafeArrayAccessData(SAFEARRAY* a, void** data) -> HRESULT
+{
+	SafeArrayLock(a);
+	*data = a->pvData;
+	return S_OK;
+}
+inline auto SafeArrayUnaccessData(SAFEARRAY* a) -> HRESULT { return SafeArrayUnlock(a); }
+// indices[0] is the first dimension of SafeArrayCreate's bounds, the one varying fastest
+inline auto SafeArrayPtrOfIndex(SAFEARRAY* a, LONG* indices, void** element) -> HRESULT
+{
+	size_t offset = 0, stride = 1;
+	for (UINT i = 0; i < a->cDims; i++) {
+		LONG index = indices[i] - a->rgsabound[i].lLbound;
+		if (index < 0 || static_cast<ULONG>(index) >= a->rgsabound[i].cElements)
+			return DISP_E_BADINDEX;
+		offset += index * stride;
+		stride *= a->rgsabound[i].cElements;
+	}
+	*element = static_cast<VARIANT*>(a->pvData) + offset;
+	return S_OK;
+}
+inline auto SafeArrayPutElement(SAFEARRAY* a, LONG* indices, void* value) -> HRESULT
+{
+	SafeArrayLock(a);
+	void* element = nullptr;
+	HRESULT hr = SafeArrayPtrOfIndex(a, indices, &element);
+	if (SUCCEEDED(hr))
+		hr = VariantCopy(static_cast<VARIANT*>(element), static_cast<const VARIANT*>(value));
+	SafeArrayUnlock(a);
+	return hr;
+}
+inline auto SafeArrayGetElement(SAFEARRAY* a, LONG* indices, void* value) -> HRESULT
+{
+	SafeArrayLock(a);
+	void* element = nullptr;
+	HRESULT hr = SafeArrayPtrOfIndex(a, indices, &element);
+	if (SUCCEEDED(hr)) {
+		VariantInit(static_cast<VARIANT*>(value));
+		hr = VariantCopy(static_cast<VARIANT*>(value), static_cast<const VARIANT*>(element));
+	}
+	SafeArrayUnlock(a);
+	return hr;
+}
+
+#endif
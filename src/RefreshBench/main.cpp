@@ -0,0 +1,150 @@
+// RefreshBench : RefreshData's output array, old way vs RefreshBatch, portable (linux: cmake target RefreshBench)
+// old: fresh vector of (topic id, value) pairs copied out of the cells, then SafeArrayCreate and two
+//	SafeArrayPutElement per cell (lock + deep copy each), then the vector's copies cleared
+// new: RefreshBatch, array created at its final size and filled through SafeArrayAccessData in one pass
+// 10k and 100k cells per refresh, 1% of them "tms" text (BSTR), the rest doubles; both arrays must hold the same values
+// times are building the array only, destroying it is excel's side and the same for both
+
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "../RTDCore/variant.h"
+#include "../RTDCore/refreshbatch.h"
+
+struct Source
+{
+	LONG m_topic_id;
+	VARIANT m_var;
+};
+
+auto makeSources(size_t count) -> std::vector<Source>
+{
+	std::vector<Source> sources(count);
+	const char* tms = "2024-01-02 09:30:00.123456";
+	for (size_t i = 0; i < count; i++) {
+		sources[i].m_topic_id = static_cast<LONG>(i * 3 + 1);
+		VariantInit(&sources[i].m_var);
+		if (i % 100 == 0) {
+			size_t len = strlen(tms);
+			sources[i].m_var.vt = VT_BSTR;
+			sources[i].m_var.bstrVal = SysAllocStringLen(NULL, static_cast<UINT>(len));
+			for (size_t c = 0; c < len; c++)
+				sources[i].m_var.bstrVal[c] = static_cast<OLECHAR>(tms[c]);
+		}
+		else {
+			sources[i].m_var.vt = VT_R8;
+			sources[i].m_var.dblVal = 100 + i * 0.01;
+		}
+	}
+	return sources;
+}
+
+// what RefreshData and DataCache::get did before RefreshBatch
+auto buildOld(const std::vector<Source>& sources, long* count) -> SAFEARRAY*
+{
+	std::vector<std::pair<VARIANT, VARIANT>> data;
+	for (const Source& s : sources) {
+		VARIANT topic_id;
+		VariantInit(&topic_id);
+		topic_id.vt = VT_I4;
+		topic_id.lVal = s.m_topic_id;
+		VARIANT value;
+		VariantInit(&value);
+		VariantCopy(&value, &s.m_var);
+		data.push_back(std::make_pair(topic_id, value));
+	}
+	*count = static_cast<long>(data.size());
+	SAFEARRAYBOUND bounds[2];
+	LONG index[2];
+	bounds[0].cElements = 2;
+	bounds[0].lLbound = 0;
+	bounds[1].cElements = *count;
+	bounds[1].lLbound = 0;
+	SAFEARRAY* array = SafeArrayCreate(VT_VARIANT, 2, bounds);
+	LONG i = 0;
+	for (const auto& it : data) {
+		index[0] = 0;
+		index[1] = i;
+		SafeArrayPutElement(array, index, (void*)(&(it.first)));
+		index[0] = 1;
+		index[1] = i;
+		SafeArrayPutElement(array, index, (void*)(&(it.second)));
+		i++;
+	}
+	for (auto& it : data)
+		VariantClear(&it.second);
+	return array;
+}
+
+auto buildNew(const std::vector<Source>& sources, long* count) -> SAFEARRAY*
+{
+	RefreshBatch batch;
+	if (!batch.start(sources.size()))
+		return nullptr;
+	for (const Source& s : sources)
+		batch.add(s.m_topic_id, s.m_var);
+	return batch.finish(count);
+}
+
+auto same(SAFEARRAY* a, SAFEARRAY* b, long count) -> bool
+{
+	for (LONG i = 0; i < count; i++) {
+		for (LONG j = 0; j < 2; j++) {
+			LONG index[2] = { j, i };
+			VARIANT va, vb;
+			if (FAILED(SafeArrayGetElement(a, index, &va)) || FAILED(SafeArrayGetElement(b, index, &vb)))
+				return false;
+			bool equal = va.vt == vb.vt;
+			if (equal && va.vt == VT_BSTR)
+				equal = SysStringLen(va.bstrVal) == SysStringLen(vb.bstrVal) && memcmp(va.bstrVal, vb.bstrVal, SysStringLen(va.bstrVal) * sizeof(OLECHAR)) == 0;
+			else if (equal)
+				equal = va.vt == VT_I4 ? va.lVal == vb.lVal : va.dblVal == vb.dblVal;
+			VariantClear(&va);
+			VariantClear(&vb);
+			if (!equal)
+				return false;
+		}
+	}
+	return true;
+}
+
+template<typename F>
+auto nsPerCell(const std::vector<Source>& sources, uint32_t rounds, F build) -> double
+{
+	int64_t ns = 0;
+	for (uint32_t r = 0; r < rounds; r++) {
+		long count = 0;
+		auto start = std::chrono::steady_clock::now();
+		SAFEARRAY* array = build(sources, &count);
+		ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		SafeArrayDestroy(array);
+	}
+	return static_cast<double>(ns) / rounds / sources.size();
+}
+
+int main()
+{
+	bool ok = true;
+	for (size_t cells : { 10000, 100000 }) {
+		std::vector<Source> sources(makeSources(cells));
+		long old_count = 0, new_count = 0;
+		SAFEARRAY* old_array = buildOld(sources, &old_count);
+		SAFEARRAY* new_array = buildNew(sources, &new_count);
+		bool equal = old_count == new_count && new_count == static_cast<long>(cells) && same(old_array, new_array, new_count);
+		SafeArrayDestroy(old_array);
+		SafeArrayDestroy(new_array);
+		uint32_t rounds = static_cast<uint32_t>(2000000 / cells);
+		double old_ns = nsPerCell(sources, rounds, buildOld);
+		double new_ns = nsPerCell(sources, rounds, buildNew);
+		std::cout << cells << " cells per refresh: old " << old_ns << " ns/cell (" << old_ns * cells / 1000 << " us), RefreshBatch " << new_ns
+			<< " ns/cell (" << new_ns * cells / 1000 << " us), " << old_ns / new_ns << "x, same values: " << (equal ? "yes" : "NO") << std::endl;
+		ok &= equal;
+		for (Source& s : sources)
+			VariantClear(&s.m_var);
+	}
+	std::cout << (ok ? "passed" : "FAILED") << std::endl;
+	return ok ? 0 : 1;
+}
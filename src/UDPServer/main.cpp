@@ -42,7 +42,7 @@ struct EnhancedListener : public aw::IUDPListener
 		}
 		std::string tms; // implement timestamp later
 		std::cout << "SYMBOL<" << symbol << "> topic_var: ";
-		for (int32_t i = 0; i < topic_var.size(); i++) {
+		for (size_t i = 0; i < topic_var.size(); i++) {
 			std::cout << "topic[" << i << "]<" << topic_var[i].first << "> var[" << i << "]<" << topic_var[i].second << ">";
 		}
 		std::cout << std::endl;
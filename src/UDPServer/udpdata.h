@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string.h>
+#include <algorithm>
+
 #include "../aw/datetime.h"
 
 constexpr double SCALE = 1000000000;
@@ -10,7 +13,7 @@ struct UDPData
     UDPData(const char* symbol, double price, double quantity, const std::chrono::system_clock::time_point& timestamp)
     {
         memset(m_symbol, 0, sizeof(m_symbol));
-        memcpy(&m_symbol, symbol, min(sizeof(m_symbol), strlen(symbol)));
+        memcpy(&m_symbol, symbol, (std::min)(sizeof(m_symbol), strlen(symbol)));
         m_price = static_cast<int64_t>(price * SCALE);
         m_quantity = static_cast<uint64_t>(quantity * SCALE);
         m_timestamp = std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count();
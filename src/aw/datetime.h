@@ -2,13 +2,17 @@
 // some date time related utility using chrono
 
 #pragma once
+#ifdef _MSC_VER
 #pragma warning(disable: 4996)
+#endif
 
 #include <chrono>
 #include <string>
 #include <ctime>
 #include <iomanip> // put_time for formatting
 #include <sstream>
+#include <cstring>
+#include <cstdint>
 
 namespace aw
 {
@@ -19,6 +23,38 @@ namespace aw
 		auto since_epoch = std::chrono::duration_cast<std::chrono::system_clock::duration>(mks_since_epoch);
 		return std::chrono::system_clock::time_point(since_epoch);
 	}
+
+	// same text as streaming a time_point ("%Y-%m-%d %H:%M:%S." + 6 digit microseconds) without stringstream
+	// date/second prefix is cached, so ticks within the same second only write the 6 digits
+	class TimestampFormatter
+	{
+	public:
+		static constexpr size_t SIZE = 26; // 2021-01-04 09:30:00.000123
+
+		// out must hold SIZE chars, not NUL terminated
+		auto format(uint64_t mks, char* out) -> size_t
+		{
+			uint64_t sec = mks / 1000000;
+			if (sec != m_sec) {
+				auto in_time_t = static_cast<std::time_t>(sec);
+				auto* timeinfo = std::localtime(&in_time_t);
+				std::strftime(m_prefix, sizeof(m_prefix), "%Y-%m-%d %H:%M:%S.", timeinfo);
+				m_sec = sec;
+			}
+			memcpy(out, m_prefix, PREFIX_SIZE);
+			uint32_t us = static_cast<uint32_t>(mks % 1000000);
+			for (size_t i = SIZE; i > PREFIX_SIZE; i--) {
+				out[i - 1] = static_cast<char>('0' + us % 10);
+				us /= 10;
+			}
+			return SIZE;
+		}
+
+	private:
+		static constexpr size_t PREFIX_SIZE = 20;
+		uint64_t m_sec = UINT64_MAX;
+		char m_prefix[PREFIX_SIZE + 1] = {};
+	};
 }
 
 // stream function allows std::cout << and any other streaming function to take this data type
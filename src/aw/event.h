@@ -0,0 +1,97 @@
+// event.h
+// cross platform event (windows and posix): set() wakes a waiter, auto reset ones wake one waiter and clear again,
+// manual reset ones stay set until reset()
+// windows: a kernel event, handle() still works with WaitForMultipleObjects, elsewhere a mutex and condition variable
+
+#pragma once
+
+#ifdef _WIN64
+#include <windows.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#endif
+
+#include <stdint.h>
+
+namespace aw
+{
+	class Event
+	{
+	public:
+		Event(bool manual_reset = false) : m_manual_reset(manual_reset)
+		{
+#ifdef _WIN64
+			m_handle = CreateEvent(NULL, manual_reset ? TRUE : FALSE, FALSE, NULL);
+#endif
+		}
+		Event(const Event&) = delete;
+		Event& operator=(const Event&) = delete;
+		~Event()
+		{
+#ifdef _WIN64
+			CloseHandle(m_handle);
+#endif
+		}
+
+		auto set() -> void
+		{
+#ifdef _WIN64
+			SetEvent(m_handle);
+#else
+			{
+				std::lock_guard<std::mutex> __(m_mutex);
+				m_set = true;
+			}
+			if (m_manual_reset)
+				m_cv.notify_all();
+			else
+				m_cv.notify_one();
+#endif
+		}
+
+		auto reset() -> void
+		{
+#ifdef _WIN64
+			ResetEvent(m_handle);
+#else
+			std::lock_guard<std::mutex> __(m_mutex);
+			m_set = false;
+#endif
+		}
+
+		// true if set within timeout_us (an auto reset event is cleared by it), false on timeout
+		auto wait(uint64_t timeout_us) -> bool
+		{
+#ifdef _WIN64
+			DWORD wait_ms = static_cast<DWORD>((timeout_us + 999) / 1000);
+			return WaitForSingleObject(m_handle, wait_ms) == WAIT_OBJECT_0;
+#else
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!m_cv.wait_for(lock, std::chrono::microseconds(timeout_us), [this]() { return m_set; }))
+				return false;
+			if (!m_manual_reset)
+				m_set = false;
+			return true;
+#endif
+		}
+
+		// set right now, without waiting (clears an auto reset event like wait() does)
+		auto is_set() -> bool { return wait(0); }
+
+#ifdef _WIN64
+		auto handle() -> HANDLE { return m_handle; }
+#endif
+
+	private:
+		bool m_manual_reset;
+#ifdef _WIN64
+		HANDLE m_handle;
+#else
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		bool m_set = false;
+#endif
+	};
+}
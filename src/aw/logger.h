@@ -18,6 +18,7 @@
 #include <fstream>
 #include <filesystem>
 #include <thread>
+#include <atomic>
 
 #include "datetime.h"
 
@@ -82,7 +83,7 @@ namespace aw {
 			virtual ~LogMsg() {} // destructor
 		};
 
-		template<typename size_t Size = 1024> // size must be power of two, checked by is_power_of_two struct
+		template<size_t Size = 1024> // size must be power of two, checked by is_power_of_two struct
 		class LoggerImpl
 		{
 		public:
@@ -279,7 +280,7 @@ namespace aw {
 		};
 	}
 
-	template<typename size_t Size = 1024>
+	template<size_t Size = 1024>
 	class Logger // logger class, only needs one of these for entire program
 	{
 	public:
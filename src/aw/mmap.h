@@ -0,0 +1,176 @@
+// mmap.h
+// cross platform memory mapped file (windows and posix), read/write shared mapping of a whole file
+// MappedFile: open() maps, the view outlives the file and mapping handles which are closed right away
+// pages are written back by the OS, a process crash loses nothing that was stored, flush() only matters for power loss
+// open_shared(): named shared memory instead of a file (posix shm_open, windows pagefile backed named mapping)
+
+#pragma once
+
+#ifdef _WIN64
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <algorithm>
+
+namespace aw
+{
+	class MappedFile
+	{
+	public:
+		MappedFile() {}
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept : m_data(other.m_data), m_size(other.m_size)
+		{
+			other.m_data = nullptr;
+			other.m_size = 0;
+		}
+		MappedFile& operator=(MappedFile&& other) noexcept
+		{
+			if (this != &other) {
+				close();
+				m_data = other.m_data;
+				m_size = other.m_size;
+				other.m_data = nullptr;
+				other.m_size = 0;
+			}
+			return *this;
+		}
+		~MappedFile() { close(); }
+
+		// size 0: existing file at its own size, false if missing or empty
+		// size > 0: file is created if missing and grown (zero filled) to at least size, content is kept
+		auto open(const std::string& path, size_t size) -> bool
+		{
+			close();
+#ifdef _WIN64
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, size ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER current;
+			if (!GetFileSizeEx(file, &current)) {
+				CloseHandle(file);
+				return false;
+			}
+			size_t length = (std::max)(static_cast<size_t>(current.QuadPart), size);
+			HANDLE mapping = length ? CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(length) >> 32), static_cast<DWORD>(length), NULL) : NULL;
+			CloseHandle(file); // mapping keeps the file open
+			if (mapping == NULL)
+				return false;
+			void* view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, length);
+			CloseHandle(mapping); // view keeps the mapping alive
+			if (view == NULL)
+				return false;
+#else
+			int fd = ::open(path.c_str(), O_RDWR | (size ? O_CREAT : 0), 0644);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0) {
+				::close(fd);
+				return false;
+			}
+			size_t length = static_cast<size_t>(st.st_size);
+			if (size > length) {
+				if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+					::close(fd);
+					return false;
+				}
+				length = size;
+			}
+			void* view = length ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+			::close(fd); // mapping keeps the file open
+			if (view == MAP_FAILED)
+				return false;
+#endif
+			m_data = static_cast<char*>(view);
+			m_size = length;
+			return true;
+		}
+
+		// size > 0: created if missing (read/write, grown to size), size 0: existing one mapped read only
+		// posix shm outlives its processes until remove_shared(), a windows one lives while any process maps it
+		auto open_shared(const std::string& name, size_t size) -> bool
+		{
+			close();
+#ifdef _WIN64
+			HANDLE mapping = size ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), name.c_str())
+				: OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+			if (mapping == NULL)
+				return false;
+			void* view = MapViewOfFile(mapping, size ? FILE_MAP_READ | FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+			if (view == NULL)
+				return false;
+			MEMORY_BASIC_INFORMATION info;
+			size_t length = VirtualQuery(view, &info, sizeof(info)) ? info.RegionSize : 0;
+#else
+			std::string path = name[0] == '/' ? name : "/" + name;
+			int fd = shm_open(path.c_str(), size ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size > static_cast<size_t>(st.st_size) && ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+				::close(fd);
+				return false;
+			}
+			size_t length = (std::max)(static_cast<size_t>(st.st_size), size);
+			void* view = length ? mmap(nullptr, length, size ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+			::close(fd);
+			if (view == MAP_FAILED)
+				return false;
+#endif
+			m_data = static_cast<char*>(view);
+			m_size = length;
+			return true;
+		}
+		static auto remove_shared(const std::string& name) -> void
+		{
+#ifndef _WIN64
+			shm_unlink((name[0] == '/' ? name : "/" + name).c_str());
+#endif
+		}
+
+		auto close() -> void
+		{
+			if (!m_data)
+				return;
+#ifdef _WIN64
+			UnmapViewOfFile(m_data);
+#else
+			munmap(m_data, m_size);
+#endif
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		// schedules write back of dirty pages, doesn't wait
+		auto flush() -> void
+		{
+			if (!m_data)
+				return;
+#ifdef _WIN64
+			FlushViewOfFile(m_data, 0);
+#else
+			msync(m_data, m_size, MS_ASYNC);
+#endif
+		}
+
+		auto is_open() const -> bool { return m_data != nullptr; }
+		auto data() const -> char* { return m_data; }
+		auto size() const -> size_t { return m_size; }
+
+	private:
+		char* m_data = nullptr;
+		size_t m_size = 0;
+	};
+}
@@ -0,0 +1,95 @@
+// pacer.h
+// separates "data changed" from "tell the host": changed() is one atomic exchange from any thread,
+// the notifier thread asks poll() whether to notify now or how long to sleep, the host reports pulled() when it reads
+// at most one notification per interval counted from the host's last pull, none while the host hasn't pulled the
+// last one (sent again after max), the first change after an idle period goes out right away
+// interval follows the host's latency (notify to pull): doubles when the host was still busy (latency over a quarter
+// of the interval), shrinks by 1/8 per pull while it keeps up, so a sheet that recalculates slowly isn't flooded
+// times are microseconds of any monotonic clock, no OS calls (simulated clocks work too)
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+namespace aw
+{
+	class NotifyPacer
+	{
+	public:
+		NotifyPacer(uint64_t min_us = 10000, uint64_t max_us = 2000000) { set_interval(min_us, max_us); }
+
+		auto set_interval(uint64_t min_us, uint64_t max_us) -> void
+		{
+			std::lock_guard<std::mutex> __(m_mutex);
+			m_min_us = min_us;
+			m_max_us = (std::max)(min_us, max_us);
+			m_interval_us = m_min_us;
+		}
+
+		// data side, true if this is the first change since the host last pulled: the notifier may be asleep, wake it
+		auto changed() -> bool
+		{
+			if (m_pending.load(std::memory_order_relaxed))
+				return false; // read first, a burst doesn't bounce the cache line
+			return !m_pending.exchange(true, std::memory_order_acq_rel);
+		}
+
+		// notifier thread: true to notify now, otherwise false with how long until it's worth asking again
+		auto poll(uint64_t now, uint64_t& wait_us) -> bool
+		{
+			std::lock_guard<std::mutex> __(m_mutex);
+			wait_us = m_max_us;
+			if (!m_pending.load(std::memory_order_acquire))
+				return false;
+			uint64_t due = m_outstanding ? m_notified + m_max_us : (std::max)(m_notified, m_pulled) + m_interval_us;
+			if (m_notifies && now < due) {
+				wait_us = due - now;
+				return false;
+			}
+			m_outstanding = true;
+			m_notified = now;
+			m_notifies++;
+			return true;
+		}
+
+		// host is about to read every change so far, call before reading
+		auto pulled(uint64_t now) -> void
+		{
+			m_pending.store(false, std::memory_order_release);
+			std::lock_guard<std::mutex> __(m_mutex);
+			m_pulls++;
+			m_pulled = now;
+			if (!m_outstanding)
+				return; // host's own timer, not an answer to a notification
+			m_outstanding = false;
+			uint64_t latency = now > m_notified ? now - m_notified : 0;
+			m_latency_us = m_pulls_answered++ ? (m_latency_us * 7 + latency) / 8 : latency;
+			if (latency * 4 > m_interval_us)
+				m_interval_us = (std::min)(m_interval_us * 2, m_max_us);
+			else
+				m_interval_us = (std::max)(m_interval_us - m_interval_us / 8, m_min_us);
+		}
+
+		auto interval() -> uint64_t { std::lock_guard<std::mutex> __(m_mutex); return m_interval_us; }
+		auto latency() -> uint64_t { std::lock_guard<std::mutex> __(m_mutex); return m_latency_us; }
+		auto notifies() -> uint64_t { std::lock_guard<std::mutex> __(m_mutex); return m_notifies; }
+		auto pulls() -> uint64_t { std::lock_guard<std::mutex> __(m_mutex); return m_pulls; }
+
+	private:
+		std::atomic<bool> m_pending = false;
+		std::mutex m_mutex; // poll() and pulled() run on different threads, both rarely
+		uint64_t m_min_us = 0;
+		uint64_t m_max_us = 0;
+		uint64_t m_interval_us = 0;
+		uint64_t m_latency_us = 0; // notify to pull, moving average
+		uint64_t m_notified = 0;
+		uint64_t m_pulled = 0;
+		bool m_outstanding = false; // notified, not pulled yet
+		uint64_t m_notifies = 0;
+		uint64_t m_pulls = 0;
+		uint64_t m_pulls_answered = 0;
+	};
+}
@@ -0,0 +1,147 @@
+// simd.h
+// minimal packed double vector for batch math, widest the build allows:
+//	AVX2 (4 lanes, msvc /arch:AVX2, gcc -mavx2), SSE2 (2 lanes, any x64), plain double (1 lane) elsewhere
+// only what the batch kernels need: arithmetic, compare masks, select, exp
+// exp is range reduced to 2^n * e^r with |r| <= ln2/2, error about 1 ulp, no libm call per lane
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AW_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AW_SIMD_SSE2
+#endif
+
+namespace aw
+{
+	namespace simd
+	{
+#if defined(AW_SIMD_AVX2)
+		struct Vec
+		{
+			static constexpr size_t WIDTH = 4;
+			static constexpr const char* NAME = "avx2";
+			__m256d v;
+		};
+		inline auto set1(double x) -> Vec { return Vec{ _mm256_set1_pd(x) }; }
+		inline auto load(const double* p) -> Vec { return Vec{ _mm256_loadu_pd(p) }; }
+		inline auto store(double* p, Vec a) -> void { _mm256_storeu_pd(p, a.v); }
+		inline auto operator+(Vec a, Vec b) -> Vec { return Vec{ _mm256_add_pd(a.v, b.v) }; }
+		inline auto operator-(Vec a, Vec b) -> Vec { return Vec{ _mm256_sub_pd(a.v, b.v) }; }
+		inline auto operator*(Vec a, Vec b) -> Vec { return Vec{ _mm256_mul_pd(a.v, b.v) }; }
+		inline auto operator/(Vec a, Vec b) -> Vec { return Vec{ _mm256_div_pd(a.v, b.v) }; }
+		inline auto sqrt(Vec a) -> Vec { return Vec{ _mm256_sqrt_pd(a.v) }; }
+		inline auto min(Vec a, Vec b) -> Vec { return Vec{ _mm256_min_pd(a.v, b.v) }; }
+		inline auto max(Vec a, Vec b) -> Vec { return Vec{ _mm256_max_pd(a.v, b.v) }; }
+		inline auto abs(Vec a) -> Vec { return Vec{ _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v) }; }
+		// masks: all bits set in lanes where true, false for NaN
+		inline auto lt(Vec a, Vec b) -> Vec { return Vec{ _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ) }; }
+		inline auto le(Vec a, Vec b) -> Vec { return Vec{ _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ) }; }
+		inline auto mask_and(Vec a, Vec b) -> Vec { return Vec{ _mm256_and_pd(a.v, b.v) }; }
+		inline auto mask_andnot(Vec a, Vec b) -> Vec { return Vec{ _mm256_andnot_pd(b.v, a.v) }; } // a && !b
+		inline auto any(Vec mask) -> bool { return _mm256_movemask_pd(mask.v) != 0; }
+		inline auto select(Vec mask, Vec a, Vec b) -> Vec { return Vec{ _mm256_blendv_pd(b.v, a.v, mask.v) }; }
+		inline auto round(Vec a) -> Vec { return Vec{ _mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) }; }
+		// x already integral in [-1022, 1023]
+		inline auto pow2(Vec n) -> Vec
+		{
+			__m256d biased = _mm256_add_pd(n.v, _mm256_set1_pd(1023.0 + 4503599627370496.0)); // integer in low mantissa bits
+			return Vec{ _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(biased), 52)) };
+		}
+#elif defined(AW_SIMD_SSE2)
+		struct Vec
+		{
+			static constexpr size_t WIDTH = 2;
+			static constexpr const char* NAME = "sse2";
+			__m128d v;
+		};
+		inline auto set1(double x) -> Vec { return Vec{ _mm_set1_pd(x) }; }
+		inline auto load(const double* p) -> Vec { return Vec{ _mm_loadu_pd(p) }; }
+		inline auto store(double* p, Vec a) -> void { _mm_storeu_pd(p, a.v); }
+		inline auto operator+(Vec a, Vec b) -> Vec { return Vec{ _mm_add_pd(a.v, b.v) }; }
+		inline auto operator-(Vec a, Vec b) -> Vec { return Vec{ _mm_sub_pd(a.v, b.v) }; }
+		inline auto operator*(Vec a, Vec b) -> Vec { return Vec{ _mm_mul_pd(a.v, b.v) }; }
+		inline auto operator/(Vec a, Vec b) -> Vec { return Vec{ _mm_div_pd(a.v, b.v) }; }
+		inline auto sqrt(Vec a) -> Vec { return Vec{ _mm_sqrt_pd(a.v) }; }
+		inline auto min(Vec a, Vec b) -> Vec { return Vec{ _mm_min_pd(a.v, b.v) }; }
+		inline auto max(Vec a, Vec b) -> Vec { return Vec{ _mm_max_pd(a.v, b.v) }; }
+		inline auto abs(Vec a) -> Vec { return Vec{ _mm_andnot_pd(_mm_set1_pd(-0.0), a.v) }; }
+		inline auto lt(Vec a, Vec b) -> Vec { return Vec{ _mm_cmplt_pd(a.v, b.v) }; }
+		inline auto le(Vec a, Vec b) -> Vec { return Vec{ _mm_cmple_pd(a.v, b.v) }; }
+		inline auto mask_and(Vec a, Vec b) -> Vec { return Vec{ _mm_and_pd(a.v, b.v) }; }
+		inline auto mask_andnot(Vec a, Vec b) -> Vec { return Vec{ _mm_andnot_pd(b.v, a.v) }; }
+		inline auto any(Vec mask) -> bool { return _mm_movemask_pd(mask.v) != 0; }
+		inline auto select(Vec mask, Vec a, Vec b) -> Vec { return Vec{ _mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v)) }; }
+		// |a| < 2^51, sse2 has no round instruction, adding 1.5 * 2^52 drops the fraction
+		inline auto round(Vec a) -> Vec
+		{
+			const __m128d magic = _mm_set1_pd(6755399441055744.0);
+			return Vec{ _mm_sub_pd(_mm_add_pd(a.v, magic), magic) };
+		}
+		inline auto pow2(Vec n) -> Vec
+		{
+			__m128d biased = _mm_add_pd(n.v, _mm_set1_pd(1023.0 + 4503599627370496.0));
+			return Vec{ _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(biased), 52)) };
+		}
+#else
+		struct Vec
+		{
+			static constexpr size_t WIDTH = 1;
+			static constexpr const char* NAME = "scalar";
+			double v;
+		};
+		inline auto set1(double x) -> Vec { return Vec{ x }; }
+		inline auto load(const double* p) -> Vec { return Vec{ *p }; }
+		inline auto store(double* p, Vec a) -> void { *p = a.v; }
+		inline auto operator+(Vec a, Vec b) -> Vec { return Vec{ a.v + b.v }; }
+		inline auto operator-(Vec a, Vec b) -> Vec { return Vec{ a.v - b.v }; }
+		inline auto operator*(Vec a, Vec b) -> Vec { return Vec{ a.v * b.v }; }
+		inline auto operator/(Vec a, Vec b) -> Vec { return Vec{ a.v / b.v }; }
+		inline auto sqrt(Vec a) -> Vec { return Vec{ std::sqrt(a.v) }; }
+		inline auto min(Vec a, Vec b) -> Vec { return Vec{ b.v < a.v ? b.v : a.v }; }
+		inline auto max(Vec a, Vec b) -> Vec { return Vec{ b.v > a.v ? b.v : a.v }; }
+		inline auto abs(Vec a) -> Vec { return Vec{ std::fabs(a.v) }; }
+		inline auto lt(Vec a, Vec b) -> Vec { return Vec{ a.v < b.v ? 1.0 : 0.0 }; } // mask is 1.0 / 0.0
+		inline auto le(Vec a, Vec b) -> Vec { return Vec{ a.v <= b.v ? 1.0 : 0.0 }; }
+		inline auto mask_and(Vec a, Vec b) -> Vec { return Vec{ a.v != 0 && b.v != 0 ? 1.0 : 0.0 }; }
+		inline auto mask_andnot(Vec a, Vec b) -> Vec { return Vec{ a.v != 0 && b.v == 0 ? 1.0 : 0.0 }; }
+		inline auto any(Vec mask) -> bool { return mask.v != 0; }
+		inline auto select(Vec mask, Vec a, Vec b) -> Vec { return mask.v != 0 ? a : b; }
+		inline auto round(Vec a) -> Vec { return Vec{ std::nearbyint(a.v) }; } // x87 extended precision breaks the magic number trick
+		inline auto pow2(Vec n) -> Vec { return Vec{ std::ldexp(1.0, static_cast<int>(n.v)) }; }
+#endif
+
+		inline auto operator-(Vec a) -> Vec { return set1(0.0) - a; }
+		inline auto gt(Vec a, Vec b) -> Vec { return lt(b, a); }
+
+		// e^x, x clamped to [-708, 708]
+		inline auto exp(Vec x) -> Vec
+		{
+			x = min(max(x, set1(-708.0)), set1(708.0));
+			Vec n = round(x * set1(1.4426950408889634)); // log2(e)
+			Vec r = x - n * set1(0.693145751953125) - n * set1(1.4286068203094172321e-6); // ln2 hi + lo
+			// taylor to r^12 / 12!, |r| <= 0.347
+			Vec p = set1(1.0 / 479001600.0);
+			p = p * r + set1(1.0 / 39916800.0);
+			p = p * r + set1(1.0 / 3628800.0);
+			p = p * r + set1(1.0 / 362880.0);
+			p = p * r + set1(1.0 / 40320.0);
+			p = p * r + set1(1.0 / 5040.0);
+			p = p * r + set1(1.0 / 720.0);
+			p = p * r + set1(1.0 / 120.0);
+			p = p * r + set1(1.0 / 24.0);
+			p = p * r + set1(1.0 / 6.0);
+			p = p * r + set1(0.5);
+			p = p * r + set1(1.0);
+			p = p * r + set1(1.0);
+			return p * pow2(n);
+		}
+	}
+}
@@ -0,0 +1,175 @@
+// timerwheel.h
+// hierarchical timer wheel (4 levels of 256 slots), time is whatever unit caller uses (DataCache uses milliseconds)
+// TimerNode is intrusive: embed it (or derive from it), schedule/cancel are O(1), no allocation
+// advance() walks time forward one unit at a time, firing only timers that are due,
+// upper levels cascade down every 256 units, so cost is independent of how many timers are waiting
+// a jump longer than one level 1 revolution (feed gap, replay) re-files every timer once instead of walking
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <vector>
+
+namespace aw
+{
+	class TimerWheel;
+
+	struct TimerNode
+	{
+		TimerNode() {}
+		TimerNode(const TimerNode&) = delete;
+		TimerNode& operator=(const TimerNode&) = delete;
+		~TimerNode() { cancel(); }
+
+		auto scheduled() const -> bool { return m_prev != nullptr; }
+		auto deadline() const -> uint64_t { return m_deadline; }
+		inline auto cancel() -> void;
+
+	private:
+		friend class TimerWheel;
+		uint64_t m_deadline = 0;
+		TimerNode* m_prev = nullptr; // slot head when first in slot
+		TimerNode* m_next = nullptr;
+		TimerWheel* m_wheel = nullptr;
+		bool m_jumping = false; // collected by TimerWheel::jump, cancel() drops it from there
+	};
+
+	class TimerWheel
+	{
+	public:
+		static constexpr uint32_t BITS = 8;
+		static constexpr uint32_t SLOTS = 1 << BITS;
+		static constexpr uint32_t LEVELS = 4;
+
+		TimerWheel() {}
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+		~TimerWheel()
+		{
+			for (auto& level : m_slots) {
+				for (auto& head : level) {
+					while (head.m_next)
+						head.m_next->cancel();
+				}
+			}
+		}
+
+		auto now() const -> uint64_t { return m_now; }
+		auto size() const -> size_t { return m_count; }
+
+		// deadline in the past fires on next advance, reschedule moves an already scheduled node
+		auto schedule(TimerNode& node, uint64_t deadline) -> void
+		{
+			node.cancel();
+			node.m_deadline = deadline > m_now ? deadline : m_now + 1;
+			insert(node);
+			node.m_wheel = this;
+			m_count++;
+		}
+
+		// fire(TimerNode&) for every timer with deadline <= to, fire may schedule/cancel any node
+		template<typename Fire>
+		auto advance(uint64_t to, Fire fire) -> void
+		{
+			if (to > m_now && to - m_now > SLOTS * SLOTS && m_count > 0) {
+				jump(to, fire);
+				return;
+			}
+			while (m_now < to) {
+				if (m_count == 0) {
+					m_now = to; // nothing waiting, jump
+					return;
+				}
+				m_now++;
+				for (uint32_t level = LEVELS - 1; level > 0; level--) {
+					if ((m_now & ((1ull << (BITS * level)) - 1)) == 0)
+						cascade(level);
+				}
+				TimerNode& head(m_slots[0][m_now & (SLOTS - 1)]);
+				while (head.m_next) {
+					TimerNode& node(*head.m_next);
+					node.cancel();
+					fire(node);
+				}
+			}
+		}
+
+	private:
+		friend struct TimerNode;
+
+		template<typename Fire>
+		auto jump(uint64_t to, Fire fire) -> void
+		{
+			m_jump.clear();
+			for (auto& level : m_slots) {
+				for (auto& head : level) {
+					while (head.m_next) {
+						TimerNode* node = head.m_next;
+						node->cancel();
+						node->m_jumping = true;
+						m_jump.push_back(node);
+					}
+				}
+			}
+			m_now = to;
+			for (auto* node : m_jump) {
+				if (!node->m_jumping)
+					continue; // cancelled or rescheduled by an earlier fire
+				node->m_jumping = false;
+				if (node->m_deadline <= to)
+					fire(*node);
+				else
+					schedule(*node, node->m_deadline);
+			}
+			m_jump.clear();
+		}
+
+		// lowest level whose current revolution contains deadline
+		auto insert(TimerNode& node) -> void
+		{
+			uint32_t level = 0;
+			while (level < LEVELS - 1 && ((node.m_deadline ^ m_now) >> (BITS * (level + 1))) != 0)
+				level++;
+			TimerNode& head(m_slots[level][(node.m_deadline >> (BITS * level)) & (SLOTS - 1)]);
+			node.m_prev = &head;
+			node.m_next = head.m_next;
+			if (head.m_next)
+				head.m_next->m_prev = &node;
+			head.m_next = &node;
+		}
+
+		// move one upper level slot down now that its range starts
+		auto cascade(uint32_t level) -> void
+		{
+			TimerNode& head(m_slots[level][(m_now >> (BITS * level)) & (SLOTS - 1)]);
+			TimerNode* node = head.m_next;
+			head.m_next = nullptr;
+			while (node) {
+				TimerNode* next = node->m_next;
+				insert(*node);
+				node = next;
+			}
+		}
+
+		uint64_t m_now = 0;
+		size_t m_count = 0;
+		std::vector<TimerNode*> m_jump;
+		std::array<std::array<TimerNode, SLOTS>, LEVELS> m_slots; // nodes used as list heads only
+	};
+
+	inline auto TimerNode::cancel() -> void
+	{
+		m_jumping = false;
+		if (!m_prev)
+			return;
+		m_prev->m_next = m_next;
+		if (m_next)
+			m_next->m_prev = m_prev;
+		m_prev = m_next = nullptr;
+		if (m_wheel)
+			m_wheel->m_count--;
+		m_wheel = nullptr;
+	}
+}
@@ -43,6 +43,7 @@ namespace aw
 	{
 	public:
 		virtual auto onData(const char* data, size_t size) -> void = 0; // "empty function"
+		virtual auto onIdle() -> void {} // select timed out (1ms) with no data on any channel
 	};
 
 	namespace internal_only
@@ -124,7 +125,7 @@ namespace aw
 					return false;
 				}
 				int flag(1);
-				auto rt = setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char*)&flag, sizeof(flag)); // set socket option 1, reuse address
+				setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char*)&flag, sizeof(flag)); // set socket option 1, reuse address
 				// set content of struct saddr and imreq to 0
 				sockaddr_in saddr = {};
 				saddr.sin_family = AF_INET;
@@ -135,7 +136,7 @@ namespace aw
 				{
 					return false;
 				}
-				rt = setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&channel.m_imreq, sizeof(ip_mreq));
+				setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&channel.m_imreq, sizeof(ip_mreq));
 				channel.m_sock = sock;
 			}
 			// create thread to trigger run
@@ -146,14 +147,14 @@ namespace aw
 		auto stop() -> void
 		{
 			m_shutdown = true;
-			m_thread.join();
+			if (m_thread.joinable()) // start() may have failed before starting it
+				m_thread.join();
 		}
 
 	protected:
 		auto run() -> void
 		{
 			fd_set set; // file descriptor set
-			size_t size(m_channels.size());
 			char buf[1800]; // UDP packet size always less than 1600 bytes
 			int byteCount(0);
 			sockaddr_in addr;
@@ -199,8 +200,13 @@ namespace aw
 				if (rt < 0) // error occurred
 					return; // maybe log error
 
-				if (rt == 0)
-					continue; // everything fine, no data
+				if (rt == 0) { // everything fine, no data
+					for (auto& channel : m_channels) {
+						if (channel.m_listener)
+							channel.m_listener->onIdle();
+					}
+					continue;
+				}
 
 				// have data in some channel
 				for (auto& channel : m_channels)
@@ -244,8 +250,8 @@ namespace aw
 				return false;
 			}
 			int flag(1);
-			auto rt = setsockopt(m_sock, SOL_SOCKET, SO_REUSEADDR, (char*)&flag, sizeof(flag)); // set socket option 1, reuse address
-			rt = setsockopt(m_sock, IPPROTO_IP, IP_TTL, (char*)&m_ttl, sizeof(m_ttl));
+			setsockopt(m_sock, SOL_SOCKET, SO_REUSEADDR, (char*)&flag, sizeof(flag)); // set socket option 1, reuse address
+			setsockopt(m_sock, IPPROTO_IP, IP_TTL, (char*)&m_ttl, sizeof(m_ttl));
 			// setting up NIC card address
 			sockaddr_in addr = {}; // this is NIC/interface card address
 			addr.sin_family = AF_INET;